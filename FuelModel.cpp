@@ -0,0 +1,166 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "FuelModel.h"
+
+void FuelModel::reset()
+{
+    *this = FuelModel();
+}
+
+void FuelModel::update( const FuelModelInput& in, const FuelModelConfig& cfg )
+{
+    // Close the previous lap. Only count it if it was entirely under green, we didn't pit, and we
+    // actually drove from one lap to the next (not towed, reset, or joined mid-session).
+    if( in.lap != m_lap )
+    {
+        if( m_isValidLap && in.lap == m_lap+1 && in.fuelLevel >= 0 )
+            addLap( std::max( 0.0f, m_lapStartFuel - in.fuelLevel ), cfg.numLapsToAvg );
+
+        m_lap = in.lap;
+        m_lapStartFuel = in.fuelLevel;
+        m_isValidLap = true;
+    }
+
+    // Fuel going up without a pit stop means a reset or some other intervention
+    if( !in.isGreen || in.onPitRoad || in.fuelLevel < 0 || in.fuelLevel > m_lapStartFuel + 0.01f )
+        m_isValidLap = false;
+
+    plan( in, cfg );
+}
+
+void FuelModel::addLap( float used, int numLapsToAvg )
+{
+    const int maxLaps = std::min( std::max( 1, numLapsToAvg ), int(MaxLaps) );
+
+    if( m_numLaps == MaxLaps ) {
+        m_laps[m_firstLap] = used;
+        m_firstLap = (m_firstLap+1) % MaxLaps;
+    }
+    else {
+        m_laps[(m_firstLap+m_numLaps) % MaxLaps] = used;
+        m_numLaps++;
+    }
+
+    // Older laps aren't needed anymore
+    while( m_numLaps > maxLaps ) {
+        m_firstLap = (m_firstLap+1) % MaxLaps;
+        m_numLaps--;
+    }
+}
+
+float FuelModel::weightedAverage( int numLapsToAvg ) const
+{
+    const int n = std::min( m_numLaps, std::max( 1, numLapsToAvg ) );
+    if( n <= 0 )
+        return 0;
+
+    float v[MaxLaps];
+    for( int i=0; i<n; ++i )
+        v[i] = lapUsage( m_numLaps-n+i );
+
+    if( n < 3 )
+    {
+        float sum = 0;
+        for( int i=0; i<n; ++i )
+            sum += v[i];
+        return sum / n;
+    }
+
+    // Weight laps down the further they are from the median, so a single lap with a spin or
+    // a long tow behind someone doesn't throw off the estimate (Huber weights, MAD scale).
+    float sorted[MaxLaps];
+    std::copy( v, v+n, sorted );
+    std::sort( sorted, sorted+n );
+    const float median = n & 1 ? sorted[n/2] : 0.5f * (sorted[n/2-1] + sorted[n/2]);
+
+    float dev[MaxLaps];
+    for( int i=0; i<n; ++i )
+        dev[i] = fabsf( v[i] - median );
+    std::sort( dev, dev+n );
+    const float mad = n & 1 ? dev[n/2] : 0.5f * (dev[n/2-1] + dev[n/2]);
+
+    const float k = 2.0f * std::max( 1.4826f * mad, 0.02f * median );
+
+    float sum = 0;
+    float sumWeights = 0;
+    for( int i=0; i<n; ++i )
+    {
+        const float d = fabsf( v[i] - median );
+        const float w = d <= k ? 1.0f : k / d;
+        sum += w * v[i];
+        sumWeights += w;
+    }
+    return sumWeights > 0 ? sum / sumWeights : median;
+}
+
+void FuelModel::plan( const FuelModelInput& in, const FuelModelConfig& cfg )
+{
+    FuelEstimate& e = m_est;
+    e = FuelEstimate();
+
+    e.perLap             = weightedAverage( cfg.numLapsToAvg );
+    e.perLapConservative = e.perLap * cfg.estimateFactor;
+
+    const float pct  = std::min( 1.0f, std::max( 0.0f, in.lapDistPct ) );
+    const float fuel = in.fuelLevel;
+
+    if( fuel >= 0 && m_lapStartFuel >= 0 )
+        e.lapUsed = std::max( 0.0f, m_lapStartFuel - fuel );
+    if( m_isValidLap && pct >= 0.1f )
+        e.lapProjected = e.lapUsed / pct;
+
+    const float perLap = e.perLapConservative;
+    if( perLap <= 0 || fuel < 0 )
+        return;
+
+    e.lapsRemaining = fuel / perLap;
+
+    // Like the remaining lap count, this counts the current lap as a full one, which errs on the safe side
+    if( in.remainingLaps < 0 )
+        return;
+    e.toFinish = std::max( 0.0f, in.remainingLaps * perLap - fuel );
+    if( e.toFinish <= 0 )
+        return;
+
+    const float capacity = in.fuelCapacity;
+    e.minStops = capacity > 0 ? std::max( 1, (int)ceilf( e.toFinish / capacity - 1e-4f ) ) : 1;
+
+    // Last lap we can finish on what's in the tank
+    e.latestPitLap = in.lap + std::max( 0, (int)floorf( e.lapsRemaining - (1.0f-pct) ) );
+
+    // Pitting at the end of lap L leaves remainingLaps-(L-lap+1) laps, which minStops full tanks need to cover
+    if( capacity > 0 )
+    {
+        const int lapsOnStops = (int)floorf( e.minStops * capacity / perLap );
+        e.earliestPitLap = std::min( e.latestPitLap, std::max( in.lap, in.lap - 1 + in.remainingLaps - lapsOnStops ) );
+    }
+    else
+        e.earliestPitLap = in.lap;
+
+    // Actual per-lap usage that would get us to the end with one stop less
+    e.saveTarget = (fuel + (e.minStops-1) * capacity) / in.remainingLaps / cfg.estimateFactor;
+}
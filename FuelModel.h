@@ -0,0 +1,95 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Fuel consumption tracking and pit planning for our own car. Fed once per tick with plain numbers,
+// so it doesn't depend on iRacing or rendering and behaves the same when replayed from recorded data.
+
+struct FuelModelInput
+{
+    int     lap = 0;                // lap we're on, 0 before the start
+    float   lapDistPct = -1;        // -1 if not on track
+    float   fuelLevel = -1;         // liters, < 0 if unknown
+    float   fuelCapacity = 0;       // liters, 0 if unknown
+    int     remainingLaps = -1;     // including the current one, -1 if unknown
+    bool    isGreen = true;         // no yellow, red, checkered etc. flags
+    bool    onPitRoad = false;
+};
+
+struct FuelModelConfig
+{
+    int     numLapsToAvg = 4;       // most recent green laps to consider
+    float   estimateFactor = 1.1f;  // safety margin applied to the per-lap average for planning
+};
+
+struct FuelEstimate
+{
+    float   perLap = 0;             // weighted average over recent green laps, 0 until we've seen one
+    float   perLapConservative = 0; // perLap * estimateFactor, used for everything below
+    float   lapUsed = 0;            // used so far on the current lap
+    float   lapProjected = 0;       // current lap usage extrapolated to a full lap, 0 early in the lap
+    float   lapsRemaining = 0;      // on the fuel we have
+    float   toFinish = 0;           // to add in total to make it to the end, 0 if we have enough
+    int     minStops = 0;           // fuel stops needed to finish
+    int     earliestPitLap = -1;    // earliest lap to pit on and still finish with minStops stops, -1 if no stop needed
+    int     latestPitLap = -1;      // last lap we can complete before running dry, -1 if no stop needed
+    float   saveTarget = 0;         // per-lap usage that saves a stop, 0 if no stop needed
+};
+
+class FuelModel
+{
+    public:
+
+        static const int MaxLaps = 16;
+
+        void update( const FuelModelInput& in, const FuelModelConfig& cfg );
+
+        // Don't count the lap in progress, e.g. after a session change.
+        void invalidateLap() { m_isValidLap = false; }
+
+        // Forget everything.
+        void reset();
+
+        const FuelEstimate& estimate() const { return m_est; }
+        bool isValidLap() const { return m_isValidLap; }
+        int  numLaps() const { return m_numLaps; }
+        float lapUsage( int i ) const { return m_laps[(m_firstLap+i) % MaxLaps]; }  // oldest first
+
+    private:
+
+        void addLap( float used, int numLapsToAvg );
+        float weightedAverage( int numLapsToAvg ) const;
+        void plan( const FuelModelInput& in, const FuelModelConfig& cfg );
+
+        float           m_laps[MaxLaps] = {};
+        int             m_firstLap = 0;
+        int             m_numLaps = 0;
+
+        int             m_lap = 0;
+        float           m_lapStartFuel = 0;
+        bool            m_isValidLap = false;
+
+        FuelEstimate    m_est;
+};
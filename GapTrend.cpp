@@ -0,0 +1,135 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include "GapTrend.h"
+
+void GapTrend::reset()
+{
+    for( Ring& r : m_rings )
+        resetRing( r );
+    m_focusIdx = -1;
+    m_origin = 0;
+    m_lastSample = -1;
+}
+
+void GapTrend::resetRing( Ring& r )
+{
+    r.first = 0;
+    r.n = 0;
+    r.ahead = false;
+    r.sx = r.sy = r.sxx = r.sxy = 0;
+}
+
+void GapTrend::add( Ring& r, float t, float g )
+{
+    if( r.n == MaxSamples )
+    {
+        const double ot = r.t[r.first];
+        const double og = r.g[r.first];
+        r.sx  -= ot;
+        r.sy  -= og;
+        r.sxx -= ot*ot;
+        r.sxy -= ot*og;
+        r.first = (r.first+1) % MaxSamples;
+        r.n--;
+    }
+
+    const int idx = (r.first + r.n) % MaxSamples;
+    r.t[idx] = t;
+    r.g[idx] = g;
+    r.n++;
+    r.sx  += t;
+    r.sy  += g;
+    r.sxx += double(t)*t;
+    r.sxy += double(t)*g;
+}
+
+void GapTrend::update( double sessionTime, int focusIdx, const float* gap, unsigned long long validMask, float sampleInterval )
+{
+    if( focusIdx != m_focusIdx || sessionTime < m_lastSample )
+    {
+        reset();
+        m_focusIdx = focusIdx;
+        m_origin = sessionTime;
+    }
+    if( focusIdx < 0 || (m_lastSample >= 0 && sessionTime - m_lastSample < sampleInterval) )
+        return;
+    m_lastSample = sessionTime;
+
+    const float t = float( sessionTime - m_origin );
+
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        Ring& r = m_rings[carIdx];
+
+        if( !((validMask >> carIdx) & 1) || carIdx == focusIdx ) {
+            if( r.n )
+                resetRing( r );
+            continue;
+        }
+
+        // The absolute gap is continuous where a car switches from half a lap behind to half a lap
+        // ahead, but not when cars pass each other, or jump (towing, pit exit). Start over then.
+        const float g     = fabsf( gap[carIdx] );
+        const bool  ahead = gap[carIdx] > 0;
+        if( r.n && ((ahead != r.ahead && g < 5.0f) || fabsf( g - r.g[(r.first+r.n-1) % MaxSamples] ) > 3.0f) )
+            resetRing( r );
+        r.ahead = ahead;
+
+        add( r, t, g );
+    }
+}
+
+bool GapTrend::rate( int carIdx, float* secPerSec ) const
+{
+    if( carIdx < 0 || carIdx >= IR_MAX_CARS )
+        return false;
+
+    const Ring& r = m_rings[carIdx];
+    if( r.n < MinSamples )
+        return false;
+
+    const double n   = r.n;
+    const double den = n*r.sxx - r.sx*r.sx;
+    if( den <= 0 )
+        return false;
+
+    *secPerSec = float( (n*r.sxy - r.sx*r.sy) / den );
+    return true;
+}
+
+bool GapTrend::lapsUntilContact( int carIdx, float lapTime, float* laps ) const
+{
+    float rt = 0;
+    if( lapTime <= 0 || !rate( carIdx, &rt ) || rt >= 0 )
+        return false;
+
+    const Ring& r = m_rings[carIdx];
+    const float g = r.g[(r.first+r.n-1) % MaxSamples];
+
+    // The gap shrinks by -rt seconds every second, i.e. by -rt*lapTime per lap
+    *laps = g / (-rt * lapTime);
+    return true;
+}
@@ -0,0 +1,74 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+// Trend of every car's time gap to the focus car. Gaps are sampled at a fixed interval into a short
+// ring per car, and a least-squares line through the ring is kept up to date incrementally (running
+// sums, adjusted for the sample that comes in and the one that drops out), so each sample is O(1).
+class GapTrend
+{
+    public:
+
+        static const int MaxSamples = 32;
+        static const int MinSamples = 6;    // fewer than this don't make a trend
+
+        GapTrend() { reset(); }
+
+        void reset();
+
+        // Call every tick with the gaps to the focus car (positive ahead, negative behind), e.g. a
+        // row of the RelativeMatrix. A new focus car starts over.
+        void update( double sessionTime, int focusIdx, const float* gap, unsigned long long validMask, float sampleInterval );
+
+        // How fast the gap grows, in seconds per second. Negative when the car and the focus car get closer.
+        bool  rate( int carIdx, float* secPerSec ) const;
+
+        // Laps until the gap is gone at the current rate, given the focus car's lap time. False if not closing.
+        bool  lapsUntilContact( int carIdx, float lapTime, float* laps ) const;
+
+        int   numSamples( int carIdx ) const { return m_rings[carIdx].n; }
+
+    private:
+
+        struct Ring
+        {
+            float   t[MaxSamples];      // relative to m_origin
+            float   g[MaxSamples];      // |gap|
+            int     first;
+            int     n;
+            bool    ahead;
+            double  sx, sy, sxx, sxy;
+        };
+
+        void resetRing( Ring& r );
+        void add( Ring& r, float t, float g );
+
+        Ring    m_rings[IR_MAX_CARS];
+        int     m_focusIdx;
+        double  m_origin;
+        double  m_lastSample;
+};
@@ -0,0 +1,205 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "HazardDetector.h"
+
+static const float  StoppedSpeed  = 3.0f;   // m/s
+static const float  MovingSpeed   = 10.0f;  // m/s, to count as going again
+static const double StoppedDelay  = 1.0;    // seconds below StoppedSpeed
+static const float  SpinRatio     = 0.4f;   // of the usual speed at that point of the track...
+static const float  SpinMinSpeed  = 20.0f;  // ...where that is a decent speed
+static const int    ProfileMinCount = 3;    // samples before a profile bin is trusted
+static const int    ProfileMaxCount = 20;   // the profile averages over about this many passes
+static const float  BackwardSpeed = -2.0f;  // m/s
+static const float  RejoinRatio   = 0.6f;   // of the usual speed
+static const double RejoinDelay   = 1.0;    // seconds back at speed
+
+void HazardDetector::reset()
+{
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+        resetCar( carIdx );
+    m_activeMask = 0;
+    for( int i=0; i<NumBins; ++i ) {
+        m_profile[i] = 0;
+        m_profileCount[i] = 0;
+    }
+    for( HazardEvent& e : m_events )
+        e = HazardEvent();
+    m_numEvents = 0;
+    m_lastTime = -1;
+    m_trackLength = 0;
+}
+
+void HazardDetector::emit( double time, int carIdx, HazardType type, float pct )
+{
+    HazardEvent& e = m_events[m_numEvents++ % MaxEvents];
+    e.time = time;
+    e.carIdx = carIdx;
+    e.type = type;
+    e.lapDistPct = pct;
+}
+
+void HazardDetector::resetCar( int carIdx )
+{
+    m_state[carIdx] = State::NORMAL;
+    m_stateType[carIdx] = HazardType::OFF_TRACK;
+    m_stateSince[carIdx] = 0;
+    m_slowSince[carIdx] = -1;
+    m_pct[carIdx] = -1;
+}
+
+void HazardDetector::update( double sessionTime, const Session& session, const float* lapDistPct, const float* speed, const bool* offTrack, const bool* onPitRoad, const bool* inWorld, unsigned long long validMask )
+{
+    // Session time going backwards means a new session (or a replay jump)
+    if( sessionTime < m_lastTime )
+    {
+        const float trackLength = m_trackLength;
+        reset();
+        m_trackLength = trackLength;
+    }
+    const float dt = m_lastTime >= 0 ? float( sessionTime - m_lastTime ) : 0;
+    m_lastTime = sessionTime;
+    if( dt <= 0 || m_trackLength <= 0 )
+        return;
+
+    // Cars that left don't get looked at anymore, so nothing of theirs may linger. Rare, only after a session update.
+    if( const unsigned long long gone = m_activeMask & ~session.activeMask )
+    {
+        for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+            if( (gone >> carIdx) & 1 )
+                resetCar( carIdx );
+    }
+    m_activeMask = session.activeMask;
+
+    for( int i=0; i<session.numActiveCars; ++i )
+    {
+        const int   carIdx = session.activeCarIdx[i];
+        const float pct = lapDistPct[carIdx];
+        m_pct[carIdx] = pct;
+
+        if( !((validMask >> carIdx) & 1) || !inWorld[carIdx] || onPitRoad[carIdx] || pct < 0 )
+        {
+            m_state[carIdx] = State::NORMAL;
+            m_slowSince[carIdx] = -1;
+            continue;
+        }
+
+        const float v = speed[carIdx];
+        if( v < StoppedSpeed ) {
+            if( m_slowSince[carIdx] < 0 )
+                m_slowSince[carIdx] = sessionTime;
+        }
+        else if( v > MovingSpeed )
+            m_slowSince[carIdx] = -1;
+
+        const int   bin     = std::min( NumBins-1, int( pct * NumBins ) );
+        const float usual   = m_profileCount[bin] >= ProfileMinCount ? m_profile[bin] : 0;
+        const bool  stopped = m_slowSince[carIdx] >= 0 && sessionTime - m_slowSince[carIdx] >= StoppedDelay;
+        const bool  spun    = v < BackwardSpeed || (usual > SpinMinSpeed && v < SpinRatio * usual);
+
+        switch( m_state[carIdx] )
+        {
+            case State::NORMAL:
+                if( offTrack[carIdx] ) {
+                    m_state[carIdx] = State::OFF_TRACK;
+                    m_stateType[carIdx] = HazardType::OFF_TRACK;
+                }
+                else if( stopped ) {
+                    m_state[carIdx] = State::STOPPED;
+                    m_stateType[carIdx] = HazardType::STOPPED;
+                }
+                else if( spun ) {
+                    m_state[carIdx] = State::SPIN;
+                    m_stateType[carIdx] = HazardType::SPIN;
+                }
+                else
+                    break;
+                m_stateSince[carIdx] = sessionTime;
+                emit( sessionTime, carIdx, m_stateType[carIdx], pct );
+                break;
+
+            case State::OFF_TRACK:
+            case State::STOPPED:
+            case State::SPIN:
+                // Going off after a spin, or stopping after either, is the more useful thing to know
+                if( offTrack[carIdx] && m_state[carIdx] != State::OFF_TRACK ) {
+                    m_state[carIdx] = State::OFF_TRACK;
+                    m_stateType[carIdx] = HazardType::OFF_TRACK;
+                    m_stateSince[carIdx] = sessionTime;
+                    emit( sessionTime, carIdx, HazardType::OFF_TRACK, pct );
+                }
+                else if( stopped && m_state[carIdx] == State::SPIN ) {
+                    m_state[carIdx] = State::STOPPED;
+                    m_stateType[carIdx] = HazardType::STOPPED;
+                    m_stateSince[carIdx] = sessionTime;
+                    emit( sessionTime, carIdx, HazardType::STOPPED, pct );
+                }
+
+                // Back on track and going at a decent fraction of the usual speed, for a moment
+                if( offTrack[carIdx] || v < fmaxf( MovingSpeed, RejoinRatio * usual ) || m_slowSince[carIdx] >= 0 )
+                    m_stateSince[carIdx] = sessionTime;
+                else if( sessionTime - m_stateSince[carIdx] >= RejoinDelay ) {
+                    m_state[carIdx] = State::NORMAL;
+                    emit( sessionTime, carIdx, HazardType::REJOIN, pct );
+                }
+                break;
+        }
+
+        // Only learn what's normal from cars that have nothing going on
+        if( m_state[carIdx] == State::NORMAL && v > MovingSpeed )
+        {
+            int& n = m_profileCount[bin];
+            n = std::min( n+1, ProfileMaxCount );
+            m_profile[bin] += (v - m_profile[bin]) / n;
+        }
+    }
+}
+
+int HazardDetector::hazardAhead( int carIdx, float meters, float* distance ) const
+{
+    if( carIdx < 0 || carIdx >= IR_MAX_CARS || m_pct[carIdx] < 0 || m_trackLength <= 0 )
+        return -1;
+
+    const float maxPct = meters / m_trackLength;
+    float best = maxPct;
+    int   bestIdx = -1;
+    for( int i=0; i<IR_MAX_CARS; ++i )
+    {
+        if( i == carIdx || m_state[i] == State::NORMAL )
+            continue;
+
+        float d = m_pct[i] - m_pct[carIdx];
+        d -= floorf( d );
+        if( d <= best ) {
+            best = d;
+            bestIdx = i;
+        }
+    }
+
+    if( bestIdx >= 0 && distance )
+        *distance = best * m_trackLength;
+    return bestIdx;
+}
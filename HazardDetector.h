@@ -0,0 +1,100 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+enum class HazardType
+{
+    OFF_TRACK = 0,
+    STOPPED,        // on track, not moving
+    SPIN,           // sudden loss of speed, or going backwards
+    REJOIN          // back on track and up to speed after one of the above
+};
+static const char* const HazardTypeStr[] = {"OFF_TRACK","STOPPED","SPIN","REJOIN"};
+
+struct HazardEvent
+{
+    double      time = 0;           // SessionTime
+    int         carIdx = -1;
+    HazardType  type = HazardType::OFF_TRACK;
+    float       lapDistPct = 0;     // where it happened
+};
+
+// Watches every car for going off, spinning and stopping on track, with a small state machine per
+// car driven by the track surface and the along-track speed from RaceState. What speed is
+// normal where is learned from the field as it goes, so braking for a hairpin doesn't look like a
+// spin. Each update is constant work per car. Events go into a short ring, and cars with an ongoing
+// incident can be queried by distance.
+class HazardDetector
+{
+    public:
+
+        static const int MaxEvents = 32;   // older events are dropped
+        static const int NumBins = 256;    // speed profile resolution along the lap
+
+        HazardDetector() { reset(); }
+
+        void reset();
+
+        void setTrackLength( float meters ) { m_trackLength = meters; }
+
+        // Call once per tick, 'speed' is the along-track speed in m/s (see RaceState::speed). Only the
+        // session's active cars are looked at. Cars not in 'validMask' (e.g. during the start, when the grid
+        // stands still) and cars on pit road are left alone.
+        void update( double sessionTime, const Session& session, const float* lapDistPct, const float* speed, const bool* offTrack, const bool* onPitRoad, const bool* inWorld, unsigned long long validMask );
+
+        // Emitted so far, 0 is the most recent. i < min(numEvents, MaxEvents).
+        int   numEvents() const { return m_numEvents; }
+        const HazardEvent& event( int i ) const { return m_events[(m_numEvents-1-i) % MaxEvents]; }
+
+        // Car is off, stopped or spinning right now
+        bool  isHazard( int carIdx ) const { return carIdx >= 0 && carIdx < IR_MAX_CARS && m_state[carIdx] != State::NORMAL; }
+        HazardType hazardType( int carIdx ) const { return m_stateType[carIdx]; }
+
+        // Closest car with an ongoing incident within 'meters' ahead of 'carIdx' along the track.
+        // Returns -1 if there is none.
+        int   hazardAhead( int carIdx, float meters, float* distance = nullptr ) const;
+
+    private:
+
+        enum class State { NORMAL, OFF_TRACK, STOPPED, SPIN };
+
+        void emit( double time, int carIdx, HazardType type, float pct );
+        void resetCar( int carIdx );
+
+        State       m_state[IR_MAX_CARS];
+        HazardType  m_stateType[IR_MAX_CARS];
+        double      m_stateSince[IR_MAX_CARS];
+        double      m_slowSince[IR_MAX_CARS];   // -1 if not slow
+        float       m_pct[IR_MAX_CARS];
+        unsigned long long m_activeMask;        // session.activeMask at the last update
+        float       m_profile[NumBins];         // usual speed by track location, over all cars
+        int         m_profileCount[NumBins];
+        HazardEvent m_events[MaxEvents];
+        int         m_numEvents;
+        double      m_lastTime;
+        float       m_trackLength;
+};
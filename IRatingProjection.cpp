@@ -0,0 +1,109 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "IRatingProjection.h"
+
+void IRatingProjection::reset()
+{
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        m_expected[carIdx] = 0;
+        m_classSize[carIdx] = 0;
+        m_classPosition[carIdx] = 0;
+        m_change[carIdx] = 0;
+    }
+    m_sessionVersion = -1;
+    m_expectedRebuilds = 0;
+    m_changeUpdates = 0;
+}
+
+void IRatingProjection::rebuildExpected( const Session& session )
+{
+    const double br1 = 1600.0 / log( 2.0 );
+
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx ) {
+        m_expected[carIdx] = 0;
+        m_classSize[carIdx] = 0;
+        m_classPosition[carIdx] = 0;
+        m_change[carIdx] = 0;
+    }
+
+    for( int c=0; c<session.numClasses; ++c )
+    {
+        const CarClass& cls = session.classes[c];
+
+        // e^(-r/br1) and 1-e^(-r/br1) per member, so the pairwise loop is just multiplies
+        double e[IR_MAX_CARS], f[IR_MAX_CARS];
+        for( int k=0; k<cls.numCars; ++k ) {
+            e[k] = exp( -std::max( 1, session.cars[cls.carIdx[k]].irating ) / br1 );
+            f[k] = 1.0 - e[k];
+        }
+
+        // Chance that i finishes ahead of j, summed over the class including i itself (which is 0.5)
+        for( int i=0; i<cls.numCars; ++i )
+        {
+            double sum = 0;
+            for( int j=0; j<cls.numCars; ++j )
+                sum += f[i]*e[j] / (f[i]*e[j] + f[j]*e[i]);
+
+            const int carIdx = cls.carIdx[i];
+            m_expected[carIdx] = float( sum - 0.5 );
+            m_classSize[carIdx] = cls.numCars;
+        }
+    }
+
+    m_expectedRebuilds++;
+}
+
+void IRatingProjection::update( const Session& session, int sessionVersion, const int* classPosition )
+{
+    const bool rebuilt = sessionVersion != m_sessionVersion;
+    if( rebuilt )
+    {
+        rebuildExpected( session );
+        m_sessionVersion = sessionVersion;
+    }
+
+    for( int k=0; k<session.numActiveCars; ++k )
+    {
+        const int carIdx = session.activeCarIdx[k];
+        const int pos    = m_classSize[carIdx] ? classPosition[carIdx] : 0;
+
+        if( !rebuilt && pos == m_classPosition[carIdx] )
+            continue;
+        m_classPosition[carIdx] = pos;
+
+        if( pos <= 0 ) {
+            m_change[carIdx] = 0;
+            continue;
+        }
+
+        const float n     = (float)m_classSize[carIdx];
+        const float fudge = (n/2 - pos) / 100.0f;
+        m_change[carIdx] = (n - pos - m_expected[carIdx] - fudge) * 200.0f / n;
+        m_changeUpdates++;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+// Projected iRating change for every driver if the race finished in the current order, with the
+// usual pairwise expected-score model, per class. The expected scores only depend on who's in the
+// field, so the O(n^2) part is redone once per session update. Between those, a position change
+// costs O(1) for the car that moved.
+class IRatingProjection
+{
+    public:
+
+        IRatingProjection() { reset(); }
+
+        void reset();
+
+        // Call once per tick. 'classPosition' is 1-based, 0 for cars without a position.
+        void update( const Session& session, int sessionVersion, const int* classPosition );
+
+        bool  has( int carIdx ) const { return carIdx >= 0 && carIdx < IR_MAX_CARS && m_classPosition[carIdx] > 0; }
+        float change( int carIdx ) const { return m_change[carIdx]; }
+
+        int   expectedRebuilds() const { return m_expectedRebuilds; }
+        int   changeUpdates() const { return m_changeUpdates; }
+
+    private:
+
+        void  rebuildExpected( const Session& session );
+
+        float   m_expected[IR_MAX_CARS];    // how many in the class this car is expected to beat
+        int     m_classSize[IR_MAX_CARS];
+        int     m_classPosition[IR_MAX_CARS];
+        float   m_change[IR_MAX_CARS];
+        int     m_sessionVersion;
+        int     m_expectedRebuilds;
+        int     m_changeUpdates;
+};
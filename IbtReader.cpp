@@ -0,0 +1,178 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <memory>
+#include "irsdk/irsdk_defines.h"
+#include "IbtReader.h"
+
+// Value of a telemetry channel in one row, whatever its type. 'vh' may be null.
+static double getValue( const char* row, const irsdk_varHeader* vh, double def )
+{
+    if( !vh )
+        return def;
+
+    const char* p = row + vh->offset;
+    switch( vh->type )
+    {
+        case irsdk_char:
+        case irsdk_bool:     return (double)*(const unsigned char*)p;
+        case irsdk_int:
+        case irsdk_bitField: { int v; memcpy( &v, p, sizeof(v) ); return v; }
+        case irsdk_float:    { float v; memcpy( &v, p, sizeof(v) ); return v; }
+        case irsdk_double:   { double v; memcpy( &v, p, sizeof(v) ); return v; }
+        default:             return def;
+    }
+}
+
+bool ir_loadIbtBestLap( const std::string& filename, RefLap& out, const std::atomic<bool>* cancel )
+{
+    out.valid = false;
+
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if( !fp )
+        return false;
+
+    // irsdk_header, then irsdk_diskSubHeader, then the variable headers and rows where the header says
+    irsdk_header hdr;
+    irsdk_diskSubHeader sub;
+    bool ok = fread( &hdr, sizeof(hdr), 1, fp ) == 1 && fread( &sub, sizeof(sub), 1, fp ) == 1;
+    ok = ok && hdr.numVars > 0 && hdr.bufLen > 0 && sub.sessionRecordCount > 0;
+
+    std::vector<irsdk_varHeader> vars( ok ? hdr.numVars : 0 );
+    ok = ok && fseek( fp, hdr.varHeaderOffset, SEEK_SET ) == 0;
+    ok = ok && fread( vars.data(), sizeof(irsdk_varHeader), vars.size(), fp ) == vars.size();
+    if( !ok ) {
+        fclose( fp );
+        return false;
+    }
+
+    auto find = [&]( const char* name ) -> const irsdk_varHeader* {
+        for( const irsdk_varHeader& vh : vars ) {
+            if( !strncmp( vh.name, name, IRSDK_MAX_STRING ) && vh.offset >= 0 && vh.offset + irsdk_VarTypeBytes[vh.type] <= hdr.bufLen )
+                return &vh;
+        }
+        return nullptr;
+    };
+    const irsdk_varHeader* sessionTime = find( "SessionTime" );
+    const irsdk_varHeader* lapDistPct  = find( "LapDistPct" );
+    const irsdk_varHeader* onPitRoad   = find( "OnPitRoad" );
+    const irsdk_varHeader* surface     = find( "PlayerTrackSurface" );
+    if( !sessionTime || !lapDistPct || fseek( fp, hdr.varBuf[0].bufOffset, SEEK_SET ) != 0 ) {
+        fclose( fp );
+        return false;
+    }
+
+    std::unique_ptr<RefLapRecorder> rec( new RefLapRecorder() );
+    std::vector<char> row( hdr.bufLen );
+    for( int i=0; i<sub.sessionRecordCount; ++i )
+    {
+        if( cancel && *cancel ) {
+            fclose( fp );
+            return false;
+        }
+        if( fread( row.data(), row.size(), 1, fp ) != 1 )
+            break;
+
+        const bool clean = !getValue( row.data(), onPitRoad, 0 ) && getValue( row.data(), surface, irsdk_OnTrack ) != irsdk_OffTrack;
+        rec->update( getValue( row.data(), sessionTime, 0 ), (float)getValue( row.data(), lapDistPct, -1 ), clean );
+    }
+    fclose( fp );
+
+    out = rec->ref( RefLapKind::BEST );
+    return out.valid;
+}
+
+RefLapLoader::~RefLapLoader()
+{
+    if( !m_thread.joinable() )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk( m_mutex );
+        m_quit = true;
+        m_cancel = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+void RefLapLoader::post( const std::string& filename )
+{
+    {
+        std::lock_guard<std::mutex> lk( m_mutex );
+
+        m_pending = filename;
+        m_havePending = true;
+        m_haveDone = false;
+        m_cancel = true;    // whatever is being read now is out of date
+
+        if( !m_thread.joinable() )
+            m_thread = std::thread( &RefLapLoader::loaderThread, this );
+    }
+    m_cv.notify_one();
+}
+
+bool RefLapLoader::poll( std::string& filename, RefLap& lap )
+{
+    std::lock_guard<std::mutex> lk( m_mutex );
+    if( !m_haveDone )
+        return false;
+
+    filename = m_doneFilename;
+    lap = m_done;
+    m_haveDone = false;
+    return true;
+}
+
+void RefLapLoader::loaderThread()
+{
+    while( true )
+    {
+        std::string filename;
+        {
+            std::unique_lock<std::mutex> lk( m_mutex );
+            m_cv.wait( lk, [this]() { return m_quit || m_havePending; } );
+            if( m_quit )
+                break;
+            filename = m_pending;
+            m_havePending = false;
+            m_cancel = false;
+        }
+
+        RefLap lap;
+        const bool ok = ir_loadIbtBestLap( filename, lap, &m_cancel );
+
+        std::lock_guard<std::mutex> lk( m_mutex );
+        if( m_cancel )
+            continue;   // superseded, or quitting
+        if( !ok )
+            printf( "Could not load a reference lap from %s\n", filename.c_str() );
+        m_doneFilename = filename;
+        m_done = lap;
+        m_haveDone = true;
+    }
+}
@@ -0,0 +1,66 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "ReferenceLap.h"
+
+// Best clean lap in an iRacing telemetry file (.ibt), run through the same recorder as live laps.
+// Needs the SessionTime and LapDistPct channels, OnPitRoad and PlayerTrackSurface are used if present.
+// Gives up early (returning false) once 'cancel' is set.
+bool ir_loadIbtBestLap( const std::string& filename, RefLap& out, const std::atomic<bool>* cancel = nullptr );
+
+// Reads .ibt files on a background thread, since they can be hundreds of MB. Only the latest request
+// counts: a file that's still being read when a new one is posted is abandoned.
+class RefLapLoader
+{
+    public:
+
+        ~RefLapLoader();    // abandons whatever is still loading
+
+        void  post( const std::string& filename );
+
+        // True once a load has finished, with the file it was for. 'lap' isn't valid if the file couldn't be read.
+        bool  poll( std::string& filename, RefLap& lap );
+
+    private:
+
+        void  loaderThread();
+
+        std::thread                 m_thread;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_cv;
+        std::string                 m_pending;
+        bool                        m_havePending = false;
+        std::string                 m_doneFilename;
+        RefLap                      m_done;
+        bool                        m_haveDone = false;
+        bool                        m_quit = false;
+        std::atomic<bool>           m_cancel = {false};
+};
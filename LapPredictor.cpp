@@ -0,0 +1,128 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "LapPredictor.h"
+
+#if defined(_M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 2 || defined(__SSE2__)
+#define IR_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+void LapPredictor::reset()
+{
+    *this = LapPredictor();
+}
+
+void LapPredictor::addSample( double sessionTime, double arrivalTime, const float* lapDistPct, const float* lapSpeed, const float* estTime, const int* lap )
+{
+    const float dt = float( sessionTime - m_sessionTime );
+    const bool  haveSpeed = m_sessionTime >= 0 && dt > 0 && dt < 1.0f;
+    const float smooth = 0.5f;
+
+    for( int i=0; i<IR_MAX_CARS; ++i )
+    {
+        const float pct = lapDistPct[i];
+        const float est = estTime[i];
+
+        if( !haveSpeed || pct < 0 || m_pct[i] < 0 )
+        {
+            // Paused, first row, or the car just appeared/disappeared. Don't move it.
+            m_pctVel[i] = 0;
+            m_estVel[i] = 0;
+        }
+        else
+        {
+            float dpct = pct - m_pct[i];
+            if( dpct < -0.5f ) dpct += 1.0f;   // crossed the line
+            if( dpct >  0.5f ) dpct -= 1.0f;   // backwards across the line
+
+            // Without a speed yet (first rows, or just snapped) there's nothing to predict from.
+            // Comparing against standing still would snap again on every row once a car covers
+            // more than SnapPct between rows. Jumps no car can drive have no speed in RaceState.
+            const float err = m_pctVel[i] == 0 ? 0 : dpct - m_pctVel[i] * dt;
+            if( fabsf(err) > SnapPct || dpct < 0 )
+            {
+                if( m_pctVel[i] != 0 )
+                    m_numSnaps++;
+                m_pctVel[i] = 0;
+                m_estVel[i] = 0;
+            }
+            else
+            {
+                m_pctVel[i] = std::max( 0.0f, lapSpeed[i] );
+
+                // The estimated time wraps at the line like lapDistPct, but by a lap time we don't know
+                // here. Keep the old speed across it.
+                const float dest = est - m_est[i];
+                if( dest >= 0 )
+                    m_estVel[i] = m_estVel[i] == 0 ? dest / dt : smooth * m_estVel[i] + (1-smooth) * dest / dt;
+            }
+        }
+
+        m_pct[i] = pct;
+        m_est[i] = est;
+        m_lap[i] = lap[i];
+    }
+
+    m_sessionTime = sessionTime;
+    m_arrivalTime = arrivalTime;
+}
+
+void LapPredictor::predict( double renderTime, float* lapDistPct, float* estTime, int* lap ) const
+{
+    float dt = float( renderTime - m_arrivalTime );
+    dt = dt < 0 ? 0 : (dt > MaxHorizon ? MaxHorizon : dt);
+
+    // Cars off track have zero speed, so they stay where they are (< 0).
+    // Across the line, est time restarts from 0 roughly in proportion to lapDistPct: est*(pct-1)/pct
+#ifdef IR_HAVE_SSE2
+    const __m128 vdt = _mm_set1_ps( dt );
+    const __m128 one = _mm_set1_ps( 1.0f );
+    for( int i=0; i<IR_MAX_CARS; i+=4 )
+    {
+        const __m128 pct     = _mm_add_ps( _mm_loadu_ps(m_pct+i), _mm_mul_ps(_mm_loadu_ps(m_pctVel+i), vdt) );
+        const __m128 est     = _mm_add_ps( _mm_loadu_ps(m_est+i), _mm_mul_ps(_mm_loadu_ps(m_estVel+i), vdt) );
+        const __m128 wrapped = _mm_cmpge_ps( pct, one );     // all bits set where wrapped
+        const __m128 w       = _mm_and_ps( wrapped, one );
+
+        _mm_storeu_ps( lapDistPct+i, _mm_sub_ps(pct, w) );
+        _mm_storeu_ps( estTime+i, _mm_sub_ps(est, _mm_div_ps(_mm_mul_ps(w, est), _mm_max_ps(pct, one))) );
+        _mm_storeu_si128( (__m128i*)(lap+i), _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(m_lap+i)), _mm_castps_si128(wrapped)) );
+    }
+#else
+    for( int i=0; i<IR_MAX_CARS; ++i )
+    {
+        const float pct     = m_pct[i] + m_pctVel[i] * dt;
+        const float est     = m_est[i] + m_estVel[i] * dt;
+        const int   wrapped = pct >= 1.0f;
+        const float w       = (float)wrapped;
+
+        lapDistPct[i] = pct - w;
+        estTime[i]    = est - w * est / std::max( pct, 1.0f );
+        lap[i]        = m_lap[i] + wrapped;
+    }
+#endif
+}
@@ -0,0 +1,64 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+// Extrapolates each car's CarIdxLapDistPct and CarIdxEstTime from the last telemetry row to the time
+// a frame is rendered, so cars move smoothly when we render faster than the sim's 60Hz telemetry.
+//
+// Along-track speeds come from RaceState (derived from the sim's SessionTime, which doesn't jitter
+// like our clock does). When a new row is far off from what we predicted (tow, reset, spin, pit
+// entry), the car snaps to the new data and stands still until the next row.
+class LapPredictor
+{
+    public:
+
+        static constexpr float MaxHorizon = 0.05f;     // never extrapolate further than this (s), in case telemetry stalls
+        static constexpr float SnapPct    = 0.002f;    // prediction error (fraction of a lap) above which a car snaps
+
+        void reset();
+
+        // A new telemetry row. 'sessionTime' is the row's SessionTime, 'arrivalTime' our own clock (s)
+        // when we got it, the same clock that gets passed to predict(). 'lapSpeed' in laps/s, see RaceState::lapSpeed.
+        void addSample( double sessionTime, double arrivalTime, const float* lapDistPct, const float* lapSpeed, const float* estTime, const int* lap );
+
+        // Positions at 'renderTime'. Cars that aren't on track keep their (negative) lapDistPct.
+        // When a prediction passes the start/finish line, lap is incremented and lapDistPct wraps.
+        void predict( double renderTime, float* lapDistPct, float* estTime, int* lap ) const;
+
+        int  numSnaps() const { return m_numSnaps; }
+
+    private:
+
+        float   m_pct[IR_MAX_CARS] = {};
+        float   m_est[IR_MAX_CARS] = {};
+        int     m_lap[IR_MAX_CARS] = {};
+        float   m_pctVel[IR_MAX_CARS] = {};     // laps/s
+        float   m_estVel[IR_MAX_CARS] = {};     // s/s
+        double  m_sessionTime = -1;
+        double  m_arrivalTime = 0;
+        int     m_numSnaps = 0;
+};
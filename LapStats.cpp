@@ -0,0 +1,238 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "LapStats.h"
+
+void RunningStats::add( double x )
+{
+    n++;
+    const double d = x - mean;
+    mean += d / n;
+    m2 += d * (x - mean);
+}
+
+float RunningStats::stddev() const
+{
+    return sqrtf( variance() );
+}
+
+void P2Quantile::reset( float p )
+{
+    m_p = p;
+    m_count = 0;
+    for( int i=0; i<5; ++i ) {
+        m_q[i] = 0;
+        m_n[i] = i;
+    }
+    m_np[0] = 0;
+    m_np[1] = 2*p;
+    m_np[2] = 4*p;
+    m_np[3] = 2+2*p;
+    m_np[4] = 4;
+}
+
+void P2Quantile::add( float x )
+{
+    if( m_count < 5 )
+    {
+        m_q[m_count++] = x;
+        if( m_count == 5 )
+            std::sort( m_q, m_q+5 );
+        return;
+    }
+    m_count++;
+
+    // Find the cell the sample falls into, extending the range if needed
+    int k;
+    if( x < m_q[0] ) {
+        m_q[0] = x;
+        k = 0;
+    }
+    else if( x >= m_q[4] ) {
+        m_q[4] = x;
+        k = 3;
+    }
+    else {
+        k = 0;
+        while( x >= m_q[k+1] )
+            k++;
+    }
+
+    for( int i=k+1; i<5; ++i )
+        m_n[i]++;
+
+    const float dn[5] = { 0, m_p/2, m_p, (1+m_p)/2, 1 };
+    for( int i=0; i<5; ++i )
+        m_np[i] += dn[i];
+
+    // Move the middle markers if they're off by one or more, but never onto a neighbour
+    for( int i=1; i<4; ++i )
+    {
+        const float d = m_np[i] - m_n[i];
+        if( (d >= 1 && m_n[i+1]-m_n[i] > 1) || (d <= -1 && m_n[i-1]-m_n[i] < -1) )
+        {
+            const int s = d >= 0 ? 1 : -1;
+            const float qp = m_q[i] + float(s) / (m_n[i+1]-m_n[i-1]) *
+                ( (m_n[i]-m_n[i-1]+s) * (m_q[i+1]-m_q[i]) / (m_n[i+1]-m_n[i]) +
+                  (m_n[i+1]-m_n[i]-s) * (m_q[i]-m_q[i-1]) / (m_n[i]-m_n[i-1]) );
+
+            if( m_q[i-1] < qp && qp < m_q[i+1] )
+                m_q[i] = qp;
+            else
+                m_q[i] += s * (m_q[i+s]-m_q[i]) / (m_n[i+s]-m_n[i]);
+            m_n[i] += s;
+        }
+    }
+}
+
+float P2Quantile::estimate() const
+{
+    if( m_count >= 5 )
+        return m_q[2];
+    if( !m_count )
+        return 0;
+
+    float q[5];
+    std::copy( m_q, m_q+m_count, q );
+    std::sort( q, q+m_count );
+    return q[int( m_p*(m_count-1) + 0.5f )];
+}
+
+void LapStats::reset()
+{
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        m_race[carIdx] = LapStatSet();
+        m_stint[carIdx] = LapStatSet();
+        m_numRecent[carIdx] = 0;
+        m_prevLapCompleted[carIdx] = -1;
+        m_prevLastLapTime[carIdx] = 0;
+        m_prevOnPitRoad[carIdx] = false;
+        m_dirty[carIdx] = true;
+        m_pending[carIdx] = false;
+        m_pendingDirty[carIdx] = false;
+        m_pendingPrevTime[carIdx] = 0;
+        m_pendingSince[carIdx] = 0;
+    }
+    m_activeMask = 0;
+    m_lastTime = -1;
+}
+
+void LapStats::add( LapStatSet& s, float t )
+{
+    s.stats.add( t );
+    s.median.add( t );
+    if( s.best <= 0 || t < s.best )
+        s.best = t;
+}
+
+float LapStats::recentPace( int carIdx ) const
+{
+    if( carIdx < 0 || carIdx >= IR_MAX_CARS || !m_numRecent[carIdx] )
+        return 0;
+
+    float t[RecentLaps];
+    const int n = std::min( m_numRecent[carIdx], int(RecentLaps) );
+    std::copy( m_recent[carIdx], m_recent[carIdx]+n, t );
+    std::sort( t, t+n );
+    return n & 1 ? t[n/2] : (t[n/2-1] + t[n/2]) / 2;
+}
+
+void LapStats::update( double sessionTime, const Session& session, const int* lapCompleted, const float* lastLapTime, const bool* onPitRoad, const bool* inWorld, bool caution, unsigned long long validMask )
+{
+    // Session time going backwards means a new session (or a replay jump)
+    if( sessionTime < m_lastTime )
+        reset();
+    m_lastTime = sessionTime;
+
+    // Cars that left aren't looked at anymore, so they start over like a first sighting should they come back
+    if( const unsigned long long gone = m_activeMask & ~session.activeMask )
+    {
+        for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx ) {
+            if( (gone >> carIdx) & 1 ) {
+                m_prevLapCompleted[carIdx] = -1;
+                m_pending[carIdx] = false;
+            }
+        }
+    }
+    m_activeMask = session.activeMask;
+
+    for( int i=0; i<session.numActiveCars; ++i )
+    {
+        const int carIdx = session.activeCarIdx[i];
+
+        if( !((validMask >> carIdx) & 1) ) {
+            m_prevLapCompleted[carIdx] = -1;
+            m_pending[carIdx] = false;
+            continue;
+        }
+
+        const bool pit = onPitRoad[carIdx];
+        const int  lc  = lapCompleted[carIdx];
+
+        // A new stint starts when the car enters pit road
+        if( pit && !m_prevOnPitRoad[carIdx] )
+            m_stint[carIdx] = LapStatSet();
+        m_prevOnPitRoad[carIdx] = pit;
+
+        if( m_prevLapCompleted[carIdx] < 0 )
+        {
+            // First sighting, we didn't see the lap in progress start
+            m_dirty[carIdx] = true;
+        }
+        else if( lc > m_prevLapCompleted[carIdx] )
+        {
+            // Skipped laps (tow, disconnect) can't be attributed
+            m_pending[carIdx] = true;
+            m_pendingDirty[carIdx] = m_dirty[carIdx] || lc > m_prevLapCompleted[carIdx]+1;
+            m_pendingPrevTime[carIdx] = m_prevLastLapTime[carIdx];
+            m_pendingSince[carIdx] = sessionTime;
+            m_dirty[carIdx] = false;
+        }
+        m_prevLapCompleted[carIdx] = lc;
+        m_dirty[carIdx] = m_dirty[carIdx] || pit || caution || !inWorld[carIdx];
+
+        const float t = lastLapTime[carIdx];
+        if( m_pending[carIdx] )
+        {
+            if( t != m_pendingPrevTime[carIdx] )
+            {
+                if( t > 0 && !m_pendingDirty[carIdx] ) {
+                    add( m_race[carIdx], t );
+                    add( m_stint[carIdx], t );
+                    m_recent[carIdx][m_numRecent[carIdx]++ % RecentLaps] = t;
+                }
+                m_pending[carIdx] = false;
+            }
+            else if( sessionTime - m_pendingSince[carIdx] > 5.0 )
+            {
+                // No lap time came, e.g. an invalidated lap
+                m_pending[carIdx] = false;
+            }
+        }
+        m_prevLastLapTime[carIdx] = t;
+    }
+}
@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+// Mean and variance in one pass (Welford), numerically stable for any number of samples.
+struct RunningStats
+{
+    int     n = 0;
+    double  mean = 0;
+    double  m2 = 0;     // sum of squared differences from the mean
+
+    void  add( double x );
+    float variance() const { return n > 1 ? float( m2 / (n-1) ) : 0; }
+    float stddev() const;
+};
+
+// Streaming estimate of a quantile with five markers, after Jain & Chlamtac's P-square algorithm.
+// Exact for the first five samples, then the markers are nudged towards their ideal positions
+// with a parabolic fit. Memory doesn't grow with the number of samples.
+class P2Quantile
+{
+    public:
+
+        explicit P2Quantile( float p = 0.5f ) { reset( p ); }
+
+        void  reset( float p );
+        void  add( float x );
+        float estimate() const;
+        int   count() const { return m_count; }
+
+    private:
+
+        float   m_p;
+        int     m_count;
+        float   m_q[5];     // marker heights
+        int     m_n[5];     // marker positions
+        float   m_np[5];    // desired marker positions
+};
+
+struct LapStatSet
+{
+    RunningStats    stats;
+    P2Quantile      median;
+    float           best = 0;
+
+    int   numLaps() const { return stats.n; }
+    float mean() const { return float( stats.mean ); }
+    float stddev() const { return stats.stddev(); }
+};
+
+// Lap time statistics for every car, over the whole session and over the current stint (since the
+// car last left pit road). Only clean laps count: no pit road, no caution and no trip out of the
+// world while the lap was run. Lap completions are seen in CarIdxLapCompleted; the matching time only
+// shows up in CarIdxLastLapTime a little later, so it's picked up once that changes.
+class LapStats
+{
+    public:
+
+        static const int RecentLaps = 5;
+
+        LapStats() { reset(); }
+
+        void reset();
+
+        // Call once per tick. 'caution' should be true under yellow and during pacing. Only the session's
+        // active cars are looked at.
+        void update( double sessionTime, const Session& session, const int* lapCompleted, const float* lastLapTime, const bool* onPitRoad, const bool* inWorld, bool caution, unsigned long long validMask );
+
+        const LapStatSet& race( int carIdx ) const { return m_race[carIdx]; }
+        const LapStatSet& stint( int carIdx ) const { return m_stint[carIdx]; }
+
+        // Median of the last few clean laps, 0 if there are none
+        float recentPace( int carIdx ) const;
+
+    private:
+
+        void add( LapStatSet& s, float t );
+
+        LapStatSet  m_race[IR_MAX_CARS];
+        LapStatSet  m_stint[IR_MAX_CARS];
+        float       m_recent[IR_MAX_CARS][RecentLaps];
+        int         m_numRecent[IR_MAX_CARS];
+        int         m_prevLapCompleted[IR_MAX_CARS];
+        float       m_prevLastLapTime[IR_MAX_CARS];
+        bool        m_prevOnPitRoad[IR_MAX_CARS];
+        bool        m_dirty[IR_MAX_CARS];           // lap in progress doesn't count
+        bool        m_pending[IR_MAX_CARS];         // completed lap waiting for its time
+        bool        m_pendingDirty[IR_MAX_CARS];
+        float       m_pendingPrevTime[IR_MAX_CARS]; // CarIdxLastLapTime when the lap was completed
+        double      m_pendingSince[IR_MAX_CARS];
+        unsigned long long m_activeMask;            // session.activeMask at the last update
+        double      m_lastTime;
+};
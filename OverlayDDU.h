@@ -26,7 +26,6 @@ SOFTWARE.
 
 #include <vector>
 #include <algorithm>
-#include <deque>
 #include "Overlay.h"
 #include "iracing.h"
 #include "Config.h"
@@ -78,6 +77,17 @@ class OverlayDDU : public Overlay
 
         virtual void onConfigChanged()
         {
+            // What the delta box compares against: the sim's session best, or one of our reference laps
+            {
+                const std::string ref = g_cfg.getString( m_name, "reference_lap", "session_best" );
+                m_refLapKind = -1;
+                for( int i=0; i<(int)_countof(RefLapKindStr); ++i )
+                {
+                    if( ref == RefLapKindStr[i] )
+                        m_refLapKind = i;
+                }
+            }
+
             // Font stuff
             {
                 m_text.reset( m_dwriteFactory.Get() );
@@ -145,7 +155,7 @@ class OverlayDDU : public Overlay
                 m_boxGear = makeBox( 0.5f-gearw/2, gearw, vtop, 0.53f, "" );
                 addBoxFigure( geometrySink.Get(), m_boxGear );
 
-                m_boxDelta = makeBox( 0.5f-gearw/2, gearw, vtop+2*vgap+2*h1, h1, "vs Best" );
+                m_boxDelta = makeBox( 0.5f-gearw/2, gearw, vtop+2*vgap+2*h1, h1, deltaTitle() );
                 addBoxFigure( geometrySink.Get(), m_boxDelta );
             
                 m_boxBest = makeBox( 0.5f-gearw/2-hgap-w2, w2, vtop, h1, "Best" );
@@ -191,11 +201,6 @@ class OverlayDDU : public Overlay
             }
         }
 
-        virtual void onSessionChanged()
-        {
-            m_isValidFuelLap = false;  // avoid confusing the fuel calculator logic with session changes
-        }
-
         virtual void onUpdate()
         {
             const float  fontSize           = g_cfg.getFloat( m_name, "font_size", DefaultFontSize );
@@ -212,21 +217,22 @@ class OverlayDDU : public Overlay
 
             const DWORD tickCount = GetTickCount();
 
-            // Figure out who's P1
-            int p1carIdx = -1;
-            for( int i=0; i<IR_MAX_CARS; ++i )
-            {
-                if( ir_getPosition(i) == 1 ) {
-                    p1carIdx = i;
-                    break;
-                }
-            }
+            // Timing and positions follow the focus car (us, or the camera car when spectating), the car's own
+            // telemetry (fuel, tires, rpm, ...) is only available for our car
+            const int  focusIdx   = ir_getFocusCarIdx();
+            const bool isFocusSelf = focusIdx == carIdx;
+
+            // Figure out who's P1 in our class (which is everyone in single-class sessions)
+            const bool multiClass = ir_session.numClasses > 1;
+            const RaceState& rs   = ir_raceState;
+            const int  p1carIdx   = rs.classLeader( ir_session, focusIdx );
 
             // General lap info
-            const bool   sessionIsTimeLimited  = ir_SessionLapsTotal.getInt() == 32767 && ir_SessionTimeRemain.getDouble()<48.0*3600.0;  // most robust way I could find to figure out whether this is a time-limited session (info in session string is often misleading)
+            const bool   sessionIsTimeLimited  = ir_isSessionTimeLimited();
             const double remainingSessionTime  = sessionIsTimeLimited ? ir_SessionTimeRemain.getDouble() : -1;
-            const int    remainingLaps         = sessionIsTimeLimited ? int(0.5+remainingSessionTime/ir_estimateLaptime()) : (ir_SessionLapsRemainEx.getInt() != 32767 ? ir_SessionLapsRemainEx.getInt() : -1);
-            const int    currentLap            = ir_isPreStart() ? 0 : std::max(0,ir_CarIdxLap.getInt(carIdx));
+            const RaceEndProjection& raceEnd   = ir_raceEnd;    // projected from the leader's pace in ir_tick()
+            const int    remainingLaps         = ir_remainingLaps;
+            const int    currentLap            = ir_isPreStart() || carIdx < 0 ? 0 : std::max(0,rs.lap[carIdx]);
             const bool   lapCountUpdated       = currentLap != m_prevCurrentLap;
             m_prevCurrentLap = currentLap;
             if( lapCountUpdated )
@@ -329,6 +335,8 @@ class OverlayDDU : public Overlay
 
                 if( remainingLaps < 0 )
                     sprintf( lapsStr, "--" );
+                else if( sessionIsTimeLimited && raceEnd.valid )
+                    sprintf( lapsStr, "~%.1f", raceEnd.lapsToGo );
                 else if( sessionIsTimeLimited )
                     sprintf( lapsStr, "~%d", remainingLaps );
                 else
@@ -341,7 +349,7 @@ class OverlayDDU : public Overlay
 
             // Position
             {
-                const int pos = ir_getPosition( ir_session.driverCarIdx );
+                const int pos = focusIdx < 0 ? 0 : (multiClass ? rs.classPosition[focusIdx] : rs.position[focusIdx]);
                 if( pos )
                 {
                     swprintf( s, _countof(s), L"%d", pos );
@@ -351,7 +359,7 @@ class OverlayDDU : public Overlay
 
             // Lap Delta
             {
-                const int lapDelta = ir_getLapDeltaToLeader( ir_session.driverCarIdx, p1carIdx );
+                const int lapDelta = focusIdx < 0 ? 0 : rs.lapDeltaToClassLeader[focusIdx];
                 if( lapDelta )
                 {
                     swprintf( s, _countof(s), L"%d", lapDelta );
@@ -361,27 +369,26 @@ class OverlayDDU : public Overlay
 
             // Best time
             {
-                // Figure out if we have the fastest lap across all cars
+                // Figure out if we have the fastest lap in our class (which is all cars in single-class sessions)
                 bool haveFastestLap = false;
+                if( focusIdx >= 0 && ir_session.cars[focusIdx].classIdx >= 0 )
                 {
+                    const CarClass& cls = ir_session.classes[ir_session.cars[focusIdx].classIdx];
                     int fastestLapCarIdx = -1;
                     float fastest = FLT_MAX;
-                    for( int i=0; i<IR_MAX_CARS; ++i )
+                    for( int j=0; j<cls.numCars; ++j )
                     {
-                        const Car& car = ir_session.cars[i];
-                        if( car.isPaceCar || car.isSpectator || car.userName.empty() )
-                            continue;
-
-                        const float best = ir_CarIdxBestLapTime.getFloat(i);
+                        const int i = cls.carIdx[j];
+                        const float best = rs.best[i];
                         if( best > 0 && best < fastest ) {
                             fastest = best;
                             fastestLapCarIdx = i;
                         }
                     }
-                    haveFastestLap = fastestLapCarIdx == ir_session.driverCarIdx;
+                    haveFastestLap = fastestLapCarIdx == focusIdx;
                 }
 
-                const float t = ir_LapBestLapTime.getFloat();
+                const float t = isFocusSelf ? ir_LapBestLapTime.getFloat() : (focusIdx >= 0 ? rs.best[focusIdx] : 0);
                 if( t > 0 )
                 {
                     bool vsb = true;
@@ -405,7 +412,7 @@ class OverlayDDU : public Overlay
 
             // Last time
             {
-                const float t = ir_LapLastLapTime.getFloat();
+                const float t = isFocusSelf ? ir_LapLastLapTime.getFloat() : (focusIdx >= 0 ? rs.last[focusIdx] : 0);
                 if( t > 0 )
                 {
                     std::string str = formatLaptime( t );
@@ -417,7 +424,7 @@ class OverlayDDU : public Overlay
             {                
                 if( p1carIdx >= 0 )
                 {
-                    const float t = ir_CarIdxLastLapTime.getFloat( p1carIdx );
+                    const float t = rs.last[p1carIdx];
                     if( t > 0 )
                     {
                         std::string str = formatLaptime( t );
@@ -451,48 +458,35 @@ class OverlayDDU : public Overlay
                 m_text.render( m_renderTarget.Get(), L"Fin+", m_textFormatSmall.Get(), m_boxFuel.x0+xoff, m_boxFuel.x1, m_boxFuel.y0+m_boxFuel.h*8.7f/12.0f, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_LEADING );
                 m_text.render( m_renderTarget.Get(), L"Add", m_textFormatSmall.Get(), m_boxFuel.x0+xoff, m_boxFuel.x1, m_boxFuel.y0+m_boxFuel.h*10.5f/12.0f, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_LEADING );
 
-                const float estimateFactor = g_cfg.getFloat( m_name, "fuel_estimate_factor", 1.1f );
                 const float remainingFuel  = ir_FuelLevel.getFloat();
 
-                // Update average fuel consumption tracking. Ignore laps that weren't entirely under green or where we pitted.
-                float avgPerLap = 0;
-                {
-                    if( lapCountUpdated )
-                    {
-                        const float usedLastLap = std::max( 0.0f, m_lapStartRemainingFuel - remainingFuel );
-                        m_lapStartRemainingFuel = remainingFuel;
-
-                        if( m_isValidFuelLap )
-                            m_fuelUsedLastLaps.push_back( usedLastLap );
-
-                        const int numLapsToAvg = g_cfg.getInt( m_name, "fuel_estimate_avg_green_laps", 4 );
-                        while( m_fuelUsedLastLaps.size() > numLapsToAvg )
-                            m_fuelUsedLastLaps.pop_front();
-
-                        m_isValidFuelLap = true;
-                    }
-                    if( (ir_SessionFlags.getInt() & (irsdk_yellow|irsdk_yellowWaving|irsdk_red|irsdk_checkered|irsdk_crossed|irsdk_oneLapToGreen|irsdk_caution|irsdk_cautionWaving|irsdk_disqualify|irsdk_repair)) || ir_CarIdxOnPitRoad.getBool(carIdx) )
-                        m_isValidFuelLap = false;
-                    
-                    for( float v : m_fuelUsedLastLaps ) {
-                        avgPerLap += v;
-                        dbg("%f",v);
-                    }
-                    if( !m_fuelUsedLastLaps.empty() )
-                        avgPerLap /= (float)m_fuelUsedLastLaps.size();
-
-                    dbg( "valid fuel lap: %d", (int)m_isValidFuelLap );
-                }
+                const FuelEstimate& fuel = ir_fuelModel.estimate();
+                const float avgPerLap     = fuel.perLap;
+                const float perLapConsEst = fuel.perLapConservative;  // conservative estimate of per-lap use for further calculations
 
                 // Est Laps
-                const float perLapConsEst = avgPerLap * estimateFactor;  // conservative estimate of per-lap use for further calculations
                 if( perLapConsEst > 0 )
                 {
-                    const float estLaps = remainingFuel / perLapConsEst;
+                    const float estLaps = fuel.lapsRemaining;
                     swprintf( s, _countof(s), L"%.*f", estLaps<10?1:0, estLaps );
                     m_text.render( m_renderTarget.Get(), s, m_textFormatBold.Get(), m_boxFuel.x0, m_boxFuel.x1-xoff, m_boxFuel.y0+m_boxFuel.h*2.8f/12.0f, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
                 }
 
+                // Pit window, and what we'd have to get down to per lap to save a stop
+                if( fuel.minStops > 0 )
+                {
+                    float save = fuel.saveTarget;
+                    if( imperial )
+                        save *= 0.264172f;
+                    if( fuel.minStops == 1 && save > 0 )
+                        swprintf( s, _countof(s), L"PIT L%d-%d  SAVE %.2f", fuel.earliestPitLap, fuel.latestPitLap, save );
+                    else
+                        swprintf( s, _countof(s), L"PIT L%d-%d  %dx", fuel.earliestPitLap, fuel.latestPitLap, fuel.minStops );
+                    m_brush->SetColor( fuel.latestPitLap <= currentLap ? warnCol : textCol );
+                    m_text.render( m_renderTarget.Get(), s, m_textFormatVerySmall.Get(), m_boxFuel.x0, m_boxFuel.x1, m_boxFuel.y0+m_boxFuel.h*3.95f/12.0f, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+                    m_brush->SetColor( textCol );
+                }
+
                 // Remaining
                 if( remainingFuel >= 0 )
                 {
@@ -516,7 +510,7 @@ class OverlayDDU : public Overlay
                 // To Finish
                 if( remainingLaps >= 0 && perLapConsEst > 0 )
                 {
-                    float toFinish = std::max( 0.0f, remainingLaps * perLapConsEst - remainingFuel );
+                    float toFinish = fuel.toFinish;
 
                     if( toFinish > ir_PitSvFuel.getFloat() || (toFinish>0 && !ir_dpFuelFill.getFloat()) )
                         m_brush->SetColor( warnCol );
@@ -572,6 +566,25 @@ class OverlayDDU : public Overlay
                 swprintf( s, _countof(s), L"%d", (int)(rr+0.5f) );
                 m_text.render( m_renderTarget.Get(), s, m_textFormatSmall.Get(), m_boxTires.x0+m_boxTires.w/2, m_boxTires.x1-20, m_boxTires.y0+m_boxTires.h*2.0f/3.0f, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
                 m_brush->SetColor( textCol );
+
+                // First lap on which a corner wears down to the threshold. Warn if that's before the end.
+                {
+                    const float threshold = g_cfg.getFloat( m_name, "tire_wear_threshold", 30 ) / 100.0f;
+                    int thresholdLap = -1;
+                    for( int i=0; i<TireModel::NumCorners; ++i )
+                    {
+                        const int l = ir_tireModel.thresholdLap( i, threshold );
+                        if( l >= 0 && (thresholdLap < 0 || l < thresholdLap) )
+                            thresholdLap = l;
+                    }
+                    if( thresholdLap >= 0 )
+                    {
+                        m_brush->SetColor( remainingLaps >= 0 && thresholdLap < currentLap+remainingLaps ? warnCol : textCol );
+                        swprintf( s, _countof(s), L"L%d", thresholdLap );
+                        m_text.render( m_renderTarget.Get(), s, m_textFormatVerySmall.Get(), m_boxTires.x0, m_boxTires.x1, m_boxTires.y0+m_boxTires.h*0.5f, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+                        m_brush->SetColor( textCol );
+                    }
+                }
                 
                 /* TODO: why doesn't iracing report 255 here in an AI session where we DO have unlimited tire sets??
 
@@ -597,9 +610,18 @@ class OverlayDDU : public Overlay
 
             // Delta
             {
-                if( ir_LapDeltaToSessionBestLap_OK.getBool() )
+                float t = 0;
+                float predicted = 0;
+                bool  valid = false;
+                if( m_refLapKind < 0 ) {
+                    valid = ir_LapDeltaToSessionBestLap_OK.getBool();
+                    t = ir_LapDeltaToSessionBestLap.getFloat();
+                }
+                else
+                    valid = isFocusSelf && ir_refLaps.delta( (RefLapKind)m_refLapKind, &t, &predicted );
+
+                if( valid )
                 {
-                    const float t = ir_LapDeltaToSessionBestLap.getFloat();
                     swprintf( s, _countof(s), L"%+4.2f", t );
 
                     D2D1_RECT_F r = { m_boxDelta.x0, m_boxDelta.y0, m_boxDelta.x1, m_boxDelta.y1 };
@@ -607,6 +629,13 @@ class OverlayDDU : public Overlay
                     m_renderTarget->FillRectangle( &r, m_brush.Get() );
                     m_brush->SetColor( textCol );
                     m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), m_boxDelta.x0, m_boxDelta.x1, m_boxDelta.y0+m_boxDelta.h*0.5f, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+
+                    // Lap time this would make
+                    if( predicted > 0 )
+                    {
+                        swprintf( s, _countof(s), L"%S", formatLaptime(predicted).c_str() );
+                        m_text.render( m_renderTarget.Get(), s, m_textFormatVerySmall.Get(), m_boxDelta.x0, m_boxDelta.x1, m_boxDelta.y0+m_boxDelta.h*0.8f, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+                    }
                 }
             }
 
@@ -678,7 +707,7 @@ class OverlayDDU : public Overlay
                 m_text.render( m_renderTarget.Get(), L"P1 Last", m_textFormatSmall.Get(), m_boxP1Last.x0, m_boxP1Last.x1, m_boxP1Last.y0, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
                 m_text.render( m_renderTarget.Get(), L"Fuel",    m_textFormatSmall.Get(), m_boxFuel.x0, m_boxFuel.x1, m_boxFuel.y0, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
                 m_text.render( m_renderTarget.Get(), L"Tires",   m_textFormatSmall.Get(), m_boxTires.x0, m_boxTires.x1, m_boxTires.y0, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
-                m_text.render( m_renderTarget.Get(), L"vs Best", m_textFormatSmall.Get(), m_boxDelta.x0, m_boxDelta.x1, m_boxDelta.y0, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+                m_text.render( m_renderTarget.Get(), toWide(deltaTitle()).c_str(), m_textFormatSmall.Get(), m_boxDelta.x0, m_boxDelta.x1, m_boxDelta.y0, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
                 m_text.render( m_renderTarget.Get(), L"Session", m_textFormatSmall.Get(), m_boxSession.x0, m_boxSession.x1, m_boxSession.y0, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
                 m_text.render( m_renderTarget.Get(), L"Bias",    m_textFormatSmall.Get(), m_boxBias.x0, m_boxBias.x1, m_boxBias.y0, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
                 m_text.render( m_renderTarget.Get(), L"Inc",     m_textFormatSmall.Get(), m_boxInc.x0, m_boxInc.x1, m_boxInc.y0, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
@@ -713,6 +742,12 @@ class OverlayDDU : public Overlay
             }
         }
 
+        const char* deltaTitle() const
+        {
+            static const char* const titles[] = { "vs PB", "vs Last", "vs Opt", "vs Ref" };
+            return m_refLapKind >= 0 && m_refLapKind < (int)_countof(titles) ? titles[m_refLapKind] : "vs Best";
+        }
+
         float r2ax( float rx )
         {
             return rx * (float)m_width;
@@ -780,8 +815,7 @@ class OverlayDDU : public Overlay
 
         float               m_prevBestLapTime = 0;
 
-        float               m_lapStartRemainingFuel = 0;
-        std::deque<float>   m_fuelUsedLastLaps;
-        bool                m_isValidFuelLap = false;
+        int                 m_refLapKind = -1;  // RefLapKind, -1 for the sim's session best
+
 };
 
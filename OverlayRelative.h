@@ -29,6 +29,7 @@ SOFTWARE.
 #include "Overlay.h"
 #include "iracing.h"
 #include "Config.h"
+#include "RelativeKernel.h"
 
 class OverlayRelative : public Overlay
 {
@@ -40,9 +41,12 @@ class OverlayRelative : public Overlay
             : Overlay("OverlayRelative")
         {}
 
+        // Follows the camera car while spectating
+        virtual bool canEnableWhileNotDriving() const { return true; }
+
     protected:
 
-        enum class Columns { POSITION, CAR_NUMBER, NAME, DELTA, LICENSE, SAFETY_RATING, IRATING, PIT };
+        enum class Columns { POSITION, CAR_NUMBER, NAME, DELTA, TREND, LICENSE, SAFETY_RATING, IRATING, IRATING_CHANGE, PIT };
 
         virtual void onEnable()
         {
@@ -76,6 +80,9 @@ class OverlayRelative : public Overlay
             m_columns.add( (int)Columns::NAME,       0, fontSize/2 );
             m_columns.add( (int)Columns::DELTA,      computeTextExtent( L"+99L  -99.9", m_dwriteFactory.Get(), m_textFormat.Get() ).x, 1, fontSize/2 );
 
+            if( g_cfg.getBool(m_name,"show_gap_trend",false) )
+                m_columns.add( (int)Columns::TREND,         computeTextExtent( L"-9.99", m_dwriteFactory.Get(), m_textFormatSmall.Get() ).x, fontSize/4 );
+
             if( g_cfg.getBool(m_name,"show_pit_age",true) )
                 m_columns.add( (int)Columns::PIT,           computeTextExtent( L"999", m_dwriteFactory.Get(), m_textFormatSmall.Get() ).x, fontSize/4 );
             if( g_cfg.getBool(m_name,"show_license",true) && !g_cfg.getBool(m_name,"show_sr",false) )
@@ -84,6 +91,8 @@ class OverlayRelative : public Overlay
                 m_columns.add( (int)Columns::SAFETY_RATING, computeTextExtent( L"A 4.44", m_dwriteFactory.Get(), m_textFormatSmall.Get() ).x, fontSize/8 );
             if( g_cfg.getBool(m_name,"show_irating",true) )
                 m_columns.add( (int)Columns::IRATING,       computeTextExtent( L"999.9k", m_dwriteFactory.Get(), m_textFormatSmall.Get() ).x, fontSize/8 );
+            if( g_cfg.getBool(m_name,"show_irating_change",false) )
+                m_columns.add( (int)Columns::IRATING_CHANGE, computeTextExtent( L"+999", m_dwriteFactory.Get(), m_textFormatSmall.Get() ).x, fontSize/8 );
         }
 
         virtual void onUpdate()
@@ -94,80 +103,39 @@ class OverlayRelative : public Overlay
                 int     lapDelta = 0;
                 int     pitAge = 0;
             };
-            std::vector<CarInfo> relatives;
-            relatives.reserve( IR_MAX_CARS );
-
-            // Populate cars with the ones for which a relative/delta comparison is valid
-            for( int i=0; i<IR_MAX_CARS; ++i )
-            {
-                const Car& car = ir_session.cars[i];
-
-                const int lapcountS = ir_CarIdxLap.getInt(ir_session.driverCarIdx);
-                const int lapcountC = ir_CarIdxLap.getInt(i);
-
-                if( lapcountC >= 0 && !car.isSpectator && car.carNumber>=0 )
-                {
-                    // Add the pace car only under yellow or initial pace lap
-                    if( car.isPaceCar && !(ir_SessionFlags.getInt() & (irsdk_caution|irsdk_cautionWaving)) && !ir_isPreStart() )
-                        continue;
 
-                    // If the other car is up to half a lap in front, we consider the delta 'ahead', otherwise 'behind'.
-
-                    float delta = 0;
-                    int   lapDelta = lapcountC - lapcountS;
-
-                    const float L = ir_estimateLaptime();
-                    const float C = ir_CarIdxEstTime.getFloat(i);
-                    const float S = ir_CarIdxEstTime.getFloat(ir_session.driverCarIdx);
-
-                    // Does the delta between us and the other car span across the start/finish line?
-                    const bool wrap = fabsf(ir_CarIdxLapDistPct.getFloat(i) - ir_CarIdxLapDistPct.getFloat(ir_session.driverCarIdx)) > 0.5f;
-
-                    if( wrap )
-                    {
-                        delta     = S > C ? (C-S)+L : (C-S)-L;
-                        lapDelta += S > C ? -1 : 1;
-                    }
-                    else
-                    {
-                        delta = C - S;
-                    }
-
-                    // Assume no lap delta when not in a race, because we don't want to show drivers as lapped/lapping there.
-                    // Also reset it during initial pacing, since iRacing for some reason starts counting
-                    // during the pace lap but then resets the counter a couple seconds in, confusing the logic.
-                    // And consider the pace car in the same lap as us, too.
-                    if( ir_session.sessionType!=SessionType::RACE || ir_isPreStart() || car.isPaceCar )
-                    {
-                        lapDelta = 0;
-                    }
-
-                    CarInfo ci;
-                    ci.carIdx = i;
-                    ci.delta = delta;
-                    ci.lapDelta = lapDelta;
-                    ci.pitAge = ir_CarIdxLap.getInt(i) - car.lastLapInPits;
-                    relatives.push_back( ci );
-                }
-            }
-
-            // Sort by delta
-            std::sort( relatives.begin(), relatives.end(), 
-                []( const CarInfo& a, const CarInfo&b ) { return a.delta > b.delta; } );
+            // Follow our car, or the camera car when spectating (see ir_getFocusCarIdx()). The relatives
+            // for every car are computed each tick, so switching is just picking another row.
+            const RaceState&      rs      = ir_raceState;
+            const RelativeMatrix& rm      = ir_relativeMatrix;
+            const int             selfIdx = ir_getFocusCarIdx();
+            if( selfIdx < 0 || !((rm.rowMask >> selfIdx) & 1) )
+                return;
 
-            // Locate our driver's index in the new array
-            int selfCarInfoIdx = -1;
-            for( int i=0; i<(int)relatives.size(); ++i )
+            // Positions are extrapolated to now, so cars move smoothly at render rates above 60Hz.
+            // That takes recomputing the row, with the same candidates as the matrix.
+            const bool extrapolate = g_cfg.getBool( m_name, "extrapolate", true );
+            float predEstTime[IR_MAX_CARS];
+            float predLapDistPct[IR_MAX_CARS];
+            int   predLap[IR_MAX_CARS];
+            RelativeOutput predicted;
+            const RelativeOutput& rout = extrapolate ? predicted : rm.rows[selfIdx];
+            if( extrapolate )
             {
-                if( relatives[i].carIdx == ir_session.driverCarIdx ) {
-                    selfCarInfoIdx = i;
-                    break;
-                }
+                ir_predictLapPositions( predLapDistPct, predEstTime, predLap );
+
+                RelativeInput rin;
+                rin.estTime          = predEstTime;
+                rin.lapDistPct       = predLapDistPct;
+                rin.lap              = predLap;
+                rin.candidateMask    = rm.candidateMask;
+                rin.zeroLapDeltaMask = rm.zeroLapDeltaMask;
+                rin.zeroLapDeltas    = rm.zeroLapDeltas;
+                rin.selfIdx          = selfIdx;
+                rin.estLaptime       = rs.estLaptimeByCar[selfIdx];
+                ir_computeRelatives( rin, predicted );
             }
-
-            // Something's wrong if we didn't find our driver. Bail.
-            if( selfCarInfoIdx < 0 )
-                return;
+            const float* lapDistPct = extrapolate ? predLapDistPct : rs.lapDistPct;
 
             // Display such that our driver is in the vertical center of the area where we're listing cars
 
@@ -188,6 +156,10 @@ class OverlayRelative : public Overlay
             const float4 carNumberBgCol     = g_cfg.getFloat4( m_name, "car_number_background_col", float4(1,1,1,0.9f) );
             const float4 carNumberTextCol   = g_cfg.getFloat4( m_name, "car_number_text_col", float4(0,0,0,0.9f) );
             const float4 pitCol             = g_cfg.getFloat4( m_name, "pit_col", float4(0.94f,0.8f,0.13f,1) );
+            const float4 iratingGainCol     = g_cfg.getFloat4( m_name, "irating_gain_col", float4(0.2f,0.75f,0,1) );
+            const float4 iratingLossCol     = g_cfg.getFloat4( m_name, "irating_loss_col", float4(0.9f,0.17f,0.17f,1) );
+            const float4 closingCol         = g_cfg.getFloat4( m_name, "gap_closing_col", float4(0.95f,0.45f,0.1f,1) );
+            const float4 openingCol         = g_cfg.getFloat4( m_name, "gap_opening_col", float4(0.6f,0.6f,0.6f,1) );
             const bool   minimapEnabled     = g_cfg.getBool( m_name, "minimap_enabled", true );
             const bool   minimapIsRelative  = g_cfg.getBool( m_name, "minimap_is_relative", true );
             const float4 minimapBgCol       = g_cfg.getFloat4( m_name, "minimap_background_col", float4(0,0,0,0.13f) );
@@ -195,6 +167,34 @@ class OverlayRelative : public Overlay
             const float  listingAreaBot     = m_height - 10.0f;
             const float  yself              = listingAreaTop + (listingAreaBot-listingAreaTop) / 2.0f;
             const int    entriesAbove       = int( (yself - lineHeight/2 - listingAreaTop) / lineHeight );
+            const int    entriesBelow       = int( (listingAreaBot - lineHeight/2 - yself) / lineHeight );
+            const bool   multiClass         = ir_session.numClasses > 1;
+
+            // Order the cars for which a relative/delta comparison is valid by descending delta, but
+            // only as far as there are lines for them above and below our car (plus one in case the line
+            // loop below rounds its way to another line)
+            float orderKeys[IR_MAX_CARS];
+            for( int k=0; k<ir_session.numActiveCars; ++k )
+                orderKeys[ir_session.activeCarIdx[k]] = -rout.delta[ir_session.activeCarIdx[k]];
+            m_order.updateWindow( orderKeys, rout.validMask, selfIdx, entriesAbove, entriesBelow+1 );
+
+            CarInfo relatives[IR_MAX_CARS];
+            const int numRelatives = m_order.size();
+            for( int k=0; k<numRelatives; ++k )
+            {
+                const int i = m_order[k];
+
+                CarInfo& ci = relatives[k];
+                ci.carIdx = i;
+                ci.delta = rout.delta[i];
+                ci.lapDelta = rout.lapDelta[i];
+                ci.pitAge = rs.pitAge[i];
+            }
+
+            // Something's wrong if we didn't find our driver. Bail.
+            const int selfCarInfoIdx = m_order.indexOf( selfIdx );
+            if( selfCarInfoIdx < 0 )
+                return;
 
             float y = yself - entriesAbove * lineHeight;
 
@@ -202,7 +202,7 @@ class OverlayRelative : public Overlay
             m_columns.layout( (float)m_width - 20 );
 
             m_renderTarget->BeginDraw();
-            for( int cnt=0, i=selfCarInfoIdx-entriesAbove; i<(int)relatives.size() && y<=listingAreaBot-lineHeight/2; ++i, y+=lineHeight, ++cnt )
+            for( int cnt=0, i=selfCarInfoIdx-entriesAbove; i<numRelatives && y<=listingAreaBot-lineHeight/2; ++i, y+=lineHeight, ++cnt )
             {
                 // Alternating line backgrounds
                 if( cnt & 1 && alternateLineBgCol.a > 0 )
@@ -226,9 +226,9 @@ class OverlayRelative : public Overlay
                 if( ci.lapDelta < 0 )
                     col = lapBehindCol;
 
-                if( car.isSelf )
+                if( ci.carIdx==selfIdx )
                     col = selfCol;
-                else if( ir_CarIdxOnPitRoad.getBool(ci.carIdx) )
+                else if( rs.onPitRoad[ci.carIdx] )
                     col.a *= 0.5f;
                 
                 wchar_t s[512];
@@ -236,12 +236,21 @@ class OverlayRelative : public Overlay
                 D2D1_ROUNDED_RECT rr = {};
                 const ColumnLayout::Column* clm = nullptr;
                 
-                // Position
-                if( ir_getPosition(ci.carIdx) > 0 )
+                // Class color
+                if( multiClass && car.classIdx >= 0 )
+                {
+                    r = { 2, y-lineHeight/2+2, 6, y+lineHeight/2-2 };
+                    m_brush->SetColor( ir_session.classes[car.classIdx].col );
+                    m_renderTarget->FillRectangle( &r, m_brush.Get() );
+                }
+
+                // Position (within the class if there's more than one)
+                const int pos = multiClass ? rs.classPosition[ci.carIdx] : rs.position[ci.carIdx];
+                if( pos > 0 )
                 {
                     clm = m_columns.get( (int)Columns::POSITION );
                     m_brush->SetColor( col );
-                    swprintf( s, _countof(s), L"P%d", ir_getPosition(ci.carIdx) );
+                    swprintf( s, _countof(s), L"P%d", pos );
                     m_textFormat->SetTextAlignment( DWRITE_TEXT_ALIGNMENT_TRAILING );
                     m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
                 }
@@ -249,12 +258,12 @@ class OverlayRelative : public Overlay
                 // Car number
                 {
                     clm = m_columns.get( (int)Columns::CAR_NUMBER );
-                    swprintf( s, _countof(s), L"#%S", car.carNumberStr.c_str() );
+                    swprintf( s, _countof(s), L"#%S", car.carNumberStr );
                     r = { xoff+clm->textL, y-lineHeight/2, xoff+clm->textR, y+lineHeight/2 };
                     rr.rect = { r.left-2, r.top+1, r.right+2, r.bottom-1 };
                     rr.radiusX = 3;
                     rr.radiusY = 3;
-                    m_brush->SetColor( car.isSelf ? selfCol : (car.isBuddy ? buddyCol : (car.isFlagged?flaggedCol:carNumberBgCol)) );
+                    m_brush->SetColor( ci.carIdx==selfIdx ? selfCol : (car.isBuddy ? buddyCol : (car.isFlagged?flaggedCol:carNumberBgCol)) );
                     m_renderTarget->FillRoundedRectangle( &rr, m_brush.Get() );
                     m_brush->SetColor( carNumberTextCol );
                     m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
@@ -263,7 +272,7 @@ class OverlayRelative : public Overlay
                 // Name
                 {
                     clm = m_columns.get( (int)Columns::NAME );
-                    swprintf( s, _countof(s), L"%S", car.userName.c_str() );
+                    swprintf( s, _countof(s), L"%S", car.userName );
                     m_brush->SetColor( col );
                     m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_LEADING );
                 }
@@ -279,13 +288,26 @@ class OverlayRelative : public Overlay
                     m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
                 }
 
+                // Gap change per lap, negative when closing
+                float gapRate = 0;
+                if( (clm = m_columns.get((int)Columns::TREND)) && ci.carIdx!=selfIdx && ir_gapTrend.rate(ci.carIdx,&gapRate) )
+                {
+                    const float perLap = gapRate * rs.estLaptimeByCar[selfIdx];
+                    if( fabsf(perLap) >= 0.05f )
+                    {
+                        swprintf( s, _countof(s), L"%+.1f", perLap );
+                        m_brush->SetColor( perLap < 0 ? closingCol : openingCol );
+                        m_text.render( m_renderTarget.Get(), s, m_textFormatSmall.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
+                    }
+                }
+
                 // Pit age
-                if( (clm = m_columns.get((int)Columns::PIT)) && !ir_isPreStart() && (ci.pitAge>=0||ir_CarIdxOnPitRoad.getBool(ci.carIdx)) )
+                if( (clm = m_columns.get((int)Columns::PIT)) && !ir_isPreStart() && (ci.pitAge>=0||rs.onPitRoad[ci.carIdx]) )
                 {
                     r = { xoff+clm->textL, y-lineHeight/2+2, xoff+clm->textR, y+lineHeight/2-2 };
                     m_brush->SetColor( pitCol );
                     m_renderTarget->DrawRectangle( &r, m_brush.Get() );
-                    if( ir_CarIdxOnPitRoad.getBool(ci.carIdx) ) {
+                    if( rs.onPitRoad[ci.carIdx] ) {
                         swprintf( s, _countof(s), L"PIT" );
                         m_renderTarget->FillRectangle( &r, m_brush.Get() );
                         m_brush->SetColor( float4(0,0,0,1) );
@@ -342,6 +364,15 @@ class OverlayRelative : public Overlay
                     m_brush->SetColor( iratingTextCol );
                     m_text.render( m_renderTarget.Get(), s, m_textFormatSmall.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
                 }
+
+                // Projected iRating change if the race ended now
+                if( (clm = m_columns.get( (int)Columns::IRATING_CHANGE )) && ir_session.sessionType==SessionType::RACE && ir_iratingProjection.has(ci.carIdx) )
+                {
+                    const float change = ir_iratingProjection.change( ci.carIdx );
+                    swprintf( s, _countof(s), L"%+d", (int)roundf(change) );
+                    m_brush->SetColor( change >= 0 ? iratingGainCol : iratingLossCol );
+                    m_text.render( m_renderTarget.Get(), s, m_textFormatSmall.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+                }
             }
 
             // Minimap
@@ -370,27 +401,31 @@ class OverlayRelative : public Overlay
                         default: break;
                     }
 
-                    for( int i=0; i<(int)relatives.size(); ++i )
+                    // Every valid car, not just the listed ones
+                    for( int k=0; k<ir_session.numActiveCars; ++k )
                     {
-                        const CarInfo& ci     = relatives[i];
-                        const Car&     car    = ir_session.cars[ci.carIdx];
+                        const int  carIdx   = ir_session.activeCarIdx[k];
+                        const int  lapDelta = rout.lapDelta[carIdx];
+                        const Car& car      = ir_session.cars[carIdx];
 
-                        if( phase == 0 && ci.lapDelta >= 0 )
+                        if( !((rout.validMask >> carIdx) & 1) )
+                            continue;
+                        if( phase == 0 && lapDelta >= 0 )
                             continue;
-                        if( phase == 1 && ci.lapDelta != 0 )
+                        if( phase == 1 && lapDelta != 0 )
                             continue;
-                        if( phase == 2 && ci.lapDelta <= 0 )
+                        if( phase == 2 && lapDelta <= 0 )
                             continue;
                         if( phase == 3 && !car.isBuddy )
                             continue;
                         if( phase == 4 && !car.isPaceCar )
                             continue;
-                        if( phase == 5 && !car.isSelf )
+                        if( phase == 5 && carIdx!=selfIdx )
                             continue;
                         
-                        float e = ir_CarIdxLapDistPct.getFloat(ci.carIdx);
+                        float e = lapDistPct[carIdx];
 
-                        const float eself = ir_CarIdxLapDistPct.getFloat(ir_session.driverCarIdx);
+                        const float eself = lapDistPct[selfIdx];
 
                         if( minimapIsRelative )
                         {
@@ -403,11 +438,11 @@ class OverlayRelative : public Overlay
                         e = e * w + x;
 
                         float4 col = baseCol;
-                        if( !car.isSelf && ir_CarIdxOnPitRoad.getBool(ci.carIdx) )
+                        if( carIdx!=selfIdx && rs.onPitRoad[carIdx] )
                             col.a *= 0.5f;
 
                         const float dx = 2;
-                        const float dy = car.isSelf || car.isPaceCar ? 4.0f : 0.0f;
+                        const float dy = carIdx==selfIdx || car.isPaceCar ? 4.0f : 0.0f;
                         r = {e-dx, y+2-dy, e+dx, y+h-2+dy};
                         m_brush->SetColor( col );
                         m_renderTarget->FillRectangle( &r, m_brush.Get() );
@@ -422,6 +457,7 @@ class OverlayRelative : public Overlay
         Microsoft::WRL::ComPtr<IDWriteTextFormat>  m_textFormat;
         Microsoft::WRL::ComPtr<IDWriteTextFormat>  m_textFormatSmall;
 
-        ColumnLayout m_columns;
-        TextCache    m_text;
+        ColumnLayout     m_columns;
+        TextCache        m_text;
+        IncrementalOrder m_order;
 };
@@ -35,7 +35,7 @@ public:
 
     const float DefaultFontSize = 15;
 
-    enum class Columns { POSITION, CAR_NUMBER, NAME, DELTA, BEST, LAST, LICENSE, IRATING, PIT };
+    enum class Columns { POSITION, CAR_NUMBER, NAME, DELTA, BEST, LAST, LICENSE, IRATING, PIT, INCIDENTS, LAPS, STOPS, MEDIAN, STDDEV, CLEAN, IRATING_CHANGE };
 
     OverlayStandings()
         : Overlay("OverlayStandings")
@@ -76,6 +76,19 @@ protected:
         m_columns.add( (int)Columns::PIT,        computeTextExtent( L"P.Age", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
         m_columns.add( (int)Columns::LICENSE,    computeTextExtent( L"A 4.44", m_dwriteFactory.Get(), m_textFormatSmall.Get() ).x, fontSize/6 );
         m_columns.add( (int)Columns::IRATING,    computeTextExtent( L"999.9k", m_dwriteFactory.Get(), m_textFormatSmall.Get() ).x, fontSize/6 );
+        if( g_cfg.getBool(m_name,"show_irating_change",false) )
+            m_columns.add( (int)Columns::IRATING_CHANGE, computeTextExtent( L"+999", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
+        if( g_cfg.getBool(m_name,"show_incidents",false) )
+            m_columns.add( (int)Columns::INCIDENTS, computeTextExtent( L"99x", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
+        if( g_cfg.getBool(m_name,"show_laps_complete",false) )
+            m_columns.add( (int)Columns::LAPS,      computeTextExtent( L"Laps", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
+        if( g_cfg.getBool(m_name,"show_pit_stops",false) )
+            m_columns.add( (int)Columns::STOPS,     computeTextExtent( L"9 99.9", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
+        if( g_cfg.getBool(m_name,"show_lap_stats",false) ) {
+            m_columns.add( (int)Columns::CLEAN,     computeTextExtent( L"Clean", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
+            m_columns.add( (int)Columns::MEDIAN,    computeTextExtent( L"999.99.999", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
+            m_columns.add( (int)Columns::STDDEV,    computeTextExtent( L"99.999", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
+        }
         m_columns.add( (int)Columns::BEST,       computeTextExtent( L"999.99.999", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
         m_columns.add( (int)Columns::LAST,       computeTextExtent( L"999.99.999", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
         m_columns.add( (int)Columns::DELTA,      computeTextExtent( L"9999.9999", m_dwriteFactory.Get(), m_textFormat.Get() ).x, fontSize/2 );
@@ -90,6 +103,8 @@ protected:
             int     lapDelta = 0;
             float   delta = 0;
             int     position = 0;
+            int     classIdx = 0;
+            int     classPosition = 0;
             float   best = 0;
             float   last = 0;
             bool    hasFastestLap = false;
@@ -98,56 +113,63 @@ protected:
         std::vector<CarInfo> carInfo;
         carInfo.reserve( IR_MAX_CARS );
 
-        // Init array
-        float fastestLapTime = FLT_MAX;
-        int fastestLapIdx = -1;
-        for( int i=0; i<IR_MAX_CARS; ++i )
-        {
-            const Car& car = ir_session.cars[i];
-
-            if( car.isPaceCar || car.isSpectator || car.userName.empty() )
-                continue;
+        const RaceState& rs = ir_raceState;
 
-            CarInfo ci;
-            ci.carIdx       = i;
-            ci.lapCount     = std::max( ir_CarIdxLap.getInt(i), ir_CarIdxLapCompleted.getInt(i) );
-            ci.position     = ir_getPosition(i);
-            ci.pctAroundLap = ir_CarIdxLapDistPct.getFloat(i);
-            ci.delta        = ir_session.sessionType!=SessionType::RACE ? 0 : -ir_CarIdxF2Time.getFloat(i);
-            ci.last         = ir_CarIdxLastLapTime.getFloat(i);
-            ci.pitAge       = ir_CarIdxLap.getInt(i) - car.lastLapInPits;
+        // With more than one class, the cars are grouped by class and positions, deltas and fastest laps
+        // are all relative to the class. The class tables come pre-built with the session data.
+        const bool multiClass = ir_session.numClasses > 1;
 
-            ci.best         = ir_CarIdxBestLapTime.getFloat(i);
-            if( ir_session.sessionType==SessionType::RACE && ir_SessionState.getInt()<=irsdk_StateWarmup || ir_session.sessionType==SessionType::QUALIFY && ci.best<=0 )
-                ci.best = car.qualTime;
-
-            carInfo.push_back( ci );
+        // Init per-car data, indexed by carIdx
+        CarInfo byCarIdx[IR_MAX_CARS];
+        float orderKeys[IR_MAX_CARS] = {};
+        unsigned long long orderMask = 0;
+        for( int classIdx=0; classIdx<ir_session.numClasses; ++classIdx )
+        {
+            const CarClass& cls = ir_session.classes[classIdx];
+            float fastestLapTime = FLT_MAX;
+            int fastestLapIdx = -1;
 
-            if( ci.best > 0 && ci.best < fastestLapTime ) {
-                fastestLapTime = ci.best;
-                fastestLapIdx = (int)carInfo.size()-1;
+            for( int j=0; j<cls.numCars; ++j )
+            {
+                const int  i   = cls.carIdx[j];
+                const Car& car = ir_session.cars[i];
+
+                CarInfo& ci = byCarIdx[i];
+                ci.carIdx        = i;
+                ci.classIdx      = classIdx;
+                ci.lapCount      = rs.lapCount[i];
+                ci.position      = rs.position[i];
+                ci.classPosition = rs.classPosition[i];
+                ci.pctAroundLap  = rs.lapDistPct[i];
+                ci.lapDelta      = multiClass ? rs.lapDeltaToClassLeader[i] : rs.lapDeltaToLeader[i];
+                ci.delta         = multiClass ? -rs.gapToClassLeader[i] : -rs.gapToLeader[i];
+                ci.last          = rs.last[i];
+                ci.pitAge        = rs.pitAge[i];
+
+                ci.best          = rs.best[i];
+                if( ir_session.sessionType==SessionType::RACE && ir_SessionState.getInt()<=irsdk_StateWarmup || ir_session.sessionType==SessionType::QUALIFY && ci.best<=0 )
+                    ci.best = car.qualTime;
+
+                // Order by position, grouped by class if there's more than one. Cars without a position go last.
+                const int pos = multiClass ? ci.classPosition : ci.position;
+                orderKeys[i] = float( (multiClass ? classIdx * 1000 : 0) + (pos > 0 ? pos : 999) );
+                orderMask |= 1ULL << i;
+
+                if( ci.best > 0 && ci.best < fastestLapTime ) {
+                    fastestLapTime = ci.best;
+                    fastestLapIdx = i;
+                }
             }
-        }
-
-        if( fastestLapIdx >= 0 )
-            carInfo[fastestLapIdx].hasFastestLap = true;
 
-        // Sort by position
-        std::sort( carInfo.begin(), carInfo.end(),
-            []( const CarInfo& a, const CarInfo& b ) {
-                const int ap = a.position<=0 ? INT_MAX : a.position;
-                const int bp = b.position<=0 ? INT_MAX : b.position;
-                return ap < bp;
-            } );
-
-        // Compute lap deltas to leader
-        for( int i=0; i<(int)carInfo.size(); ++i )
-        {
-            const CarInfo& ciLeader = carInfo[0];
-            CarInfo&       ci       = carInfo[i];
-            ci.lapDelta = ir_getLapDeltaToLeader( ci.carIdx, ciLeader.carIdx );
+            if( fastestLapIdx >= 0 )
+                byCarIdx[fastestLapIdx].hasFastestLap = true;
         }
 
+        // Positions rarely change between frames, so repairing last frame's order is cheaper than a full sort
+        m_order.update( orderKeys, orderMask );
+        for( int k=0; k<m_order.size(); ++k )
+            carInfo.push_back( byCarIdx[m_order[k]] );
+
         const float  fontSize           = g_cfg.getFloat( m_name, "font_size", DefaultFontSize );
         const float  lineSpacing        = g_cfg.getFloat( m_name, "line_spacing", 8 );
         const float  lineHeight         = fontSize + lineSpacing;
@@ -164,6 +186,9 @@ protected:
         const float4 fastestLapCol      = g_cfg.getFloat4( m_name, "fastest_lap_col", float4(1,0,1,1) );
         const float4 pitCol             = g_cfg.getFloat4( m_name, "pit_col", float4(0.94f,0.8f,0.13f,1) );
         const float  licenseBgAlpha     = g_cfg.getFloat( m_name, "license_background_alpha", 0.8f );
+        const float4 iratingGainCol     = g_cfg.getFloat4( m_name, "irating_gain_col", float4(0.2f,0.75f,0,1) );
+        const float4 iratingLossCol     = g_cfg.getFloat4( m_name, "irating_loss_col", float4(0.9f,0.17f,0.17f,1) );
+        const bool   lapStatsForStint   = g_cfg.getBool( m_name, "lap_stats_stint", false );
         const bool   imperial           = ir_DisplayUnits.getInt() == 0;
 
         const float xoff = 10.0f;
@@ -206,6 +231,48 @@ protected:
         swprintf( s, _countof(s), L"IR" );
         m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
 
+        if( (clm = m_columns.get( (int)Columns::IRATING_CHANGE )) )
+        {
+            swprintf( s, _countof(s), L"+/-" );
+            m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+        }
+
+        if( (clm = m_columns.get( (int)Columns::INCIDENTS )) )
+        {
+            swprintf( s, _countof(s), L"Inc." );
+            m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+        }
+
+        if( (clm = m_columns.get( (int)Columns::LAPS )) )
+        {
+            swprintf( s, _countof(s), L"Laps" );
+            m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+        }
+
+        if( (clm = m_columns.get( (int)Columns::STOPS )) )
+        {
+            swprintf( s, _countof(s), L"Stops" );
+            m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+        }
+
+        if( (clm = m_columns.get( (int)Columns::CLEAN )) )
+        {
+            swprintf( s, _countof(s), L"Clean" );
+            m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+        }
+
+        if( (clm = m_columns.get( (int)Columns::MEDIAN )) )
+        {
+            swprintf( s, _countof(s), L"Median" );
+            m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
+        }
+
+        if( (clm = m_columns.get( (int)Columns::STDDEV )) )
+        {
+            swprintf( s, _countof(s), L"Dev" );
+            m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
+        }
+
         clm = m_columns.get( (int)Columns::BEST );
         swprintf( s, _countof(s), L"Best" );
         m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
@@ -240,24 +307,33 @@ protected:
             // Dim color if player is disconnected.
             // TODO: this isn't 100% accurate, I think, because a car might be "not in world" while the player
             // is still connected? I haven't been able to find a better way to do this, though.
-            const bool isGone = !car.isSelf && ir_CarIdxTrackSurface.getInt(ci.carIdx) == irsdk_NotInWorld;
+            const bool isGone = !car.isSelf && !rs.inWorld[ci.carIdx];
             float4 textCol = car.isSelf ? selfCol : (car.isBuddy ? buddyCol : (car.isFlagged?flaggedCol:otherCarCol));
             if( isGone )
                 textCol.a *= 0.5f;
 
+            // Class color
+            if( multiClass )
+            {
+                r = { 2, y-lineHeight/2+2, 6, y+lineHeight/2-2 };
+                m_brush->SetColor( ir_session.classes[ci.classIdx].col );
+                m_renderTarget->FillRectangle( &r, m_brush.Get() );
+            }
+
             // Position
-            if( ci.position > 0 )
+            const int pos = multiClass ? ci.classPosition : ci.position;
+            if( pos > 0 )
             {
                 clm = m_columns.get( (int)Columns::POSITION );
                 m_brush->SetColor( textCol );
-                swprintf( s, _countof(s), L"P%d", ci.position );
+                swprintf( s, _countof(s), L"P%d", pos );
                 m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
             }
 
             // Car number
             {
                 clm = m_columns.get( (int)Columns::CAR_NUMBER );
-                swprintf( s, _countof(s), L"#%S", car.carNumberStr.c_str() );
+                swprintf( s, _countof(s), L"#%S", car.carNumberStr );
                 r = { xoff+clm->textL, y-lineHeight/2, xoff+clm->textR, y+lineHeight/2 };
                 rr.rect = { r.left-2, r.top+1, r.right+2, r.bottom-1 };
                 rr.radiusX = 3;
@@ -272,18 +348,18 @@ protected:
             {
                 clm = m_columns.get( (int)Columns::NAME );
                 m_brush->SetColor( textCol );
-                swprintf( s, _countof(s), L"%S", car.userName.c_str() );
+                swprintf( s, _countof(s), L"%S", car.userName );
                 m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_LEADING );
             }
 
             // Pit age
-            if( !ir_isPreStart() && (ci.pitAge>=0||ir_CarIdxOnPitRoad.getBool(ci.carIdx)) )
+            if( !ir_isPreStart() && (ci.pitAge>=0||rs.onPitRoad[ci.carIdx]) )
             {
                 clm = m_columns.get( (int)Columns::PIT );
                 m_brush->SetColor( pitCol );
                 swprintf( s, _countof(s), L"%d", ci.pitAge );
                 r = { xoff+clm->textL, y-lineHeight/2+2, xoff+clm->textR, y+lineHeight/2-2 };
-                if( ir_CarIdxOnPitRoad.getBool(ci.carIdx) ) {
+                if( rs.onPitRoad[ci.carIdx] ) {
                     swprintf( s, _countof(s), L"PIT" );
                     m_renderTarget->FillRectangle( &r, m_brush.Get() );
                     m_brush->SetColor( float4(0,0,0,1) );
@@ -325,6 +401,65 @@ protected:
                 m_text.render( m_renderTarget.Get(), s, m_textFormatSmall.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
             }
 
+            // Projected iRating change if the race ended now
+            if( (clm = m_columns.get( (int)Columns::IRATING_CHANGE )) && ir_session.sessionType==SessionType::RACE && ir_iratingProjection.has(ci.carIdx) )
+            {
+                const float change = ir_iratingProjection.change( ci.carIdx );
+                swprintf( s, _countof(s), L"%+d", (int)roundf(change) );
+                m_brush->SetColor( change >= 0 ? iratingGainCol : iratingLossCol );
+                m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+            }
+
+            // Incidents and laps complete, from the session results
+            const ResultsEntry* res = ir_getResult( ci.carIdx );
+            if( res && (clm = m_columns.get( (int)Columns::INCIDENTS )) )
+            {
+                swprintf( s, _countof(s), L"%dx", res->incidents );
+                m_brush->SetColor( otherCarCol );
+                m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+            }
+
+            if( res && (clm = m_columns.get( (int)Columns::LAPS )) )
+            {
+                swprintf( s, _countof(s), L"%d", res->lapsComplete );
+                m_brush->SetColor( otherCarCol );
+                m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+            }
+
+            // Pit stops seen so far, with the average time stationary in the stall
+            if( (clm = m_columns.get( (int)Columns::STOPS )) && ir_pitLog.numStops(ci.carIdx) )
+            {
+                swprintf( s, _countof(s), L"%d %.1f", ir_pitLog.numStops(ci.carIdx), ir_pitLog.avgStallTime(ci.carIdx) );
+                m_brush->SetColor( otherCarCol );
+                m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+            }
+
+            // Clean laps, their median and how consistent they are, over the session or the current stint
+            {
+                const LapStatSet& ls = lapStatsForStint ? ir_lapStats.stint(ci.carIdx) : ir_lapStats.race(ci.carIdx);
+
+                if( (clm = m_columns.get( (int)Columns::CLEAN )) )
+                {
+                    swprintf( s, _countof(s), L"%d", ls.numLaps() );
+                    m_brush->SetColor( otherCarCol );
+                    m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
+                }
+
+                if( (clm = m_columns.get( (int)Columns::MEDIAN )) && ls.numLaps() )
+                {
+                    str = formatLaptime( ls.median.estimate() );
+                    m_brush->SetColor( otherCarCol );
+                    m_text.render( m_renderTarget.Get(), toWide(str).c_str(), m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
+                }
+
+                if( (clm = m_columns.get( (int)Columns::STDDEV )) && ls.numLaps() > 1 )
+                {
+                    swprintf( s, _countof(s), L"%.3f", ls.stddev() );
+                    m_brush->SetColor( otherCarCol );
+                    m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff+clm->textL, xoff+clm->textR, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_TRAILING );
+                }
+            }
+
             // Best
             {
                 clm = m_columns.get( (int)Columns::BEST );
@@ -372,7 +507,10 @@ protected:
 
             m_brush->SetColor(float4(1,1,1,0.4f));
             m_renderTarget->DrawLine( float2(0,ybottom),float2((float)m_width,ybottom),m_brush.Get() );
-            swprintf( s, _countof(s), L"SoF: %d      Track Temp: %.1f%c      Air Temp: %.1f%c      Setup: %s      Subsession: %d", ir_session.sof, trackTemp, tempUnit, airTemp, tempUnit, ir_session.isFixedSetup?L"fixed":L"open", ir_session.subsessionId );
+            // Show the SoF of our own class in multi-class sessions
+            const int selfClassIdx = ir_session.driverCarIdx >= 0 ? ir_session.cars[ir_session.driverCarIdx].classIdx : -1;
+            const int sof = multiClass && selfClassIdx >= 0 ? ir_session.classes[selfClassIdx].sof : ir_session.sof;
+            swprintf( s, _countof(s), L"SoF: %d      Track Temp: %.1f%c      Air Temp: %.1f%c      Setup: %s      Subsession: %d", sof, trackTemp, tempUnit, airTemp, tempUnit, ir_session.isFixedSetup?L"fixed":L"open", ir_session.subsessionId );
             y = m_height - (m_height-ybottom)/2;
             m_brush->SetColor( headerCol );
             m_text.render( m_renderTarget.Get(), s, m_textFormat.Get(), xoff, (float)m_width-2*xoff, y, m_brush.Get(), DWRITE_TEXT_ALIGNMENT_CENTER );
@@ -391,6 +529,7 @@ protected:
     Microsoft::WRL::ComPtr<IDWriteTextFormat>  m_textFormat;
     Microsoft::WRL::ComPtr<IDWriteTextFormat>  m_textFormatSmall;
 
-    ColumnLayout m_columns;
-    TextCache    m_text;
+    ColumnLayout     m_columns;
+    TextCache        m_text;
+    IncrementalOrder m_order;
 };
@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "PitLog.h"
+
+void PitLog::reset()
+{
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        for( PitStop& ps : m_stops[carIdx] )
+            ps = PitStop();
+        m_current[carIdx] = PitStop();
+        m_numStops[carIdx] = 0;
+        m_totalLaneTime[carIdx] = 0;
+        m_totalStallTime[carIdx] = 0;
+        m_inLane[carIdx] = false;
+        m_inStall[carIdx] = false;
+        m_inWorld[carIdx] = false;
+        m_fromGarage[carIdx] = false;
+        m_stallEntryTime[carIdx] = 0;
+    }
+    m_lastTime = -1;
+}
+
+void PitLog::update( double sessionTime, const int* lap, const bool* onPitRoad, const bool* inPitStall, const bool* inWorld, unsigned long long validMask )
+{
+    // Session time going backwards means a new session (or a replay jump)
+    if( sessionTime < m_lastTime )
+        reset();
+    m_lastTime = sessionTime;
+
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        PitStop& cur = m_current[carIdx];
+
+        if( !((validMask >> carIdx) & 1) || !inWorld[carIdx] ) {
+            m_inLane[carIdx] = false;
+            m_inStall[carIdx] = false;
+            m_inWorld[carIdx] = false;
+            continue;
+        }
+
+        const bool inLane  = onPitRoad[carIdx];
+        const bool inStall = inLane && inPitStall[carIdx];
+
+        // Entry
+        if( inLane && !m_inLane[carIdx] )
+        {
+            cur = PitStop();
+            cur.lap = lap[carIdx];
+            cur.entryTime = sessionTime;
+            m_fromGarage[carIdx] = !m_inWorld[carIdx];
+        }
+
+        // Stall time accumulates, since a car may stop more than once (e.g. a drive-through after overshooting the box)
+        if( inStall && !m_inStall[carIdx] )
+            m_stallEntryTime[carIdx] = sessionTime;
+        if( m_inStall[carIdx] && !inStall )
+            cur.stallTime += float( sessionTime - m_stallEntryTime[carIdx] );
+
+        if( inLane )
+            cur.laneTime = float( sessionTime - cur.entryTime );
+
+        // Exit
+        if( !inLane && m_inLane[carIdx] && !m_fromGarage[carIdx] )
+        {
+            cur.exitTime = sessionTime;
+            cur.laneTime = float( sessionTime - cur.entryTime );
+
+            m_stops[carIdx][m_numStops[carIdx] % MaxStopsPerCar] = cur;
+            m_numStops[carIdx]++;
+            m_totalLaneTime[carIdx] += cur.laneTime;
+            m_totalStallTime[carIdx] += cur.stallTime;
+        }
+
+        m_inLane[carIdx] = inLane;
+        m_inStall[carIdx] = inStall;
+        m_inWorld[carIdx] = true;
+    }
+}
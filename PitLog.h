@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+struct PitStop
+{
+    int     lap = 0;            // lap the car entered pit road on
+    double  entryTime = 0;      // SessionTime
+    double  exitTime = 0;
+    float   laneTime = 0;       // entry to exit
+    float   stallTime = 0;      // time spent in the pit stall
+};
+
+// Records pit road entries and exits for every car, with a short history of stops per car and
+// running totals for averages. Each update does a constant amount of work per car.
+class PitLog
+{
+    public:
+
+        static const int MaxStopsPerCar = 8;   // older stops only count towards the totals
+
+        PitLog() { reset(); }
+
+        void reset();
+
+        // Call once per tick. Pit road visits that start or end out of the world (getting in the car,
+        // going back to the garage) aren't stops and get discarded.
+        void update( double sessionTime, const int* lap, const bool* onPitRoad, const bool* inPitStall, const bool* inWorld, unsigned long long validMask );
+
+        int   numStops( int carIdx ) const { return m_numStops[carIdx]; }     // completed stops
+        float avgLaneTime( int carIdx ) const { return m_numStops[carIdx] ? m_totalLaneTime[carIdx] / m_numStops[carIdx] : 0; }
+        float avgStallTime( int carIdx ) const { return m_numStops[carIdx] ? m_totalStallTime[carIdx] / m_numStops[carIdx] : 0; }
+
+        // Recorded stops, 0 is the most recent. i < min(numStops, MaxStopsPerCar).
+        const PitStop& stop( int carIdx, int i ) const { return m_stops[carIdx][(m_numStops[carIdx]-1-i) % MaxStopsPerCar]; }
+
+        // Stop in progress, if the car is on pit road right now
+        bool  isInLane( int carIdx ) const { return m_inLane[carIdx]; }
+        const PitStop& current( int carIdx ) const { return m_current[carIdx]; }
+
+    private:
+
+        PitStop m_stops[IR_MAX_CARS][MaxStopsPerCar];
+        PitStop m_current[IR_MAX_CARS];
+        int     m_numStops[IR_MAX_CARS];
+        float   m_totalLaneTime[IR_MAX_CARS];
+        float   m_totalStallTime[IR_MAX_CARS];
+        bool    m_inLane[IR_MAX_CARS];
+        bool    m_inStall[IR_MAX_CARS];
+        bool    m_inWorld[IR_MAX_CARS];
+        bool    m_fromGarage[IR_MAX_CARS];
+        double  m_stallEntryTime[IR_MAX_CARS];
+        double  m_lastTime;
+};
@@ -0,0 +1,83 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include "Proximity.h"
+
+void Proximity::reset()
+{
+    m_result = ProximityResult();
+    m_trackLength = 0;
+    m_carLength = 4.5f;
+}
+
+// Lap fraction difference wrapped to [-0.5,0.5)
+static inline float wrapPct( float d )
+{
+    return d - floorf( d + 0.5f );
+}
+
+void Proximity::update( int selfIdx, const float* lapDistPct, const float* speed, unsigned long long validMask )
+{
+    m_result = ProximityResult();
+
+    if( selfIdx < 0 || selfIdx >= IR_MAX_CARS || !((validMask >> selfIdx) & 1) || m_trackLength <= 0 )
+        return;
+
+    // Closest car either way
+    const float selfPct = lapDistPct[selfIdx];
+    float bestAhead  = 0.5f;
+    float bestBehind = -0.5f;
+    int   aheadIdx   = -1;
+    int   behindIdx  = -1;
+
+    unsigned long long mask = validMask & ~(1ULL << selfIdx);
+    for( int carIdx=0; mask; ++carIdx, mask >>= 1 )
+    {
+        if( !(mask & 1) )
+            continue;
+
+        const float d = wrapPct( lapDistPct[carIdx] - selfPct );
+        if( d >= 0 && d < bestAhead ) {
+            bestAhead = d;
+            aheadIdx = carIdx;
+        }
+        else if( d < 0 && d > bestBehind ) {
+            bestBehind = d;
+            behindIdx = carIdx;
+        }
+    }
+
+    const float selfSpeed = speed[selfIdx];
+    auto fill = [&]( ProximityCar& pc, int carIdx, float d, float sign ) {
+        pc.carIdx       = carIdx;
+        pc.meters       = fabsf( d ) * m_trackLength;
+        pc.closingSpeed = sign * (selfSpeed - speed[carIdx]);
+        pc.overlap      = m_carLength > 0 ? fmaxf( 0.0f, 1.0f - pc.meters / m_carLength ) : 0;
+    };
+    if( aheadIdx >= 0 )
+        fill( m_result.ahead, aheadIdx, bestAhead, 1.0f );
+    if( behindIdx >= 0 )
+        fill( m_result.behind, behindIdx, bestBehind, -1.0f );
+}
@@ -0,0 +1,70 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+struct ProximityCar
+{
+    int     carIdx = -1;        // -1 if nobody
+    float   meters = 0;         // center to center along the track, always positive
+    float   closingSpeed = 0;   // m/s, positive when getting closer
+    float   overlap = 0;        // 0..1, how far the cars overlap lengthwise
+};
+
+struct ProximityResult
+{
+    ProximityCar    ahead;
+    ProximityCar    behind;
+};
+
+// Distance-based spotter: the closest car ahead and behind along the track, from lap distance
+// percentages and the track length. Speeds come from RaceState. A straight scan over the cars with
+// a few flops each, no allocations, so it can run on every telemetry tick or every extrapolated
+// render frame.
+// See bench/proximity_bench.cpp.
+class Proximity
+{
+    public:
+
+        Proximity() { reset(); }
+
+        void reset();
+
+        void setTrackLength( float meters ) { m_trackLength = meters; }
+        void setCarLength( float meters ) { m_carLength = meters; }
+
+        // 'speed' is the along-track speed in m/s, see RaceState::speed. Cars not in 'validMask'
+        // (e.g. off track or in the pits when we aren't) are ignored.
+        void update( int selfIdx, const float* lapDistPct, const float* speed, unsigned long long validMask );
+
+        const ProximityResult& result() const { return m_result; }
+
+    private:
+
+        ProximityResult m_result;
+        float   m_trackLength;
+        float   m_carLength;
+};
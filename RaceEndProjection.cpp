@@ -0,0 +1,66 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "RaceEndProjection.h"
+
+RaceEndProjection ir_projectRaceEnd( const RaceEndInput& in )
+{
+    RaceEndProjection out;
+    if( in.selfDistance < 0 )
+        return out;
+
+    // Once the leader has the flag, everyone finishes at their next crossing of the line
+    if( in.leaderFinished )
+    {
+        out.leaderFinishLap = in.leaderDistance >= 0 ? int( floor( double(in.leaderDistance) ) ) : 0;
+        const double selfLine = floor( double(in.selfDistance) ) + (in.selfFinished ? 0 : 1);
+        out.selfFinishLap = int( selfLine );
+        out.lapsToGo      = in.selfFinished ? 0.0f : float( selfLine - in.selfDistance );
+        out.remainingLaps = in.selfFinished ? 0 : 1;
+        out.valid = true;
+        return out;
+    }
+
+    if( in.leaderDistance < 0 || in.leaderPace <= 0 || in.selfPace <= 0 )
+        return out;
+
+    // Leader: finishes the lap in progress, plus however many more it takes for the clock to run out.
+    // A crossing right as the clock hits zero ends it.
+    const double leaderLine = floor( double(in.leaderDistance) ) + 1;
+    const double toLine     = (leaderLine - in.leaderDistance) * in.leaderPace;
+    const double extraLaps  = in.timeRemaining > toLine ? ceil( (in.timeRemaining - toLine) / in.leaderPace - 1e-6 ) : 0;
+    out.leaderFinishLap    = int( leaderLine + extraLaps );
+    out.timeToLeaderFinish = float( toLine + extraLaps * in.leaderPace );
+
+    // Us: first crossing no earlier than the leader's, but at least the end of our current lap
+    const double selfAtLeaderFinish = in.selfDistance + out.timeToLeaderFinish / in.selfPace;
+    const double selfLine = std::max( floor( double(in.selfDistance) ) + 1, ceil( selfAtLeaderFinish - 1e-6 ) );
+    out.selfFinishLap = int( selfLine );
+    out.lapsToGo      = float( selfLine - in.selfDistance );
+    out.remainingLaps = int( selfLine - floor( double(in.selfDistance) ) );
+    out.valid = true;
+    return out;
+}
@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// When a timed race ends: the leader takes the flag at the first crossing of the line after the
+// clock ran out, and everybody else at their first crossing after that. Plain numbers in and out,
+// so it can be checked with made-up races (see bench/race_end_test.cpp).
+
+struct RaceEndInput
+{
+    double  timeRemaining = 0;      // session time left, <= 0 once it ran out
+    float   leaderDistance = -1;    // laps + fraction of lap, as in RaceState::distance
+    float   leaderPace = 0;         // lap time to project the leader with
+    float   selfDistance = -1;
+    float   selfPace = 0;
+    bool    leaderFinished = false;     // the checkered flag is out, so the leader's distance and pace don't matter anymore
+    bool    selfFinished = false;       // we crossed the line since the checkered flag came out
+};
+
+struct RaceEndProjection
+{
+    bool    valid = false;
+    int     leaderFinishLap = 0;    // line crossing (in laps of distance) where the leader takes the flag, 0 if it
+                                    // already did and isn't on track anymore
+    float   timeToLeaderFinish = 0; // seconds from now
+    int     selfFinishLap = 0;      // line crossing where we take the flag
+    float   lapsToGo = 0;           // distance left for us, fraction of the current lap included
+    int     remainingLaps = 0;      // laps left counting the current one as a full lap
+};
+
+RaceEndProjection ir_projectRaceEnd( const RaceEndInput& in );
@@ -0,0 +1,229 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "RaceState.h"
+
+int ir_computeLapDelta( const Session& session, const RaceStateInput& in, int carIdx, int ldrIdx )
+{
+    if( session.sessionType!=SessionType::RACE || in.isPreStart || carIdx < 0 || ldrIdx < 0 )
+        return 0;
+
+    const int carLapCount = std::max( in.lap[carIdx], in.lapCompleted[carIdx] );
+    const int ldrLapCount = std::max( in.lap[ldrIdx], in.lapCompleted[ldrIdx] );
+
+    const float carPctAroundLap = in.lapDistPct[carIdx];
+    const float ldrPctAroundLap = in.lapDistPct[ldrIdx];
+
+    if( carPctAroundLap < 0 || ldrPctAroundLap < 0 )
+        return 0;
+
+    int lapDelta = carLapCount - ldrLapCount;
+
+    if( carPctAroundLap > ldrPctAroundLap )
+        lapDelta += 1;
+
+    return lapDelta;
+}
+
+// Resolve every car's position from the sources we have and rebuild the position->carIdx tables.
+static void updatePositions( const Session& session, const RaceStateInput& in, RaceState& state )
+{
+    for( int& idx : state.carIdxByPosition )
+        idx = -1;
+    for( int& idx : state.carIdxByClassPosition )
+        idx = -1;
+
+    int offset = 0;
+    for( int classIdx=0; classIdx<session.numClasses; ++classIdx )
+    {
+        state.classOffset[classIdx] = offset;
+        offset += session.classes[classIdx].numCars;
+    }
+
+    memset( state.position, 0, sizeof(state.position) );
+    memset( state.classPosition, 0, sizeof(state.classPosition) );
+    for( int i=0; i<session.numActiveCars; ++i )
+    {
+        const int  carIdx = session.activeCarIdx[i];
+        const Car& car    = session.cars[carIdx];
+
+        // Try the different sources we have for position data, in descending order of importance
+        int pos = in.position[carIdx];
+        if( pos <= 0 )
+            pos = car.racePosition;
+        if( pos <= 0 )
+            pos = car.qualPosition;
+        if( pos <= 0 )
+            pos = car.practicePosition;
+        pos = std::max( 0, pos );
+
+        const int classPos = in.classPosition[carIdx] > 0 ? in.classPosition[carIdx] : car.classPosition;
+
+        state.position[carIdx]      = pos;
+        state.classPosition[carIdx] = classPos;
+
+        if( !state.isValid(carIdx) )
+            continue;
+
+        if( pos > 0 && pos <= IR_MAX_CARS && state.carIdxByPosition[pos] < 0 )
+            state.carIdxByPosition[pos] = carIdx;
+
+        const int classIdx = car.classIdx;
+        if( classIdx >= 0 && classPos > 0 && classPos <= session.classes[classIdx].numCars )
+        {
+            int& slot = state.carIdxByClassPosition[state.classOffset[classIdx] + classPos-1];
+            if( slot < 0 )
+                slot = carIdx;
+        }
+    }
+
+    state.leaderCarIdx = -1;
+    for( int pos=1; pos<=IR_MAX_CARS && state.leaderCarIdx<0; ++pos )
+        state.leaderCarIdx = state.carIdxByPosition[pos];
+
+    // Fall back to the fastest class member if the class leader isn't known (yet)
+    for( int classIdx=0; classIdx<session.numClasses; ++classIdx )
+    {
+        const CarClass& cls = session.classes[classIdx];
+        const int ldrIdx = state.carAtClassPosition( session, classIdx, 1 );
+        state.classLeaderCarIdx[classIdx] = ldrIdx >= 0 ? ldrIdx : (cls.numCars ? cls.carIdx[0] : -1);
+    }
+    for( int classIdx=session.numClasses; classIdx<IR_MAX_CARS; ++classIdx )
+        state.classLeaderCarIdx[classIdx] = -1;
+
+    memcpy( state.prevPosition, in.position, sizeof(state.prevPosition) );
+    memcpy( state.prevClassPosition, in.classPosition, sizeof(state.prevClassPosition) );
+    state.prevSessionVersion = in.sessionVersion;
+    state.positionRebuilds++;
+}
+
+void ir_updateRaceState( const Session& session, const RaceStateInput& in, RaceState& state )
+{
+    const bool isRace = session.sessionType == SessionType::RACE;
+
+    // Track cars in pits. Reset every time we're in the 'warmup' phase (just before starting pace laps).
+    const bool resetPitAge = in.isWarmup;
+
+    // Speeds only change when the sim sends a new row. Time going backwards is a new session or a replay jump.
+    const bool  restart = state.prevSpeedTime < 0 || in.sessionTime < state.prevSpeedTime;
+    const float dt = float( in.sessionTime - state.prevSpeedTime );
+    const bool  newRow = restart || dt > 0;
+    if( restart )
+    {
+        for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx ) {
+            state.prevSpeedPct[carIdx] = -1;
+            state.haveSpeed[carIdx] = false;
+            state.lapSpeed[carIdx] = state.speed[carIdx] = 0;
+        }
+    }
+    if( newRow )
+        state.prevSpeedTime = in.sessionTime;
+
+    // Only the active cars (competitors and the pace car) are kept up to date, other slots hold stale data
+    state.validMask = session.activeMask & ~(session.paceCarIdx >= 0 ? 1ULL << session.paceCarIdx : 0);
+    for( int i=0; i<session.numActiveCars; ++i )
+    {
+        const int carIdx = session.activeCarIdx[i];
+
+        if( resetPitAge )
+            state.lastLapInPits[carIdx] = 0;
+        if( in.sessionStateValid && in.onPitRoad[carIdx] )
+            state.lastLapInPits[carIdx] = in.lap[carIdx];
+
+        state.lap[carIdx]           = in.lap[carIdx];
+        state.lapCount[carIdx]      = std::max( in.lap[carIdx], in.lapCompleted[carIdx] );
+        state.lapDistPct[carIdx]    = in.lapDistPct[carIdx];
+        state.distance[carIdx]      = in.lapDistPct[carIdx] >= 0 ? float(in.lap[carIdx]) + in.lapDistPct[carIdx] : -1.0f;
+        state.onPitRoad[carIdx]     = in.onPitRoad[carIdx];
+        state.inWorld[carIdx]       = in.inWorld[carIdx];
+        state.pitAge[carIdx]        = in.lap[carIdx] - state.lastLapInPits[carIdx];
+        state.estTime[carIdx]       = in.estTime[carIdx];
+        state.best[carIdx]          = in.bestLapTime[carIdx];
+        state.last[carIdx]          = in.lastLapTime[carIdx];
+        state.estLaptimeByCar[carIdx] = in.bestLapTime[carIdx] > 0 ? in.bestLapTime[carIdx] : session.cars[carIdx].carClassEstLapTime;
+
+        // Speed along the track, with the wrap at the s/f line taken care of. Smoothed lightly, since
+        // positions come quantized, except for the first value after a car (re)appears or jumps.
+        if( newRow )
+        {
+            const float pct  = in.lapDistPct[carIdx];
+            const float prev = state.prevSpeedPct[carIdx];
+            const bool  onTrack = in.inWorld[carIdx] && pct >= 0;
+            float& v = state.lapSpeed[carIdx];
+            if( !onTrack || prev < 0 )
+            {
+                v = 0;
+                state.haveSpeed[carIdx] = false;
+            }
+            else
+            {
+                float d = pct - prev;
+                d -= floorf( d + 0.5f );
+                const float raw = d / dt;
+                if( fabsf( raw ) > RaceState::MaxLapSpeed )
+                {
+                    v = 0;
+                    state.haveSpeed[carIdx] = false;
+                }
+                else
+                {
+                    v = state.haveSpeed[carIdx] ? v + 0.5f * (raw - v) : raw;
+                    state.haveSpeed[carIdx] = true;
+                }
+            }
+            state.prevSpeedPct[carIdx] = onTrack ? pct : -1;
+            state.speed[carIdx] = v * session.trackLengthM;
+        }
+    }
+
+    // Positions only move when someone overtakes or new results come in
+    if( in.sessionVersion != state.prevSessionVersion ||
+        memcmp( in.position, state.prevPosition, sizeof(state.prevPosition) ) ||
+        memcmp( in.classPosition, state.prevClassPosition, sizeof(state.prevClassPosition) ) )
+        updatePositions( session, in, state );
+
+    // Deltas to the leaders
+    for( int i=0; i<session.numActiveCars; ++i )
+    {
+        const int carIdx = session.activeCarIdx[i];
+        const int ldrIdx = state.leaderCarIdx;
+        const int clsLdrIdx = state.classLeader( session, carIdx );
+
+        state.lapDeltaToLeader[carIdx]      = ir_computeLapDelta( session, in, carIdx, ldrIdx );
+        state.lapDeltaToClassLeader[carIdx] = ir_computeLapDelta( session, in, carIdx, clsLdrIdx );
+
+        // F2Time is the time behind the overall leader
+        state.gapToLeader[carIdx]      = isRace ? in.f2Time[carIdx] : 0;
+        state.gapToClassLeader[carIdx] = isRace && clsLdrIdx >= 0 ? in.f2Time[carIdx] - in.f2Time[clsLdrIdx] : 0;
+    }
+
+    state.estLaptime = in.selfBestLapTime;
+    if( state.estLaptime <= 0 && session.driverCarIdx >= 0 )
+        state.estLaptime = session.cars[session.driverCarIdx].carClassEstLapTime;
+    if( session.driverCarIdx >= 0 )
+        state.estLaptimeByCar[session.driverCarIdx] = state.estLaptime;
+}
@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+// Per-car telemetry for one tick, as read from the sim. Kept apart from the irsdk variables so the
+// race state can be computed from recorded or made-up data, without iRacing or any rendering.
+struct RaceStateInput
+{
+    int             lap[IR_MAX_CARS] = {};
+    int             lapCompleted[IR_MAX_CARS] = {};
+    float           lapDistPct[IR_MAX_CARS] = {};
+    int             position[IR_MAX_CARS] = {};
+    int             classPosition[IR_MAX_CARS] = {};
+    float           estTime[IR_MAX_CARS] = {};
+    float           f2Time[IR_MAX_CARS] = {};
+    float           bestLapTime[IR_MAX_CARS] = {};
+    float           lastLapTime[IR_MAX_CARS] = {};
+    bool            onPitRoad[IR_MAX_CARS] = {};
+    bool            inWorld[IR_MAX_CARS] = {};
+    bool            inPitStall[IR_MAX_CARS] = {};
+    bool            offTrack[IR_MAX_CARS] = {};
+    bool            sessionStateValid = false;  // iRacing sometimes reports garbage (< 0) for the session state
+    bool            isWarmup = false;           // session state is irsdk_StateWarmup
+    bool            isPreStart = false;         // see ir_isPreStart()
+    float           selfBestLapTime = 0;
+    int             sessionVersion = 0;         // changes whenever the session data was re-parsed
+    double          sessionTime = -1;           // SessionTime, speeds are derived from it
+};
+
+// What the overlays need to know about the cars, computed once per tick by ir_updateRaceState()
+// so they don't each loop over the field and re-derive it. All arrays are indexed by carIdx.
+struct RaceState
+{
+    unsigned long long  validMask = 0;                  // bit per car: a driver in the session, not the pace car or a spectator
+    int                 position[IR_MAX_CARS] = {};     // best known position, 0 if none
+    int                 classPosition[IR_MAX_CARS] = {};
+    int                 lap[IR_MAX_CARS] = {};          // lap the car is on, -1 if not in the session
+    int                 lapCount[IR_MAX_CARS] = {};     // max(lap, laps completed)
+    float               distance[IR_MAX_CARS] = {};     // lap + fraction of lap, continuous across the s/f line; -1 if not on track
+    float               lapDistPct[IR_MAX_CARS] = {};
+    bool                onPitRoad[IR_MAX_CARS] = {};
+    bool                inWorld[IR_MAX_CARS] = {};
+    int                 pitAge[IR_MAX_CARS] = {};       // laps since last seen on pit road
+    int                 lapDeltaToLeader[IR_MAX_CARS] = {};         // races only
+    int                 lapDeltaToClassLeader[IR_MAX_CARS] = {};    // races only
+    float               gapToLeader[IR_MAX_CARS] = {};              // races only
+    float               gapToClassLeader[IR_MAX_CARS] = {};         // races only
+    float               estTime[IR_MAX_CARS] = {};
+    float               lapSpeed[IR_MAX_CARS] = {};     // laps/s along the track, smoothed a little, negative going backwards; 0 if not known
+    float               speed[IR_MAX_CARS] = {};        // the same in m/s, 0 if the track length is unknown
+    float               best[IR_MAX_CARS] = {};
+    float               last[IR_MAX_CARS] = {};
+    int                 leaderCarIdx = -1;
+    int                 classLeaderCarIdx[IR_MAX_CARS] = {};    // by class index, -1 if none
+    float               estLaptime = 0;                 // for our own car
+    float               estLaptimeByCar[IR_MAX_CARS] = {};  // best lap, or the class estimate
+    int                 lastLapInPits[IR_MAX_CARS] = {};    // kept across ticks
+    float               prevSpeedPct[IR_MAX_CARS] = {};     // kept across ticks, -1 if not on track at the last update
+    bool                haveSpeed[IR_MAX_CARS] = {};
+    double              prevSpeedTime = -1;
+
+    static constexpr float MaxLapSpeed = 0.1f;          // laps/s, anything faster is a tow or reset, not driving
+
+    // Inverse position tables. Only rebuilt when CarIdxPosition, CarIdxClassPosition or the session
+    // data change, which is rarely more than once per lap per car.
+    int                 carIdxByPosition[IR_MAX_CARS+1] = {};       // by position, -1 if nobody holds it
+    int                 carIdxByClassPosition[IR_MAX_CARS] = {};    // by classOffset[classIdx] + classPosition-1, -1 if nobody holds it
+    int                 classOffset[IR_MAX_CARS] = {};              // by class index
+    int                 positionRebuilds = 0;
+    int                 prevPosition[IR_MAX_CARS] = {};
+    int                 prevClassPosition[IR_MAX_CARS] = {};
+    int                 prevSessionVersion = -1;
+
+    bool isValid( int carIdx ) const { return carIdx >= 0 && carIdx < IR_MAX_CARS && ((validMask >> carIdx) & 1); }
+    int  classLeader( const Session& session, int carIdx ) const { return carIdx >= 0 && session.cars[carIdx].classIdx >= 0 ? classLeaderCarIdx[session.cars[carIdx].classIdx] : -1; }
+
+    int  carAtPosition( int pos ) const { return pos > 0 && pos <= IR_MAX_CARS ? carIdxByPosition[pos] : -1; }
+    int  carAtClassPosition( const Session& session, int classIdx, int classPos ) const {
+        if( classIdx < 0 || classIdx >= session.numClasses || classPos <= 0 || classPos > session.classes[classIdx].numCars )
+            return -1;
+        return carIdxByClassPosition[classOffset[classIdx] + classPos-1];
+    }
+    // Car one place ahead, overall or in the car's class. -1 if none.
+    int  carAhead( int carIdx ) const { return carIdx >= 0 && carIdx < IR_MAX_CARS ? carAtPosition( position[carIdx]-1 ) : -1; }
+    int  carAheadInClass( const Session& session, int carIdx ) const { return carIdx >= 0 && carIdx < IR_MAX_CARS ? carAtClassPosition( session, session.cars[carIdx].classIdx, classPosition[carIdx]-1 ) : -1; }
+};
+
+// Lap delta between two cars, as shown in the standings. 0 outside of races and before the start.
+int ir_computeLapDelta( const Session& session, const RaceStateInput& in, int carIdx, int ldrIdx );
+
+void ir_updateRaceState( const Session& session, const RaceStateInput& in, RaceState& state );
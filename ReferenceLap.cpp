@@ -0,0 +1,289 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "ReferenceLap.h"
+
+static const char   RefLapFileMagic[8] = { 'I','R','O','N','R','L','0','1' };
+static const float  MaxStepPct = 0.1f;     // a bigger jump in one tick is a tow or reset
+
+float RefLap::timeAt( float pct ) const
+{
+    const float x = fminf( fmaxf( pct, 0.0f ), 1.0f ) * GridSize;
+    const int   i = std::min( (int)x, GridSize-1 );
+    return time[i] + (x - i) * (time[i+1] - time[i]);
+}
+
+void RefLapRecorder::reset()
+{
+    for( RefLap& r : m_refs )
+        r.valid = false;
+    m_cur.valid = false;
+    for( float& s : m_bestSegment )
+        s = 0;
+    m_nextIdx = 0;
+    m_lapStartTime = -1;
+    m_lapClean = false;
+    m_prevPct = -1;
+    m_prevTime = 0;
+    m_numLaps = 0;
+    m_dirty = false;
+}
+
+// Grid points between the previous sample and this one, interpolated in time
+void RefLapRecorder::fillTo( float pct, double sessionTime )
+{
+    const float dp = pct - m_prevPct;
+    while( m_nextIdx <= RefLap::GridSize && m_nextIdx <= pct * RefLap::GridSize )
+    {
+        const float  gp = (float)m_nextIdx / RefLap::GridSize;
+        const double t  = dp > 0 ? m_prevTime + (gp - m_prevPct) / dp * (sessionTime - m_prevTime) : sessionTime;
+        m_cur.time[m_nextIdx++] = float( t - m_lapStartTime );
+    }
+}
+
+void RefLapRecorder::update( double sessionTime, float lapDistPct, bool clean )
+{
+    if( lapDistPct < 0 || (m_prevPct >= 0 && sessionTime < m_prevTime) )
+    {
+        // Not on track, or time went backwards
+        m_prevPct = -1;
+        m_lapStartTime = -1;
+        return;
+    }
+
+    m_lapClean = m_lapClean && clean;
+
+    if( m_prevPct < 0 )
+    {
+        m_prevPct = lapDistPct;
+        m_prevTime = sessionTime;
+        return;
+    }
+
+    const float d = lapDistPct - m_prevPct;
+    if( d < -0.5f )
+    {
+        // Crossed the line. Find when exactly, finish the lap and start the next one from there.
+        const float  frac  = (1.0f - m_prevPct) / (1.0f - m_prevPct + lapDistPct);
+        const double tLine = m_prevTime + frac * (sessionTime - m_prevTime);
+
+        if( m_lapStartTime >= 0 )
+        {
+            fillTo( 1.0f, tLine );
+            if( m_nextIdx > RefLap::GridSize && m_lapClean )
+                completeLap( float( tLine - m_lapStartTime ) );
+        }
+
+        m_lapStartTime = tLine;
+        m_lapClean = clean;
+        m_cur.time[0] = 0;
+        m_nextIdx = 1;
+        m_prevPct = 0;
+        m_prevTime = tLine;
+    }
+    else if( d < 0 || d > MaxStepPct )
+    {
+        // Going backwards or jumping ahead, this lap is no good
+        m_lapClean = false;
+        m_nextIdx = std::max( m_nextIdx, std::min( int(RefLap::GridSize), (int)(lapDistPct * RefLap::GridSize) + 1 ) );
+        m_prevPct = lapDistPct;
+        m_prevTime = sessionTime;
+        return;
+    }
+
+    if( m_lapStartTime >= 0 )
+        fillTo( lapDistPct, sessionTime );
+    m_prevPct = lapDistPct;
+    m_prevTime = sessionTime;
+}
+
+void RefLapRecorder::completeLap( float lapTime )
+{
+    m_cur.time[RefLap::GridSize] = lapTime;
+    m_cur.valid = true;
+    m_numLaps++;
+
+    m_refs[(int)RefLapKind::LAST] = m_cur;
+
+    RefLap& best = m_refs[(int)RefLapKind::BEST];
+    if( !best.valid || lapTime < best.lapTime() )
+    {
+        best = m_cur;
+        m_dirty = true;
+    }
+
+    for( int i=0; i<RefLap::GridSize; ++i )
+    {
+        const float seg = m_cur.time[i+1] - m_cur.time[i];
+        if( m_bestSegment[i] <= 0 || seg < m_bestSegment[i] ) {
+            m_bestSegment[i] = seg;
+            m_dirty = true;
+        }
+    }
+    rebuildOptimal();
+
+    m_cur.valid = false;
+}
+
+void RefLapRecorder::rebuildOptimal()
+{
+    RefLap& opt = m_refs[(int)RefLapKind::OPTIMAL];
+    opt.valid = true;
+    opt.time[0] = 0;
+    for( int i=0; i<RefLap::GridSize; ++i )
+    {
+        if( m_bestSegment[i] <= 0 ) {
+            opt.valid = false;
+            return;
+        }
+        opt.time[i+1] = opt.time[i] + m_bestSegment[i];
+    }
+}
+
+bool RefLapRecorder::delta( RefLapKind kind, float* delta, float* predictedLapTime ) const
+{
+    const RefLap& r = m_refs[(int)kind];
+    if( !r.valid || m_lapStartTime < 0 || m_prevPct < 0 )
+        return false;
+
+    const float d = float( m_prevTime - m_lapStartTime ) - r.timeAt( m_prevPct );
+    if( delta )
+        *delta = d;
+    if( predictedLapTime )
+        *predictedLapTime = r.lapTime() + d;
+    return true;
+}
+
+// File layout: magic, i32 gridSize, u8 hasBest, f32 best[gridSize+1], f32 bestSegment[gridSize]
+void RefLapRecorder::snapshot( RefLapFile& file )
+{
+    file.best = m_refs[(int)RefLapKind::BEST];
+    memcpy( file.bestSegment, m_bestSegment, sizeof(file.bestSegment) );
+    m_dirty = false;
+}
+
+bool RefLapFile::write( const std::string& filename ) const
+{
+    FILE* fp = fopen( filename.c_str(), "wb" );
+    if( !fp )
+        return false;
+
+    const int gridSize = RefLap::GridSize;
+    const unsigned char hasBest = best.valid ? 1 : 0;
+    bool ok = fwrite( RefLapFileMagic, sizeof(RefLapFileMagic), 1, fp ) == 1;
+    ok = ok && fwrite( &gridSize, sizeof(gridSize), 1, fp ) == 1;
+    ok = ok && fwrite( &hasBest, 1, 1, fp ) == 1;
+    ok = ok && fwrite( best.time, sizeof(best.time), 1, fp ) == 1;
+    ok = ok && fwrite( bestSegment, sizeof(bestSegment), 1, fp ) == 1;
+    fclose( fp );
+    return ok;
+}
+
+bool RefLapRecorder::load( const std::string& filename )
+{
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if( !fp )
+        return false;
+
+    char magic[sizeof(RefLapFileMagic)] = {};
+    int gridSize = 0;
+    unsigned char hasBest = 0;
+    RefLap best;
+    float segments[RefLap::GridSize];
+    bool ok = fread( magic, sizeof(magic), 1, fp ) == 1 && !memcmp( magic, RefLapFileMagic, sizeof(magic) );
+    ok = ok && fread( &gridSize, sizeof(gridSize), 1, fp ) == 1 && gridSize == RefLap::GridSize;
+    ok = ok && fread( &hasBest, 1, 1, fp ) == 1;
+    ok = ok && fread( best.time, sizeof(best.time), 1, fp ) == 1;
+    ok = ok && fread( segments, sizeof(segments), 1, fp ) == 1;
+    fclose( fp );
+    if( !ok )
+        return false;
+
+    best.valid = hasBest != 0;
+    m_refs[(int)RefLapKind::BEST] = best;
+    memcpy( m_bestSegment, segments, sizeof(m_bestSegment) );
+    rebuildOptimal();
+    m_dirty = false;
+    return true;
+}
+
+RefLapWriter::~RefLapWriter()
+{
+    if( !m_thread.joinable() )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk( m_mutex );
+        m_quit = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+void RefLapWriter::post( const std::string& filename, const RefLapFile& file )
+{
+    {
+        std::lock_guard<std::mutex> lk( m_mutex );
+
+        // A newer version of a file that's still waiting replaces it
+        bool replaced = false;
+        for( auto& p : m_pending ) {
+            if( p.first == filename ) {
+                p.second = file;
+                replaced = true;
+            }
+        }
+        if( !replaced )
+            m_pending.emplace_back( filename, file );
+
+        if( !m_thread.joinable() )
+            m_thread = std::thread( &RefLapWriter::writerThread, this );
+    }
+    m_cv.notify_one();
+}
+
+void RefLapWriter::writerThread()
+{
+    while( true )
+    {
+        std::pair<std::string,RefLapFile> p;
+        {
+            std::unique_lock<std::mutex> lk( m_mutex );
+            m_cv.wait( lk, [this]() { return m_quit || !m_pending.empty(); } );
+            if( m_pending.empty() )
+                break;  // quitting, and everything's written
+            p = std::move( m_pending.front() );
+            m_pending.erase( m_pending.begin() );
+        }
+
+        if( p.second.write( p.first ) )
+            m_numWritten++;
+        else
+            printf( "Could not save reference laps to %s\n", p.first.c_str() );
+    }
+}
@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Lap time as a function of lap distance, on a fixed grid, so the time at any point of the lap is
+// one interpolated lookup.
+struct RefLap
+{
+    static const int GridSize = 1024;
+
+    float   time[GridSize+1];   // seconds since the line at lap distance i/GridSize, time[GridSize] is the lap time
+    bool    valid = false;
+
+    float   lapTime() const { return time[GridSize]; }
+    float   timeAt( float pct ) const;
+};
+
+enum class RefLapKind
+{
+    BEST = 0,       // our best lap, kept across sessions per car and track
+    LAST,
+    OPTIMAL,        // best time through every grid segment, kept across sessions too
+    LOADED,         // imported, e.g. from an .ibt file
+    COUNT
+};
+static const char* const RefLapKindStr[] = {"best","last","optimal","loaded"};
+
+// What's kept on disk per car and track. Plain data, so it can be handed to the writer thread.
+struct RefLapFile
+{
+    RefLap  best;
+    float   bestSegment[RefLap::GridSize];
+
+    bool  write( const std::string& filename ) const;
+};
+
+// Records our laps onto the grid and compares the lap in progress against the reference laps.
+// update() does a small bounded amount of work per tick; finished laps are folded into the
+// references at the line, once per lap.
+class RefLapRecorder
+{
+    public:
+
+        RefLapRecorder() { reset(); }
+
+        // Forget the lap in progress and all references
+        void reset();
+
+        // Call every tick. 'clean' is false while on pit road, off track etc., which invalidates the lap.
+        void update( double sessionTime, float lapDistPct, bool clean );
+
+        // Delta of the lap in progress to a reference at the current point, and the lap time that
+        // would give. False if there's no such reference or no timed lap in progress.
+        bool delta( RefLapKind kind, float* delta, float* predictedLapTime ) const;
+
+        const RefLap& ref( RefLapKind kind ) const { return m_refs[(int)kind]; }
+        void  setLoaded( const RefLap& lap ) { m_refs[(int)RefLapKind::LOADED] = lap; }
+
+        // Best lap and best segments, per car and track. 'dirty' means there's something new to save.
+        // Taking the snapshot counts as saved, writing it is up to the caller (see RefLapWriter).
+        void  snapshot( RefLapFile& file );
+        bool  load( const std::string& filename );
+        bool  isDirty() const { return m_dirty; }
+
+        int   numLaps() const { return m_numLaps; }
+
+    private:
+
+        void  fillTo( float pct, double sessionTime );
+        void  completeLap( float lapTime );
+        void  rebuildOptimal();
+
+        RefLap  m_refs[(int)RefLapKind::COUNT];
+        RefLap  m_cur;
+        float   m_bestSegment[RefLap::GridSize];    // 0 if none yet
+        int     m_nextIdx;          // next grid point to fill in m_cur
+        double  m_lapStartTime;     // -1 if we didn't see the lap start
+        bool    m_lapClean;
+        float   m_prevPct;          // -1 if no previous sample
+        double  m_prevTime;
+        int     m_numLaps;
+        bool    m_dirty;
+};
+
+// Writes reference lap files on a background thread, so the tick thread never waits for the disk.
+// If the writer falls behind, only the latest version of each file is written.
+class RefLapWriter
+{
+    public:
+
+        ~RefLapWriter();    // writes whatever is still pending
+
+        void  post( const std::string& filename, const RefLapFile& file );
+
+        int   numWritten() const { return m_numWritten; }
+
+    private:
+
+        void  writerThread();
+
+        std::thread                 m_thread;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_cv;
+        std::vector<std::pair<std::string,RefLapFile>> m_pending;
+        bool                        m_quit = false;
+        std::atomic<int>            m_numWritten = {0};
+};
@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include <assert.h>
+#include <string.h>
+#include "RelativeKernel.h"
+
+#if defined(_M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 2 || defined(__SSE2__)
+#define IR_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+void ir_computeRelativesScalar( const RelativeInput& in, RelativeOutput& out )
+{
+    const int   self = in.selfIdx;
+    const float L = in.estLaptime;
+    const float S = in.estTime[self];
+
+    out.validMask = 0;
+    for( int i=0; i<IR_MAX_CARS; ++i )
+    {
+        const float C = in.estTime[i];
+        int lapDelta = in.lap[i] - in.lap[self];
+        float delta = 0;
+
+        // Does the delta between us and the other car span across the start/finish line?
+        const bool wrap = fabsf(in.lapDistPct[i] - in.lapDistPct[self]) > 0.5f;
+
+        if( wrap )
+        {
+            delta     = S > C ? (C-S)+L : (C-S)-L;
+            lapDelta += S > C ? -1 : 1;
+        }
+        else
+        {
+            delta = C - S;
+        }
+
+        if( in.zeroLapDeltas || ((in.zeroLapDeltaMask >> i) & 1) )
+            lapDelta = 0;
+
+        out.delta[i] = delta;
+        out.lapDelta[i] = lapDelta;
+        if( in.lap[i] >= 0 && ((in.candidateMask >> i) & 1) )
+            out.validMask |= 1ULL << i;
+    }
+}
+
+#ifdef IR_HAVE_SSE2
+
+static void computeRelativesSSE2( const RelativeInput& in, RelativeOutput& out )
+{
+    const int    self     = in.selfIdx;
+    const __m128 L        = _mm_set1_ps( in.estLaptime );
+    const __m128 negL     = _mm_set1_ps( -in.estLaptime );
+    const __m128 S        = _mm_set1_ps( in.estTime[self] );
+    const __m128 pctS     = _mm_set1_ps( in.lapDistPct[self] );
+    const __m128 half     = _mm_set1_ps( 0.5f );
+    const __m128 absMask  = _mm_castsi128_ps( _mm_set1_epi32(0x7fffffff) );
+    const __m128i lapS    = _mm_set1_epi32( in.lap[self] );
+    const __m128i one     = _mm_set1_epi32( 1 );
+    const __m128i minusOne= _mm_set1_epi32( -1 );
+    const __m128i laneBit = _mm_set_epi32( 8, 4, 2, 1 );
+    const __m128i keepAll = in.zeroLapDeltas ? _mm_setzero_si128() : minusOne;
+
+    unsigned long long valid = 0;
+    for( int i=0; i<IR_MAX_CARS; i+=4 )
+    {
+        const __m128  C    = _mm_loadu_ps( in.estTime + i );
+        const __m128  pctC = _mm_loadu_ps( in.lapDistPct + i );
+        const __m128i lapC = _mm_loadu_si128( (const __m128i*)(in.lap + i) );
+
+        // wrap = |pctC - pctS| > 0.5, sGtC = S > C
+        const __m128 wrap = _mm_cmpgt_ps( _mm_and_ps(_mm_sub_ps(pctC, pctS), absMask), half );
+        const __m128 sGtC = _mm_cmpgt_ps( S, C );
+
+        // delta = (C-S) + (wrap ? (S>C ? L : -L) : 0)
+        const __m128 adj   = _mm_or_ps( _mm_and_ps(sGtC, L), _mm_andnot_ps(sGtC, negL) );
+        const __m128 delta = _mm_add_ps( _mm_sub_ps(C, S), _mm_and_ps(wrap, adj) );
+
+        // lapDelta = lapC - lapS + (wrap ? (S>C ? -1 : 1) : 0). All ones is -1, so (sGtC | 1) is -1 or 1.
+        const __m128i lapAdj = _mm_or_si128( _mm_castps_si128(sGtC), one );
+        __m128i lapDelta = _mm_add_epi32( _mm_sub_epi32(lapC, lapS), _mm_and_si128(_mm_castps_si128(wrap), lapAdj) );
+
+        // Zero the lap deltas of the lanes in zeroLapDeltaMask, or all of them
+        const __m128i zeroBits = _mm_set1_epi32( int((in.zeroLapDeltaMask >> i) & 0xf) );
+        const __m128i zeroLane = _mm_cmpeq_epi32( _mm_and_si128(zeroBits, laneBit), laneBit );
+        lapDelta = _mm_and_si128( lapDelta, _mm_andnot_si128(zeroLane, keepAll) );
+
+        _mm_storeu_ps( out.delta + i, delta );
+        _mm_storeu_si128( (__m128i*)(out.lapDelta + i), lapDelta );
+
+        // lapC >= 0
+        const int inSession = _mm_movemask_ps( _mm_castsi128_ps(_mm_cmpgt_epi32(lapC, minusOne)) );
+        valid |= (unsigned long long)inSession << i;
+    }
+    out.validMask = valid & in.candidateMask;
+}
+
+#endif
+
+void ir_computeRelatives( const RelativeInput& in, RelativeOutput& out )
+{
+#ifdef IR_HAVE_SSE2
+    computeRelativesSSE2( in, out );
+#ifdef _DEBUG
+    RelativeOutput ref;
+    ir_computeRelativesScalar( in, ref );
+    assert( ref.validMask == out.validMask );
+    assert( !memcmp(ref.lapDelta, out.lapDelta, sizeof(ref.lapDelta)) );
+    for( int i=0; i<IR_MAX_CARS; ++i )
+        assert( ref.delta[i] == out.delta[i] || (ref.delta[i] != ref.delta[i] && out.delta[i] != out.delta[i]) );
+#endif
+#else
+    ir_computeRelativesScalar( in, out );
+#endif
+}
+
+void ir_computeRelativeMatrix( const RelativeInput& in, const float* estLaptime, unsigned long long rowMask, RelativeMatrix& out )
+{
+    RelativeInput rowIn = in;
+    for( int row=0; row<IR_MAX_CARS; ++row )
+    {
+        if( !((rowMask >> row) & 1) )
+            continue;
+
+        rowIn.selfIdx    = row;
+        rowIn.estLaptime = estLaptime[row];
+        ir_computeRelatives( rowIn, out.rows[row] );
+    }
+    out.rowMask          = rowMask;
+    out.candidateMask    = in.candidateMask;
+    out.zeroLapDeltaMask = in.zeroLapDeltaMask;
+    out.zeroLapDeltas    = in.zeroLapDeltas;
+}
@@ -0,0 +1,73 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+// Time deltas from our car to every other car, as shown in the Relative overlay.
+//
+// If the other car is up to half a lap in front, the delta is 'ahead', otherwise 'behind'. When that
+// spans the start/finish line, the delta is corrected by a lap time and the lap delta by one lap.
+
+struct RelativeInput
+{
+    const float*        estTime = nullptr;      // [IR_MAX_CARS] CarIdxEstTime
+    const float*        lapDistPct = nullptr;   // [IR_MAX_CARS] CarIdxLapDistPct
+    const int*          lap = nullptr;          // [IR_MAX_CARS] CarIdxLap
+    unsigned long long  candidateMask = 0;      // cars that may be listed at all
+    unsigned long long  zeroLapDeltaMask = 0;   // cars considered on our lap regardless (e.g. pace car)
+    bool                zeroLapDeltas = false;  // no lap deltas at all (not a race, or before the start)
+    int                 selfIdx = 0;
+    float               estLaptime = 0;
+};
+
+struct RelativeOutput
+{
+    float               delta[IR_MAX_CARS];
+    int                 lapDelta[IR_MAX_CARS];
+    unsigned long long  validMask = 0;          // candidates that are in the session (lap >= 0)
+};
+
+// Straightforward version, the reference for the one below.
+void ir_computeRelativesScalar( const RelativeInput& in, RelativeOutput& out );
+
+// Same results, branch-free with SSE2, four cars at a time. Falls back to the scalar version where
+// SSE2 isn't available. Debug builds check it against the scalar version on every call.
+void ir_computeRelatives( const RelativeInput& in, RelativeOutput& out );
+
+// Relatives from every car's point of view, one row per focus car, so following a different car
+// is just reading a different row.
+struct RelativeMatrix
+{
+    RelativeOutput      rows[IR_MAX_CARS];
+    unsigned long long  rowMask = 0;            // rows computed on the last update
+    unsigned long long  candidateMask = 0;      // the masks the rows were computed with
+    unsigned long long  zeroLapDeltaMask = 0;
+    bool                zeroLapDeltas = false;
+};
+
+// Computes the rows in 'rowMask' in place. 'in.selfIdx' and 'in.estLaptime' are ignored, each row
+// uses its own car and estLaptime[row].
+void ir_computeRelativeMatrix( const RelativeInput& in, const float* estLaptime, unsigned long long rowMask, RelativeMatrix& out );
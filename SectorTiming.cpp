@@ -0,0 +1,234 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "SectorTiming.h"
+
+void SectorTiming::setNumSectors( int n )
+{
+    n = std::min( std::max( 1, n ), int(MaxSectors) );
+    if( n == m_numSectors )
+        return;
+    m_numSectors = n;
+    reset();
+}
+
+void SectorTiming::reset()
+{
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        clearCar( carIdx );
+        m_userId[carIdx] = 0;
+        m_carClassIdx[carIdx] = -1;
+    }
+    for( int classIdx=0; classIdx<IR_MAX_CARS; ++classIdx )
+    {
+        clearClass( classIdx );
+        m_classId[classIdx] = 0;
+    }
+    m_lastTime = -1;
+}
+
+void SectorTiming::clearCar( int carIdx )
+{
+    for( int s=0; s<MaxSectors; ++s )
+    {
+        m_crossTime[carIdx][s] = -1;
+        m_sectorTime[carIdx][s] = 0;
+        m_bestSectorTime[carIdx][s] = 0;
+    }
+    m_lastBoundary[carIdx] = -1;
+    resetCar( carIdx );
+}
+
+void SectorTiming::clearClass( int classIdx )
+{
+    for( int s=0; s<MaxSectors; ++s )
+    {
+        m_classBest[classIdx][s] = 0;
+        m_classBestCarIdx[classIdx][s] = -1;
+    }
+}
+
+void SectorTiming::resetCar( int carIdx )
+{
+    m_prevPct[carIdx] = -1;
+    m_prevTime[carIdx] = 0;
+    m_sectorClean[carIdx] = false;
+}
+
+void SectorTiming::cross( int carIdx, int boundary, double t )
+{
+    const int prev = (boundary + m_numSectors - 1) % m_numSectors;
+
+    if( m_sectorClean[carIdx] && m_lastBoundary[carIdx] == prev )
+    {
+        const float st = float( t - m_crossTime[carIdx][prev] );
+        m_sectorTime[carIdx][prev] = st;
+
+        float& best = m_bestSectorTime[carIdx][prev];
+        if( best <= 0 || st < best )
+            best = st;
+
+        const int classIdx = m_carClassIdx[carIdx];
+        if( classIdx >= 0 && (m_classBest[classIdx][prev] <= 0 || st < m_classBest[classIdx][prev]) ) {
+            m_classBest[classIdx][prev] = st;
+            m_classBestCarIdx[classIdx][prev] = carIdx;
+        }
+    }
+
+    m_crossTime[carIdx][boundary] = t;
+    m_lastBoundary[carIdx] = boundary;
+    m_sectorClean[carIdx] = true;
+}
+
+void SectorTiming::update( double sessionTime, const Session& session, const float* lapDistPct, const bool* onPitRoad, unsigned long long validMask )
+{
+    // Session time going backwards means a new session (or a replay jump)
+    if( sessionTime < m_lastTime )
+        reset();
+    m_lastTime = sessionTime;
+
+    // Class bests are only comparable within the same class
+    for( int classIdx=0; classIdx<session.numClasses; ++classIdx )
+    {
+        if( session.classes[classIdx].classId != m_classId[classIdx] )
+        {
+            clearClass( classIdx );
+            m_classId[classIdx] = session.classes[classIdx].classId;
+        }
+    }
+
+    const float n = (float)m_numSectors;
+
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        const float pct = lapDistPct[carIdx];
+
+        // Someone else in this slot: their times aren't ours, and neither are the class bests we held
+        const Car& car = session.cars[carIdx];
+        if( car.userId != m_userId[carIdx] )
+        {
+            clearCar( carIdx );
+            for( int classIdx=0; classIdx<IR_MAX_CARS; ++classIdx )
+                for( int s=0; s<MaxSectors; ++s )
+                    if( m_classBestCarIdx[classIdx][s] == carIdx )
+                        m_classBestCarIdx[classIdx][s] = -1;
+            m_userId[carIdx] = car.userId;
+        }
+        m_carClassIdx[carIdx] = car.classIdx;
+
+        if( !((validMask >> carIdx) & 1) || pct < 0 ) {
+            resetCar( carIdx );
+            continue;
+        }
+
+        const float  p0 = m_prevPct[carIdx];
+        const double t0 = m_prevTime[carIdx];
+
+        if( onPitRoad[carIdx] )
+            m_sectorClean[carIdx] = false;
+
+        if( p0 < 0 ) {
+            // Starting mid-sector, so the first sector time would be incomplete
+            m_prevPct[carIdx] = pct;
+            m_prevTime[carIdx] = sessionTime;
+            m_sectorClean[carIdx] = false;
+            continue;
+        }
+
+        float p1 = pct;
+        if( p1 < p0 - 0.5f )
+            p1 += 1.0f;     // crossed the s/f line
+
+        const float d = p1 - p0;
+        if( d < 0 )
+            continue;       // rolled backwards a bit, wait until we're past the old spot again
+        if( d > 0.25f || sessionTime - t0 > 5.0 ) {
+            // Towed, reset or simply not updated for a while. Don't make up crossings.
+            m_prevPct[carIdx] = pct;
+            m_prevTime[carIdx] = sessionTime;
+            m_sectorClean[carIdx] = false;
+            continue;
+        }
+
+        // Every boundary in (p0,p1], with its time interpolated linearly within the tick
+        for( int b = (int)floorf( p0*n ) + 1; b <= (int)floorf( p1*n ); ++b )
+        {
+            const float  bp = b / n;
+            const double t  = t0 + (sessionTime - t0) * double( (bp - p0) / d );
+            cross( carIdx, b % m_numSectors, t );
+        }
+
+        m_prevPct[carIdx] = pct;
+        m_prevTime[carIdx] = sessionTime;
+    }
+}
+
+float SectorTiming::currentSectorTime( int carIdx ) const
+{
+    const int b = m_lastBoundary[carIdx];
+    if( b < 0 || m_lastTime < 0 || !m_sectorClean[carIdx] )
+        return 0;
+    return float( m_lastTime - m_crossTime[carIdx][b] );
+}
+
+bool SectorTiming::gap( int carA, int carB, float* gapSec ) const
+{
+    if( carA < 0 || carB < 0 || carA >= IR_MAX_CARS || carB >= IR_MAX_CARS )
+        return false;
+
+    // The car that's behind at the timing loop is the one that crossed the common boundary last,
+    // so the candidates are each car's latest boundary. If the car in front has since crossed
+    // the other one's boundary again, that candidate spans an extra lap; the interval on the
+    // road is the smaller of the two. Crossings minutes apart belong to different passes.
+    const double maxGap = 300;
+    double best = maxGap;
+    bool   found = false;
+
+    const int bB = m_lastBoundary[carB];
+    if( bB >= 0 )
+    {
+        const double ta = m_crossTime[carA][bB];
+        const double tb = m_crossTime[carB][bB];
+        if( ta >= 0 && ta <= tb && tb - ta < best ) {
+            best = tb - ta;
+            *gapSec = float( tb - ta );
+            found = true;
+        }
+    }
+
+    const int bA = m_lastBoundary[carA];
+    if( bA >= 0 )
+    {
+        const double ta = m_crossTime[carA][bA];
+        const double tb = m_crossTime[carB][bA];
+        if( tb >= 0 && tb <= ta && ta - tb < best ) {
+            *gapSec = -float( ta - tb );
+            found = true;
+        }
+    }
+    return found;
+}
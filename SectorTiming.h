@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Session.h"
+
+// Splits the lap into evenly spaced mini-sectors and records, for every car, when it last crossed
+// each sector boundary. Crossings are interpolated between ticks from CarIdxLapDistPct, so sector
+// times are accurate to well below the 60Hz tick interval. Memory is fixed at IR_MAX_CARS x MaxSectors.
+// Bests are kept per car and per class. A car slot that gets a different driver starts over.
+class SectorTiming
+{
+    public:
+
+        static const int MaxSectors = 64;
+
+        SectorTiming() { setNumSectors( 20 ); }
+
+        // Changing the number of sectors forgets all timing data.
+        void setNumSectors( int n );
+        int  numSectors() const { return m_numSectors; }
+
+        void reset();
+
+        // Call once per tick. Cars not in 'validMask' or with lapDistPct < 0 are skipped and resume
+        // timing at their next boundary. 'session' provides each car's driver and class.
+        void update( double sessionTime, const Session& session, const float* lapDistPct, const bool* onPitRoad, unsigned long long validMask );
+
+        // Last completed time for sector s (between boundaries s and s+1), 0 if none.
+        float sectorTime( int carIdx, int s ) const { return m_sectorTime[carIdx][s]; }
+        float bestSectorTime( int carIdx, int s ) const { return m_bestSectorTime[carIdx][s]; }
+
+        // Best in a class (index into Session::classes), and the car that set it (-1 if it has left).
+        float classBestSectorTime( int classIdx, int s ) const { return classIdx >= 0 ? m_classBest[classIdx][s] : 0; }
+        int   classBestCarIdx( int classIdx, int s ) const { return classIdx >= 0 ? m_classBestCarIdx[classIdx][s] : -1; }
+
+        // Boundary the car crossed last, -1 if none yet. The car is in sector lastBoundary(carIdx).
+        int   lastBoundary( int carIdx ) const { return m_lastBoundary[carIdx]; }
+        double crossingTime( int carIdx, int boundary ) const { return m_crossTime[carIdx][boundary]; }
+
+        // Time spent in the current sector so far, 0 if unknown.
+        float currentSectorTime( int carIdx ) const;
+
+        // Gap between two cars at the latest timing boundary both have crossed, as a timing loop
+        // would show it: positive if carB passed it after carA. Ignores laps. False if unknown.
+        bool  gap( int carA, int carB, float* gapSec ) const;
+
+    private:
+
+        void resetCar( int carIdx );
+        void clearCar( int carIdx );
+        void clearClass( int classIdx );
+        void cross( int carIdx, int boundary, double t );
+
+        int     m_numSectors = 0;
+        double  m_lastTime = -1;
+
+        double  m_crossTime[IR_MAX_CARS][MaxSectors];       // by boundary, < 0 if never crossed
+        float   m_sectorTime[IR_MAX_CARS][MaxSectors];
+        float   m_bestSectorTime[IR_MAX_CARS][MaxSectors];
+        float   m_classBest[IR_MAX_CARS][MaxSectors];       // by Session::classes index
+        int     m_classBestCarIdx[IR_MAX_CARS][MaxSectors];
+        int     m_classId[IR_MAX_CARS];                     // class the bests above are for
+
+        int     m_userId[IR_MAX_CARS];                      // driver the per-car times are for
+        int     m_carClassIdx[IR_MAX_CARS];
+
+        int     m_lastBoundary[IR_MAX_CARS];
+        bool    m_sectorClean[IR_MAX_CARS];                 // current sector started from the previous boundary and saw no pit road
+        float   m_prevPct[IR_MAX_CARS];                     // < 0 if the car wasn't tracked last tick
+        double  m_prevTime[IR_MAX_CARS];
+};
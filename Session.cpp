@@ -0,0 +1,556 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <limits.h>
+#include <algorithm>
+#include "Session.h"
+#include "irsdk/yaml_parser.h"
+
+static bool parseYamlInt(const char *yamlStr, const char *path, int *dest)
+{
+    int count = 0;
+    const char *s = nullptr;
+
+    if( parseYaml(yamlStr, path, &s, &count) )
+    {
+        *dest = atoi( s );
+        return true;
+    }
+
+    return false;
+}
+
+static bool parseYamlFloat(const char *yamlStr, const char *path, float *dest)
+{
+    int count = 0;
+    const char *s = nullptr;
+
+    if( parseYaml(yamlStr, path, &s, &count) )
+    {
+        (*dest) = (float)atof( s );
+        return true;
+    }
+
+    return false;
+}
+
+static bool parseYamlStr(const char *yamlStr, const char *path, std::string& dest)
+{
+    int count = 0;
+    const char *s = nullptr;
+
+    if( parseYaml(yamlStr, path, &s, &count) )
+    {
+        // strip leading quotes
+        if( *s == '"' )
+        {
+            s++;
+            count--;
+        }
+
+        dest.assign( s, count );
+
+        // strip trailing quotes
+        if( !dest.empty() && dest[dest.length()-1]=='"' )
+            dest.pop_back();
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool parseYamlStr(const char *yamlStr, const char *path, StringPool& pool, const char** dest)
+{
+    int count = 0;
+    const char *s = nullptr;
+
+    if( parseYaml(yamlStr, path, &s, &count) )
+    {
+        // strip leading and trailing quotes
+        if( count && *s == '"' )
+        {
+            s++;
+            count--;
+        }
+        if( count && s[count-1] == '"' )
+            count--;
+
+        *dest = pool.add( s, count );
+        return true;
+    }
+
+    return false;
+}
+
+static float4 hexToCol( const char* str )
+{
+    unsigned hex = 0;
+    sscanf( str, "0x%x", &hex );
+    return float4( float((hex >> 16) & 0xff) / 255.f, float((hex >> 8) & 0xff) / 255.f, float((hex >> 0) & 0xff) / 255.f, 1 );
+}
+
+// Fill session.results from SessionInfo:Sessions in a single pass over the section, instead of
+// one parseYaml() scan per value.
+static void parseSessionResults( const char* sessionYaml, Session& session )
+{
+    for( SessionResults& res : session.results )
+    {
+        res = SessionResults();
+        std::fill( res.byCarIdx, res.byCarIdx+IR_MAX_CARS, -1 );
+    }
+    session.numSessions = 0;
+
+    const char* s = !strncmp( sessionYaml, "SessionInfo:", 12 ) ? sessionYaml : strstr( sessionYaml, "\nSessionInfo:" );
+    if( !s )
+        return;
+    s = strchr( s+1, '\n' );
+
+    #define KEY_IS(k) (keyLen == sizeof(k)-1 && !strncmp(key, k, sizeof(k)-1))
+
+    SessionResults* res = nullptr;      // session we're in
+    ResultsEntry*   entry = nullptr;    // results line we're in
+    int  sessionKeyCol = -1;
+    int  entryKeyCol = -1;
+    bool inResults = false;
+
+    while( s && *s )
+    {
+        const char* line = ++s;         // skip the '\n'
+        s = strchr( line, '\n' );
+        const char* eol = s ? s : line + strlen(line);
+
+        int indent = 0;
+        while( line[indent] == ' ' )
+            ++indent;
+        if( line+indent == eol )
+            continue;
+        if( indent == 0 )
+            break;  // next top-level section
+
+        const bool isItem = line[indent] == '-';
+        const int  keyCol = isItem ? indent+2 : indent;
+        const char* key = line + keyCol;
+        const char* colon = (const char*)memchr( key, ':', eol-key );
+        if( !colon )
+            continue;
+        const int keyLen = int(colon - key);
+        const char* val = colon + 1;
+        while( val < eol && *val == ' ' )
+            ++val;
+        const int valLen = int(eol - val) - (eol > val && eol[-1] == '\r');
+
+        if( isItem && KEY_IS("SessionNum") )
+        {
+            const int num = atoi( val );
+            res = num>=0 && num<IR_MAX_SESSIONS ? &session.results[num] : nullptr;
+            session.numSessions = std::max( session.numSessions, res ? num+1 : 0 );
+            sessionKeyCol = keyCol;
+            inResults = false;
+            entry = nullptr;
+            continue;
+        }
+        if( !res )
+            continue;
+
+        if( keyCol == sessionKeyCol )
+        {
+            inResults = KEY_IS("ResultsPositions");
+            entry = nullptr;
+            if( KEY_IS("SessionName") )
+            {
+                if( valLen==8 && !strncmp(val,"PRACTICE",8) )
+                    res->sessionType = SessionType::PRACTICE;
+                else if( valLen==7 && !strncmp(val,"QUALIFY",7) )
+                    res->sessionType = SessionType::QUALIFY;
+                else if( valLen==4 && !strncmp(val,"RACE",4) )
+                    res->sessionType = SessionType::RACE;
+            }
+            else if( KEY_IS("SessionTime") )
+                res->isUnlimitedTime = int( valLen==9 && !strncmp(val,"unlimited",9) );
+            else if( KEY_IS("SessionLaps") )
+                res->isUnlimitedLaps = int( valLen==9 && !strncmp(val,"unlimited",9) );
+            continue;
+        }
+        if( !inResults || keyCol < sessionKeyCol )
+            continue;
+
+        if( isItem && KEY_IS("Position") )
+        {
+            const int pos = atoi( val );
+            entry = pos>=1 && pos<=IR_MAX_CARS ? &res->byPosition[pos-1] : nullptr;
+            if( entry ) {
+                entry->position = pos;
+                res->numPositions = std::max( res->numPositions, pos );
+            }
+            entryKeyCol = keyCol;
+            continue;
+        }
+        if( !entry || keyCol != entryKeyCol )
+            continue;
+
+        if( KEY_IS("ClassPosition") )       entry->classPosition = atoi(val) + 1;
+        else if( KEY_IS("CarIdx") )         entry->carIdx = atoi(val);
+        else if( KEY_IS("Lap") )            entry->lap = atoi(val);
+        else if( KEY_IS("Time") )           entry->time = (float)atof(val);
+        else if( KEY_IS("FastestLap") )     entry->fastestLap = atoi(val);
+        else if( KEY_IS("FastestTime") )    entry->fastestTime = (float)atof(val);
+        else if( KEY_IS("LastTime") )       entry->lastTime = (float)atof(val);
+        else if( KEY_IS("LapsLed") )        entry->lapsLed = atoi(val);
+        else if( KEY_IS("LapsComplete") )   entry->lapsComplete = atoi(val);
+        else if( KEY_IS("LapsDriven") )     entry->lapsDriven = (float)atof(val);
+        else if( KEY_IS("Incidents") )      entry->incidents = atoi(val);
+        else if( KEY_IS("ReasonOutId") )    entry->reasonOutId = atoi(val);
+        else if( KEY_IS("ReasonOutStr") )   entry->reasonOutStr = session.strings.add( val, std::max(0,valLen) );
+    }
+
+    #undef KEY_IS
+
+    // Index by car
+    for( int num=0; num<session.numSessions; ++num )
+    {
+        SessionResults& r = session.results[num];
+        for( int i=0; i<r.numPositions; ++i )
+        {
+            const int carIdx = r.byPosition[i].carIdx;
+            if( carIdx >= 0 && carIdx < IR_MAX_CARS )
+                r.byCarIdx[carIdx] = i;
+            else
+                r.byPosition[i].carIdx = -1;
+        }
+    }
+}
+
+static void buildClassTables( Session& session )
+{
+    // Collect the classes and their members
+    session.numClasses = 0;
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        session.cars[carIdx].classIdx = -1;
+        session.cars[carIdx].classPosition = 0;
+    }
+    for( int i=0; i<session.numActiveCars; ++i )
+    {
+        const int carIdx = session.activeCarIdx[i];
+        Car& car = session.cars[carIdx];
+
+        if( car.isPaceCar )
+            continue;
+
+        int classIdx = 0;
+        while( classIdx < session.numClasses && session.classes[classIdx].classId != car.classId )
+            ++classIdx;
+
+        CarClass& cls = session.classes[classIdx];
+        if( classIdx == session.numClasses )
+        {
+            session.numClasses++;
+            cls = CarClass();
+            cls.classId    = car.classId;
+            cls.shortName  = car.classShortName;
+            cls.col        = car.classCol;
+            cls.estLapTime = car.carClassEstLapTime;
+        }
+        cls.carIdx[cls.numCars++] = carIdx;
+    }
+
+    // Fastest class first
+    std::sort( session.classes, session.classes+session.numClasses,
+        []( const CarClass& a, const CarClass& b ) { return a.estLapTime < b.estLapTime; } );
+
+    for( int classIdx=0; classIdx<session.numClasses; ++classIdx )
+    {
+        CarClass& cls = session.classes[classIdx];
+
+        // Order the members by the best position we know of (same precedence as ir_getPosition()),
+        // cars without any position go last.
+        auto sessionPos = [&session]( int carIdx ) {
+            const Car& car = session.cars[carIdx];
+            const int pos = car.racePosition ? car.racePosition : (car.qualPosition ? car.qualPosition : car.practicePosition);
+            return pos > 0 ? pos : INT_MAX;
+        };
+        // Insertion sort on (position, carIdx) in place, the class tables are small and this runs on
+        // every session update without allocating (std::stable_sort grabs a temporary buffer).
+        for( int i=1; i<cls.numCars; ++i )
+        {
+            const int carIdx = cls.carIdx[i];
+            const int pos = sessionPos( carIdx );
+            int j = i;
+            for( ; j>0; --j )
+            {
+                const int prevPos = sessionPos( cls.carIdx[j-1] );
+                if( prevPos < pos || (prevPos == pos && cls.carIdx[j-1] < carIdx) )
+                    break;
+                cls.carIdx[j] = cls.carIdx[j-1];
+            }
+            cls.carIdx[j] = carIdx;
+        }
+
+        double sof = 0;
+        for( int i=0; i<cls.numCars; ++i )
+        {
+            Car& car = session.cars[cls.carIdx[i]];
+            car.classIdx = classIdx;
+            car.classPosition = sessionPos(cls.carIdx[i])!=INT_MAX ? i+1 : 0;
+            sof += car.irating;
+        }
+        cls.sof = cls.numCars ? int(sof / cls.numCars) : 0;
+    }
+}
+
+unsigned long long ir_hashSessionStr( const char* sessionYaml, int maxLen, int sessionNum )
+{
+    // Top-level sections we parse. Everything else is ignored for the hash.
+    static const char* const sections[] = { "WeekendInfo:", "SessionInfo:", "QualifyResultsInfo:", "DriverInfo:" };
+
+    unsigned long long hash = (unsigned long long)sessionNum;
+
+    const char* s = sessionYaml;
+    const char* end = sessionYaml + maxLen;
+    const char* sectionStart = nullptr;   // start of the current section if it's one we care about
+
+    // Sections start with an unindented key line
+    while( s < end && *s )
+    {
+        if( *s != ' ' && *s != '-' && *s != '\n' )
+        {
+            if( sectionStart )
+                hash = MurmurHash64A( sectionStart, int(s-sectionStart), hash );
+            sectionStart = nullptr;
+
+            for( const char* name : sections )
+            {
+                const size_t n = strlen( name );
+                if( size_t(end-s) >= n && !strncmp( s, name, n ) )
+                    sectionStart = s;
+            }
+        }
+
+        // Next line
+        while( s < end && *s && *s != '\n' )
+            ++s;
+        if( s < end && *s )
+            ++s;
+    }
+    if( sectionStart )
+        hash = MurmurHash64A( sectionStart, int(s-sectionStart), hash );
+
+    return hash;
+}
+
+void ir_parseSessionStr( const char* sessionYaml, int sessionNum, Session& session )
+{
+    char path[256];
+
+    // Weekend info
+    sprintf( path, "WeekendInfo:SubSessionID:" );
+    parseYamlInt( sessionYaml, path, &session.subsessionId );
+
+    sprintf( path, "WeekendInfo:WeekendOptions:IsFixedSetup:" );
+    parseYamlInt( sessionYaml, path, &session.isFixedSetup );
+
+    // "6.9300 km", or in miles
+    {
+        const char* s = nullptr;
+        int count = 0;
+        session.trackLengthM = 0;
+        if( parseYaml( sessionYaml, "WeekendInfo:TrackLength:", &s, &count ) )
+        {
+            const bool miles = count >= 2 && s[count-2] == 'm' && s[count-1] == 'i';
+            session.trackLengthM = (float)atof( s ) * (miles ? 1609.344f : 1000.0f);
+        }
+    }
+
+    // Current session type
+    std::string sessionNameStr;
+    sprintf( path, "SessionInfo:Sessions:SessionNum:{%d}SessionName:", sessionNum );
+    parseYamlStr( sessionYaml, path, sessionNameStr );
+    if( sessionNameStr == "PRACTICE" )
+        session.sessionType = SessionType::PRACTICE;
+    if( sessionNameStr == "QUALIFY" )
+        session.sessionType = SessionType::QUALIFY;
+    else if( sessionNameStr == "RACE" )
+        session.sessionType = SessionType::RACE;
+
+    // Driver/car info
+    parseYamlInt( sessionYaml, "DriverInfo:DriverCarIdx:", &session.driverCarIdx );
+    parseYamlFloat( sessionYaml, "DriverInfo:DriverCarFuelMaxLtr:", &session.fuelMaxLtr );
+    parseYamlFloat( sessionYaml, "DriverInfo:DriverCarIdleRPM:", &session.rpmIdle );
+    parseYamlFloat( sessionYaml, "DriverInfo:DriverCarRedLine:", &session.rpmRedline );
+    parseYamlFloat( sessionYaml, "DriverInfo:DriverCarSLFirstRPM:", &session.rpmSLFirst );
+    parseYamlFloat( sessionYaml, "DriverInfo:DriverCarSLShiftRPM:", &session.rpmSLShift );
+    parseYamlFloat( sessionYaml, "DriverInfo:DriverCarSLLastRPM:", &session.rpmSLLast );
+    parseYamlFloat( sessionYaml, "DriverInfo:DriverCarSLBlinkRPM:", &session.rpmSLBlink );
+
+    // Per-Driver info. All the strings we keep are substrings of the session string, so sizing
+    // the pool after it (plus terminators) guarantees it never has to grow while we fill it.
+    session.strings.reset( strlen(sessionYaml) + 6*IR_MAX_CARS + IR_MAX_SESSIONS*IR_MAX_CARS + 2 );
+
+    // Which car on which track, e.g. for data kept per car and track
+    session.trackName = session.driverCarPath = "";
+    parseYamlStr( sessionYaml, "WeekendInfo:TrackName:", session.strings, &session.trackName );
+    sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarPath:", session.driverCarIdx );
+    parseYamlStr( sessionYaml, path, session.strings, &session.driverCarPath );
+    session.numCarSlots = std::min( std::max( 0, session.numCarSlots ), IR_MAX_CARS );
+    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    {
+        Car& car = session.cars[carIdx];
+
+        // The old strings went away with the pool reset
+        car.userName = car.carNumberStr = car.licenseStr = car.licenseColStr = car.classShortName = "";
+        car.isSelf = int( carIdx==session.driverCarIdx );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}UserName:", carIdx );
+        if( carIdx >= session.numCarSlots || !parseYamlStr( sessionYaml, path, session.strings, &car.userName ) )
+        {
+            car = Car();
+            continue;
+        }
+
+        // Remove line breaks in user names if we find any (saw this happen once)
+        for( char* c = (char*)car.userName; *c; ++c )
+            *c = (*c=='\n'||*c=='\r') ? ' ' : *c;
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}UserID:", carIdx );
+        parseYamlInt( sessionYaml, path, &car.userId );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarNumber:", carIdx );
+        parseYamlStr( sessionYaml, path, session.strings, &car.carNumberStr );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarNumberRaw:", carIdx );
+        parseYamlInt( sessionYaml, path, &car.carNumber );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}LicString:", carIdx );
+        parseYamlStr( sessionYaml, path, session.strings, &car.licenseStr );
+        car.licenseChar = car.licenseStr[0] ? car.licenseStr[0] : 'R';
+        car.licenseSR = car.licenseStr[0] ? (float)atof( car.licenseStr+1 ) : 0;
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}LicColor:", carIdx );
+        parseYamlStr( sessionYaml, path, session.strings, &car.licenseColStr );
+        car.licenseCol = hexToCol( car.licenseColStr );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}IRating:", carIdx );
+        parseYamlInt( sessionYaml, path, &car.irating );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarIsPaceCar:", carIdx );
+        parseYamlInt( sessionYaml, path, &car.isPaceCar );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}IsSpectator:", carIdx );
+        parseYamlInt( sessionYaml, path, &car.isSpectator );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CurDriverIncidentCount:", carIdx );
+        parseYamlInt( sessionYaml, path, &car.incidentCount );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarClassEstLapTime:", carIdx );
+        parseYamlFloat( sessionYaml, path, &car.carClassEstLapTime );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarClassID:", carIdx );
+        parseYamlInt( sessionYaml, path, &car.classId );
+
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarClassShortName:", carIdx );
+        parseYamlStr( sessionYaml, path, session.strings, &car.classShortName );
+
+        const char* classColStr = "";
+        sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarClassColor:", carIdx );
+        if( parseYamlStr( sessionYaml, path, session.strings, &classColStr ) )
+            car.classCol = hexToCol( classColStr );
+
+        car.practicePosition = 0;
+        car.qualPosition = 0;
+        car.racePosition = 0;
+    }
+
+    // Qualifying results info
+    for( int pos=0; pos<IR_MAX_CARS; ++pos )
+    {
+        sprintf( path, "QualifyResultsInfo:Results:Position:{%d}CarIdx:", pos );
+        int carIdx = -1;
+        if( parseYamlInt( sessionYaml, path, &carIdx ) ) {
+            session.cars[carIdx].qualPosition = pos + 1;
+
+            sprintf( path, "QualifyResultsInfo:Results:Position:{%d}FastestTime:", pos );
+            parseYamlFloat( sessionYaml, path, &session.cars[carIdx].qualTime );
+        }
+    }
+
+    // Session info and results (may override qual results from above, but that's ok since hopefully they're the same!)
+    parseSessionResults( sessionYaml, session );
+    for( int num=0; num<session.numSessions; ++num )
+    {
+        const SessionResults& res = session.results[num];
+
+        session.isUnlimitedTime = res.isUnlimitedTime;
+        session.isUnlimitedLaps = res.isUnlimitedLaps;
+
+        for( int i=0; i<res.numPositions; ++i )
+        {
+            const ResultsEntry& e = res.byPosition[i];
+            if( e.carIdx < 0 )
+                continue;
+
+            if( res.sessionType == SessionType::PRACTICE )
+                session.cars[e.carIdx].practicePosition = e.position;
+            else if( res.sessionType == SessionType::QUALIFY )
+                session.cars[e.carIdx].qualPosition = e.position;
+            else if( res.sessionType == SessionType::RACE )
+                session.cars[e.carIdx].racePosition = e.position;
+        }
+    }
+
+    // Active cars, so per-car loops don't have to skip over empty slots
+    session.numActiveCars = 0;
+    session.activeMask = 0;
+    session.paceCarIdx = -1;
+    for( int carIdx=0; carIdx<session.numCarSlots; ++carIdx )
+    {
+        const Car& car = session.cars[carIdx];
+
+        if( car.isSpectator || !car.userName[0] )
+            continue;
+
+        session.activeCarIdx[session.numActiveCars++] = carIdx;
+        session.activeMask |= 1ULL << carIdx;
+        if( car.isPaceCar )
+            session.paceCarIdx = carIdx;
+    }
+
+    // SoF
+    double sof = 0;
+    int cnt = 0;
+    for( int i=0; i<session.numActiveCars; ++i )
+    {
+        const Car& car = session.cars[session.activeCarIdx[i]];
+
+        if( car.isPaceCar )
+            continue;
+
+        sof += car.irating;
+        cnt++;
+    }
+    session.sof = cnt ? int(sof / cnt) : 0;
+
+    buildClassTables( session );
+}
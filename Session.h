@@ -0,0 +1,161 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include "util.h"
+
+#define IR_MAX_CARS 64
+#define IR_MAX_SESSIONS 8
+
+enum class SessionType
+{
+    UNKNOWN = 0,
+    PRACTICE,
+    QUALIFY,
+    RACE
+};
+static const char* const SessionTypeStr[] = {"UNKNOWN","PRACTICE","QUALIFY","RACE"};
+
+// Plain data, so resetting and copying cars is cheap. The strings point into Session::strings
+// and are only valid until the next session string update.
+struct Car
+{
+    const char*     userName = "";
+    int             userId = 0;
+    int             carNumber = 0;
+    const char*     carNumberStr = "";
+    const char*     licenseStr = "";
+    char            licenseChar = 'R';
+    float           licenseSR = 0;
+    const char*     licenseColStr = "";
+    float4          licenseCol = float4(0,0,0,1);
+    int             irating = 0;
+    int             isSelf = 0;
+    int             isPaceCar = 0;
+    int             isSpectator = 0;
+    int             isBuddy = 0;
+    int             isFlagged = 0;
+    int             incidentCount = 0;
+    float           carClassEstLapTime = 0;
+    int             practicePosition = 0;
+    int             qualPosition = 0;
+    float           qualTime = 0;
+    int             racePosition = 0;
+    int             classId = 0;
+    const char*     classShortName = "";
+    float4          classCol = float4(1,1,1,1);
+    int             classIdx = -1;          // index into Session::classes, -1 for pace car/spectators
+    int             classPosition = 0;      // class position derived from the session results, for the live one see RaceState::classPosition
+};
+static_assert( std::is_trivially_copyable<Car>::value, "Car must stay plain data" );
+
+// Built once per session string update, so the overlays don't have to filter the whole field for
+// every class-related lookup.
+struct CarClass
+{
+    int             classId = 0;
+    const char*     shortName = "";
+    float4          col = float4(1,1,1,1);
+    float           estLapTime = 0;
+    int             sof = 0;
+    int             numCars = 0;
+    int             carIdx[IR_MAX_CARS] = {};   // members, ordered by their position in the session results (leader candidates first)
+};
+
+// One line of SessionInfo:Sessions:ResultsPositions
+struct ResultsEntry
+{
+    int             position = 0;
+    int             classPosition = 0;      // 1-based (the session string has it 0-based)
+    int             carIdx = -1;
+    int             lap = 0;
+    float           time = 0;
+    int             fastestLap = 0;
+    float           fastestTime = 0;
+    float           lastTime = 0;
+    int             lapsLed = 0;
+    int             lapsComplete = 0;
+    float           lapsDriven = 0;
+    int             incidents = 0;
+    int             reasonOutId = 0;
+    const char*     reasonOutStr = "";      // points into Session::strings
+};
+
+// Results of one entry in SessionInfo:Sessions, indexed both ways
+struct SessionResults
+{
+    SessionType     sessionType = SessionType::UNKNOWN;
+    int             isUnlimitedTime = 0;
+    int             isUnlimitedLaps = 0;
+    int             numPositions = 0;
+    ResultsEntry    byPosition[IR_MAX_CARS];    // byPosition[pos-1], carIdx is -1 for gaps
+    int             byCarIdx[IR_MAX_CARS];      // index into byPosition, or -1
+
+    const ResultsEntry* get( int carIdx ) const { return carIdx>=0 && carIdx<IR_MAX_CARS && byCarIdx[carIdx]>=0 ? &byPosition[byCarIdx[carIdx]] : nullptr; }
+};
+
+struct Session
+{
+    SessionType     sessionType = SessionType::UNKNOWN;
+    Car             cars[IR_MAX_CARS];
+    int             numCarSlots = IR_MAX_CARS;  // length of the sim's CarIdx* arrays (at most IR_MAX_CARS), set by the caller
+    int             activeCarIdx[IR_MAX_CARS];  // cars with a driver that isn't a spectator, including the pace car
+    int             numActiveCars = 0;
+    unsigned long long activeMask = 0;          // bit per car in activeCarIdx
+    int             paceCarIdx = -1;
+    int             driverCarIdx = -1;
+    int             sof = 0;
+    CarClass        classes[IR_MAX_CARS];   // ordered by estimated lap time, fastest class first
+    int             numClasses = 0;
+    SessionResults  results[IR_MAX_SESSIONS];   // by SessionNum
+    int             numSessions = 0;
+    int             subsessionId = 0;
+    int             isFixedSetup = 0;
+    float           trackLengthM = 0;       // WeekendInfo:TrackLength, 0 if unknown
+    const char*     trackName = "";         // WeekendInfo:TrackName, points into strings
+    const char*     driverCarPath = "";     // our car's CarPath, points into strings
+    int             isUnlimitedTime = 0;
+    int             isUnlimitedLaps = 0;
+    float           fuelMaxLtr = 0;
+    float           rpmIdle = 0;
+    float           rpmRedline = 0;
+    float           rpmSLFirst = 0;
+    float           rpmSLShift = 0;
+    float           rpmSLLast = 0;
+    float           rpmSLBlink = 0;
+    StringPool      strings;    // backing storage for the per-car strings
+};
+
+// Hash the parts of the session string that ir_parseSessionStr() looks at, together with the session
+// number. Updates that only touch other sections (cameras, radio, car setup) hash the same, so they can
+// be skipped. Reads at most 'maxLen' bytes.
+unsigned long long ir_hashSessionStr( const char* sessionYaml, int maxLen, int sessionNum );
+
+// Parse a session string into 'session'. 'sessionNum' is the currently active entry in
+// SessionInfo:Sessions, which determines the session type. Only cars below session.numCarSlots are read.
+// This doesn't look at any live telemetry, so it can be fed with recorded session strings.
+void ir_parseSessionStr( const char* sessionYaml, int sessionNum, Session& session );
@@ -0,0 +1,405 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include "SessionJournal.h"
+#include "util.h"
+
+static const char       Magic[8] = { 'I','R','O','N','S','J','0','1' };
+static const unsigned   FlagKeyframe = 1;
+enum { OpCopy = 1, OpInsert = 2 };
+
+template<typename T>
+static void put( std::string& buf, const T& v )
+{
+    buf.append( (const char*)&v, sizeof(v) );
+}
+
+template<typename T>
+static bool get( const std::string& buf, size_t& pos, size_t end, T& v )
+{
+    if( pos + sizeof(v) > end )
+        return false;
+    memcpy( &v, buf.data()+pos, sizeof(v) );
+    pos += sizeof(v);
+    return true;
+}
+
+struct Line
+{
+    size_t  start;
+    size_t  len;    // including the '\n', if any
+};
+
+static void splitLines( const std::string& s, std::vector<Line>& lines )
+{
+    lines.clear();
+    size_t start = 0;
+    while( start < s.size() )
+    {
+        const char* nl = (const char*)memchr( s.data()+start, '\n', s.size()-start );
+        const size_t end = nl ? size_t(nl - s.data()) + 1 : s.size();
+        lines.push_back( { start, end-start } );
+        start = end;
+    }
+}
+
+static bool sameLine( const std::string& a, const Line& la, const std::string& b, const Line& lb )
+{
+    return la.len == lb.len && !memcmp( a.data()+la.start, b.data()+lb.start, la.len );
+}
+
+// Encode 'cur' as copies of runs of lines from 'prev' and inserted lines.
+// Session string updates mostly change a few values in place, so we first try to continue where
+// the last copy left off (with or without skipping the lines that were just replaced), and only
+// then go looking for the line elsewhere.
+static unsigned diffLines( const std::string& prev, const std::string& cur, std::string& ops )
+{
+    std::vector<Line> prevLines, curLines;
+    splitLines( prev, prevLines );
+    splitLines( cur, curLines );
+
+    std::unordered_map<unsigned long long, std::vector<unsigned>> index;
+    for( unsigned j=0; j<(unsigned)prevLines.size(); ++j )
+    {
+        const Line& l = prevLines[j];
+        index[MurmurHash64A( prev.data()+l.start, (int)l.len, 0 )].push_back( j );
+    }
+
+    const unsigned numPrev = (unsigned)prevLines.size();
+    const unsigned numCur = (unsigned)curLines.size();
+
+    auto runLength = [&]( unsigned i, unsigned j ) {
+        unsigned n = 0;
+        while( i+n < numCur && j+n < numPrev && sameLine( cur, curLines[i+n], prev, prevLines[j+n] ) )
+            ++n;
+        return n;
+    };
+
+    unsigned numOps = 0;
+    unsigned copyEnd = 0;       // line after the last copied run in 'prev'
+    unsigned i = 0;
+    while( i < numCur )
+    {
+        // Find the best run starting at cur line i
+        unsigned bestJ = copyEnd;
+        unsigned bestLen = runLength( i, copyEnd );
+        if( !bestLen )
+        {
+            const Line& l = curLines[i];
+            auto it = index.find( MurmurHash64A( cur.data()+l.start, (int)l.len, 0 ) );
+            if( it != index.end() )
+            {
+                // Lines like "CarIsPaceCar: 0" repeat a lot, so only look at a few candidates
+                // near where we are.
+                const std::vector<unsigned>& cands = it->second;
+                auto lb = std::lower_bound( cands.begin(), cands.end(), copyEnd );
+                for( int k=0; k<8 && lb!=cands.end(); ++k, ++lb )
+                {
+                    const unsigned n = runLength( i, *lb );
+                    if( n > bestLen ) { bestJ = *lb; bestLen = n; }
+                }
+                if( !bestLen && !cands.empty() )
+                {
+                    bestJ = cands.front();
+                    bestLen = runLength( i, bestJ );
+                }
+            }
+        }
+
+        if( bestLen )
+        {
+            ops.push_back( (char)OpCopy );
+            put( ops, (unsigned)bestJ );
+            put( ops, (unsigned)bestLen );
+            i += bestLen;
+            copyEnd = bestJ + bestLen;
+        }
+        else
+        {
+            // Insert this line, plus following lines that don't match where we'd continue copying.
+            // Assume they replace the same number of lines in 'prev'.
+            const unsigned first = i;
+            do {
+                ++i;
+                ++copyEnd;
+            } while( i < numCur && !(copyEnd < numPrev && sameLine( cur, curLines[i], prev, prevLines[copyEnd] )) && !index.count( MurmurHash64A( cur.data()+curLines[i].start, (int)curLines[i].len, 0 ) ) );
+
+            const size_t start = curLines[first].start;
+            const size_t len = curLines[i-1].start + curLines[i-1].len - start;
+            ops.push_back( (char)OpInsert );
+            put( ops, (unsigned)len );
+            ops.append( cur.data()+start, len );
+        }
+        ++numOps;
+    }
+    return numOps;
+}
+
+SessionJournal::~SessionJournal()
+{
+    close();
+}
+
+bool SessionJournal::open( const std::string& filename, size_t maxBytes )
+{
+    close();
+
+    m_filename = filename;
+    m_maxBytes = maxBytes;
+    m_quit = false;
+    m_prev.clear();
+    m_thread = std::thread( &SessionJournal::writerThread, this );
+    return true;
+}
+
+void SessionJournal::close()
+{
+    if( !m_thread.joinable() )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk( m_mutex );
+        m_quit = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+
+    if( m_fp )
+        fclose( m_fp );
+    m_fp = nullptr;
+}
+
+void SessionJournal::add( const char* sessionYaml, double timestamp, int sessionTick, int sessionNum )
+{
+    if( !isOpen() || !sessionYaml )
+        return;
+
+    Pending p;
+    p.yaml = sessionYaml;
+    p.timestamp = timestamp;
+    p.sessionTick = sessionTick;
+    p.sessionNum = sessionNum;
+
+    {
+        std::lock_guard<std::mutex> lk( m_mutex );
+        if( m_pending.size() >= MaxPending ) {
+            m_pending.pop_front();
+            m_numDropped++;
+        }
+        m_pending.push_back( std::move(p) );
+    }
+    m_cv.notify_one();
+}
+
+void SessionJournal::writerThread()
+{
+    while( true )
+    {
+        Pending p;
+        {
+            std::unique_lock<std::mutex> lk( m_mutex );
+            m_cv.wait( lk, [this]() { return m_quit || !m_pending.empty(); } );
+            if( m_pending.empty() )
+                break;  // quitting, and everything's written
+            p = std::move( m_pending.front() );
+            m_pending.pop_front();
+        }
+
+        if( write( p ) )
+            m_numWritten++;
+    }
+}
+
+bool SessionJournal::startFile()
+{
+    if( m_fp )
+        fclose( m_fp );
+
+    // Keep the previous file around (a previous run, or the first part of a long session)
+    const std::string old = m_filename + ".1";
+    remove( old.c_str() );
+    rename( m_filename.c_str(), old.c_str() );
+
+    m_fp = fopen( m_filename.c_str(), "wb" );
+    if( !m_fp ) {
+        printf( "Could not open session journal %s\n", m_filename.c_str() );
+        return false;
+    }
+
+    fwrite( Magic, sizeof(Magic), 1, m_fp );
+    m_fileBytes = sizeof(Magic);
+    m_prev.clear();
+    m_sinceKeyframe = KeyframeInterval;
+    return true;
+}
+
+bool SessionJournal::write( const Pending& p )
+{
+    if( !m_fp || m_fileBytes >= m_maxBytes )
+    {
+        if( !startFile() )
+            return false;
+    }
+
+    std::string ops;
+    unsigned numOps = 0;
+    unsigned flags = 0;
+    if( m_sinceKeyframe >= KeyframeInterval )
+    {
+        flags |= FlagKeyframe;
+        ops.push_back( (char)OpInsert );
+        put( ops, (unsigned)p.yaml.size() );
+        ops += p.yaml;
+        numOps = 1;
+        m_sinceKeyframe = 0;
+    }
+    else
+    {
+        numOps = diffLines( m_prev, p.yaml, ops );
+        m_sinceKeyframe++;
+    }
+
+    std::string rec;
+    put( rec, (unsigned)0 );    // payload size, filled in below
+    put( rec, p.timestamp );
+    put( rec, p.sessionTick );
+    put( rec, p.sessionNum );
+    put( rec, flags );
+    put( rec, numOps );
+    rec += ops;
+    const unsigned payloadBytes = unsigned(rec.size() - sizeof(unsigned));
+    memcpy( &rec[0], &payloadBytes, sizeof(payloadBytes) );
+
+    fwrite( rec.data(), rec.size(), 1, m_fp );
+    fflush( m_fp );
+    m_fileBytes += rec.size();
+
+    m_prev = p.yaml;
+    return true;
+}
+
+bool SessionJournalReader::isJournal( const std::string& filename )
+{
+    char magic[sizeof(Magic)] = {};
+    FILE* fp = fopen( filename.c_str(), "rb" );
+    if( !fp )
+        return false;
+    const bool ok = fread( magic, sizeof(magic), 1, fp ) == 1 && !memcmp( magic, Magic, sizeof(Magic) );
+    fclose( fp );
+    return ok;
+}
+
+bool SessionJournalReader::open( const std::string& filename )
+{
+    m_entries.clear();
+    m_records.clear();
+
+    if( !loadFile( filename, m_data ) || m_data.size() < sizeof(Magic) || memcmp( m_data.data(), Magic, sizeof(Magic) ) )
+        return false;
+
+    // Index the records. A truncated last record (iRon killed mid-write) is ignored.
+    size_t pos = sizeof(Magic);
+    while( pos < m_data.size() )
+    {
+        unsigned payloadBytes = 0, flags = 0, numOps = 0;
+        Entry e;
+        if( !get( m_data, pos, m_data.size(), payloadBytes ) || pos + payloadBytes > m_data.size() )
+            break;
+
+        const size_t end = pos + payloadBytes;
+        if( !get( m_data, pos, end, e.timestamp ) || !get( m_data, pos, end, e.sessionTick ) || !get( m_data, pos, end, e.sessionNum ) ||
+            !get( m_data, pos, end, flags ) || !get( m_data, pos, end, numOps ) )
+            break;
+
+        // Can't reconstruct anything before the first keyframe
+        if( m_records.empty() && !(flags & FlagKeyframe) )
+            return false;
+
+        Record rec;
+        rec.offset = pos;
+        rec.bytes = end - pos;
+        rec.isKeyframe = (flags & FlagKeyframe) != 0;
+        m_records.push_back( rec );
+        m_entries.push_back( e );
+        pos = end;
+    }
+
+    return !m_records.empty();
+}
+
+bool SessionJournalReader::apply( const Record& rec, const std::string& prev, std::string& out ) const
+{
+    std::vector<Line> prevLines;
+    splitLines( prev, prevLines );
+
+    out.clear();
+    size_t pos = rec.offset;
+    const size_t end = rec.offset + rec.bytes;
+    while( pos < end )
+    {
+        const char op = m_data[pos++];
+        unsigned a = 0, b = 0;
+        if( op == OpCopy )
+        {
+            if( !get( m_data, pos, end, a ) || !get( m_data, pos, end, b ) || size_t(a)+b > prevLines.size() )
+                return false;
+            if( b ) {
+                const size_t start = prevLines[a].start;
+                out.append( prev, start, prevLines[a+b-1].start + prevLines[a+b-1].len - start );
+            }
+        }
+        else if( op == OpInsert )
+        {
+            if( !get( m_data, pos, end, a ) || pos + a > end )
+                return false;
+            out.append( m_data, pos, a );
+            pos += a;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+bool SessionJournalReader::getVersion( int idx, std::string& out ) const
+{
+    if( idx < 0 || idx >= (int)m_records.size() )
+        return false;
+
+    int first = idx;
+    while( !m_records[first].isKeyframe )
+        --first;
+
+    std::string prev;
+    for( int i=first; i<=idx; ++i )
+    {
+        if( !apply( m_records[i], prev, out ) )
+            return false;
+        prev = out;
+    }
+    return true;
+}
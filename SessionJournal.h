@@ -0,0 +1,134 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+// Journal of session string versions, for replaying real sessions into the parser benchmarks.
+//
+// Strings are handed to a background thread, which stores each one as a line diff against the
+// previous version (copy runs of old lines + inserted new lines), so the usual small updates only
+// take a few bytes. Every 'KeyframeInterval' versions and at the start of each file a version is
+// stored in full. When the file reaches its size limit it is moved to "<file>.1" and a new one started.
+//
+// File layout (little-endian):
+//   "IRONSJ01"
+//   records: u32 payloadBytes, f64 timestamp, i32 sessionTick, i32 sessionNum, u32 flags, u32 numOps, ops...
+//   ops:     u8 OpCopy,   u32 firstLine, u32 numLines   (lines of the previous version)
+//            u8 OpInsert, u32 numBytes, bytes           (one or more complete lines)
+
+class SessionJournal
+{
+    public:
+
+        enum { KeyframeInterval = 100, MaxPending = 16 };
+
+        ~SessionJournal();
+
+        bool    open( const std::string& filename, size_t maxBytes );
+        void    close();
+        bool    isOpen() const { return m_thread.joinable(); }
+
+        // Called from the render thread. Only copies the string, the rest happens in the background.
+        // Drops the oldest pending version if the writer falls behind.
+        void    add( const char* sessionYaml, double timestamp, int sessionTick, int sessionNum );
+
+        int     numWritten() const { return m_numWritten; }
+        int     numDropped() const { return m_numDropped; }
+
+    private:
+
+        struct Pending
+        {
+            std::string yaml;
+            double      timestamp = 0;
+            int         sessionTick = 0;
+            int         sessionNum = 0;
+        };
+
+        void    writerThread();
+        bool    write( const Pending& p );
+        bool    startFile();
+
+        std::string                 m_filename;
+        size_t                      m_maxBytes = 0;
+        FILE*                       m_fp = nullptr;
+        size_t                      m_fileBytes = 0;
+
+        std::thread                 m_thread;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_cv;
+        std::deque<Pending>         m_pending;
+        bool                        m_quit = false;
+
+        std::string                 m_prev;             // previous version, the diff base
+        int                         m_sinceKeyframe = 0;
+        std::atomic<int>            m_numWritten = {0};
+        std::atomic<int>            m_numDropped = {0};
+};
+
+class SessionJournalReader
+{
+    public:
+
+        struct Entry
+        {
+            double      timestamp = 0;
+            int         sessionTick = 0;
+            int         sessionNum = 0;
+        };
+
+        bool                open( const std::string& filename );
+
+        int                 numVersions() const { return (int)m_entries.size(); }
+        const Entry&        entry( int idx ) const { return m_entries[idx]; }
+
+        // Reconstruct version 'idx', starting from the closest keyframe before it.
+        bool                getVersion( int idx, std::string& out ) const;
+
+        static bool         isJournal( const std::string& filename );
+
+    private:
+
+        struct Record
+        {
+            size_t      offset = 0;     // of the ops in m_data
+            size_t      bytes = 0;
+            bool        isKeyframe = false;
+        };
+
+        bool                apply( const Record& rec, const std::string& prev, std::string& out ) const;
+
+        std::string             m_data;
+        std::vector<Entry>      m_entries;
+        std::vector<Record>     m_records;
+};
@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <math.h>
+#include "TireModel.h"
+
+// Tread going up by more than this means a new set
+static const float NewTiresWearStep = 0.02f;
+
+float TireModel::Fit::slope() const
+{
+    const double den = n*sxx - sx*sx;
+    return n >= 2 && den > 0 ? float( (n*sxy - sx*sy) / den ) : 0;
+}
+
+void TireModel::reset()
+{
+    for( CornerState& c : m_corners )
+    {
+        c.wear.reset();
+        c.temp.reset();
+        c.lastWear = -1;
+        c.lastTemp = -1;
+        c.lastWearLap = 0;
+        c.stintStartLap = 0;
+        c.prevStintRate = 0;
+    }
+}
+
+void TireModel::addSample( const TireSample& s )
+{
+    for( int i=0; i<NumCorners; ++i )
+    {
+        CornerState& c = m_corners[i];
+        const float wear = s.wear[i];
+        const float temp = s.carcassTemp[i];
+
+        if( c.lastWear < 0 || wear > c.lastWear + NewTiresWearStep )
+        {
+            // New set (or the first reading)
+            if( c.lastWear >= 0 ) {
+                const float rate = -c.wear.slope();
+                if( rate > 0 )
+                    c.prevStintRate = rate;
+            }
+            c.wear.reset();
+            c.temp.reset();
+            c.wear.add( s.lap, wear );
+            c.temp.add( s.lap, temp );
+            c.lastWear = wear;
+            c.lastTemp = temp;
+            c.lastWearLap = s.lap;
+            c.stintStartLap = s.lap;
+            continue;
+        }
+
+        if( wear != c.lastWear )
+        {
+            c.wear.add( s.lap, wear );
+            c.lastWear = wear;
+            c.lastWearLap = s.lap;
+        }
+        if( temp != c.lastTemp )
+        {
+            c.temp.add( s.lap, temp );
+            c.lastTemp = temp;
+        }
+    }
+}
+
+float TireModel::wearPerLap( int corner ) const
+{
+    const CornerState& c = m_corners[corner];
+    const float rate = -c.wear.slope();
+    return rate > 0 ? rate : c.prevStintRate;
+}
+
+float TireModel::wearAt( int corner, int lap ) const
+{
+    const CornerState& c = m_corners[corner];
+    if( c.lastWear < 0 )
+        return -1;
+    return c.lastWear - wearPerLap( corner ) * (lap - c.lastWearLap);
+}
+
+int TireModel::thresholdLap( int corner, float threshold ) const
+{
+    const CornerState& c = m_corners[corner];
+    const float rate = wearPerLap( corner );
+    if( c.lastWear < 0 || rate <= 0 )
+        return -1;
+    if( c.lastWear <= threshold )
+        return c.lastWearLap;
+    return c.lastWearLap + (int)ceilf( (c.lastWear - threshold) / rate );
+}
@@ -0,0 +1,91 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Tire wear and carcass temperature trends for our own car, per corner and tire stint, to tell
+// on which lap a corner wears down to a given level. iRacing only updates these readings while the
+// car is in the pit stall, so samples are taken once per lap, on arriving in the stall (the worn set,
+// before service) and on leaving it, and only readings that actually changed count. Fresh tires have
+// nothing to go on yet, so the rate from the previous stint on that corner is used until there is.
+// Fed with plain numbers and kept off the per-frame path.
+
+struct TireSample
+{
+    int     lap = 0;
+    float   wear[4] = {};           // LF, RF, LR, RR; least tread remaining across the tire, 0..1
+    float   carcassTemp[4] = {};    // average across the tire, C
+};
+
+class TireModel
+{
+    public:
+
+        enum Corner { LF, RF, LR, RR, NumCorners };
+
+        TireModel() { reset(); }
+
+        void reset();
+
+        // Call on lap completion, and on arriving in and leaving the pit stall.
+        void addSample( const TireSample& s );
+
+        // Tread lost per lap (positive), 0 if there's nothing to go on
+        float wearPerLap( int corner ) const;
+        float tempPerLap( int corner ) const { return m_corners[corner].temp.slope(); }
+
+        // Projected tread remaining on a given lap
+        float wearAt( int corner, int lap ) const;
+
+        // First lap on which the corner is at or below 'threshold', -1 if unknown
+        int   thresholdLap( int corner, float threshold ) const;
+
+        int   stintStartLap( int corner ) const { return m_corners[corner].stintStartLap; }
+
+    private:
+
+        // Least squares line through (lap, value), with running sums
+        struct Fit
+        {
+            int     n;
+            double  sx, sy, sxx, sxy;
+
+            void  reset() { n = 0; sx = sy = sxx = sxy = 0; }
+            void  add( double x, double y ) { n++; sx += x; sy += y; sxx += x*x; sxy += x*y; }
+            float slope() const;
+        };
+
+        struct CornerState
+        {
+            Fit     wear;
+            Fit     temp;
+            float   lastWear;       // latest reading, -1 before the first
+            float   lastTemp;
+            int     lastWearLap;
+            int     stintStartLap;
+            float   prevStintRate;  // wear per lap over the previous stint, 0 if unknown
+        };
+
+        CornerState m_corners[NumCorners];
+};
@@ -0,0 +1,270 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Fuel model test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Replays a stint through FuelModel tick by tick, the way ir_tick() feeds it. The built-in stint is
+// synthetic: a clean run to check the pit plan arithmetic, and a race with lap-to-lap noise, a spin,
+// a caution and a pit stop to check which laps count. Recorded stints can be replayed as well, from
+// CSV files with a header line naming the telemetry variables (SessionTime, Lap, LapDistPct,
+// FuelLevel, OnPitRoad, SessionFlags, SessionLapsRemainEx, optionally FuelMaxLtr), one row per tick.
+//
+// Usage: fuel_test [recording.csv ...]
+//
+
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../FuelModel.h"
+#include "test.h"
+
+// The SessionFlags bits that make a lap not count, as in ir_tick()
+// (checkered, yellow, red, crossed, yellowWaving, oneLapToGreen, caution, cautionWaving, disqualify, repair)
+static const int NotGreenFlags = 0x0012C399;
+
+struct Tick
+{
+    int     lap = 0;
+    float   lapDistPct = -1;
+    float   fuelLevel = -1;
+    float   fuelCapacity = 0;
+    int     remainingLaps = -1;
+    int     flags = 0;
+    bool    onPitRoad = false;
+};
+
+static FuelModelInput toInput( const Tick& t )
+{
+    FuelModelInput in;
+    in.lap           = t.lap;
+    in.lapDistPct    = t.lapDistPct;
+    in.fuelLevel     = t.fuelLevel;
+    in.fuelCapacity  = t.fuelCapacity;
+    in.remainingLaps = t.remainingLaps;
+    in.isGreen       = !(t.flags & NotGreenFlags);
+    in.onPitRoad     = t.onPitRoad;
+    return in;
+}
+
+// Feeds ticks until (not including) the first one on untilLap
+static size_t replay( const std::vector<Tick>& ticks, size_t from, int untilLap, FuelModel& model, const FuelModelConfig& cfg )
+{
+    size_t i = from;
+    for( ; i<ticks.size() && ticks[i].lap != untilLap; ++i )
+        model.update( toInput(ticks[i]), cfg );
+    return i;
+}
+
+// A race of numLaps laps from a standing start on a full tank, ten ticks per lap.
+// usage[lap] is what that lap burns, yellow laps are under caution, and we pit at the end of pitLap.
+static std::vector<Tick> race( int numLaps, float capacity, const std::vector<float>& usage, int yellowFrom, int yellowTo, int pitLap )
+{
+    std::vector<Tick> ticks;
+    float fuel = capacity;
+    for( int lap=1; lap<=numLaps; ++lap )
+    {
+        for( int k=0; k<10; ++k )
+        {
+            const float pct = k * 0.1f;
+
+            // Refuel in the stall right after the line
+            const bool inPits = (lap == pitLap && k >= 9) || (lap == pitLap+1 && k <= 1);
+            if( lap == pitLap+1 && k == 1 )
+                fuel = capacity;
+
+            Tick t;
+            t.lap           = lap;
+            t.lapDistPct    = pct;
+            t.fuelLevel     = fuel;
+            t.fuelCapacity  = capacity;
+            t.remainingLaps = numLaps - lap + 1;
+            t.flags         = lap >= yellowFrom && lap <= yellowTo ? 0x4000 : 0;
+            t.onPitRoad     = inPits;
+            ticks.push_back( t );
+
+            fuel -= usage[lap] / 10;
+        }
+    }
+    return ticks;
+}
+
+static bool readCsv( const char* path, std::vector<Tick>& ticks )
+{
+    FILE* fp = fopen( path, "r" );
+    if( !fp )
+        return false;
+
+    static const char* names[] = { "Lap", "LapDistPct", "FuelLevel", "FuelMaxLtr", "SessionLapsRemainEx", "SessionFlags", "OnPitRoad" };
+    int col[7] = { -1, -1, -1, -1, -1, -1, -1 };
+
+    char line[4096];
+    bool header = true;
+    while( fgets( line, sizeof(line), fp ) )
+    {
+        std::vector<std::string> fields;
+        for( char* tok = strtok( line, ",\r\n" ); tok; tok = strtok( nullptr, ",\r\n" ) )
+            fields.push_back( tok );
+
+        if( header )
+        {
+            for( int i=0; i<(int)fields.size(); ++i )
+                for( int c=0; c<7; ++c )
+                    if( fields[i] == names[c] )
+                        col[c] = i;
+            header = false;
+            continue;
+        }
+
+        auto get = [&]( int c, double def ) { return col[c] >= 0 && col[c] < (int)fields.size() ? atof( fields[col[c]].c_str() ) : def; };
+        Tick t;
+        t.lap           = std::max( 0, (int)get( 0, 0 ) );
+        t.lapDistPct    = (float)get( 1, -1 );
+        t.fuelLevel     = (float)get( 2, -1 );
+        t.fuelCapacity  = (float)get( 3, 0 );
+        t.remainingLaps = (int)get( 4, -1 );
+        t.flags         = (int)get( 5, 0 );
+        t.onPitRoad     = get( 6, 0 ) != 0;
+        if( t.remainingLaps == 32767 )
+            t.remainingLaps = -1;
+        ticks.push_back( t );
+    }
+    fclose( fp );
+    return !header;
+}
+
+int main( int argc, char** argv )
+{
+    FuelModelConfig cfg;
+
+    // Clean run at 2.5 per lap in a 30 lap race on a 50 tank
+    {
+        const std::vector<float> usage( 31, 2.5f );
+        const std::vector<Tick> ticks = race( 30, 50, usage, 0, -1, -1 );
+
+        FuelModel m;
+        size_t i = replay( ticks, 0, 6, m, cfg );
+        m.update( toInput(ticks[i]), cfg );
+
+        // Five laps done, 37.5 left, 25 to go counting this one
+        const FuelEstimate& e = m.estimate();
+        CHECK( m.numLaps() == 4 );
+        CHECK_NEAR( e.perLap, 2.5, 1e-4 );
+        CHECK_NEAR( e.perLapConservative, 2.75, 1e-4 );
+        CHECK_NEAR( e.lapsRemaining, 37.5/2.75, 1e-3 );
+        CHECK_NEAR( e.toFinish, 25*2.75-37.5, 1e-3 );
+        CHECK( e.minStops == 1 );
+        CHECK( e.latestPitLap == 18 );      // 13.6 laps of fuel from the start of lap 6
+        CHECK( e.earliestPitLap == 12 );    // a full tank covers 18 laps, so the last 19 start after lap 12
+        CHECK_NEAR( e.saveTarget, 37.5/25/1.1, 1e-4 );
+
+        // Part way round, the lap is projected from what it used so far
+        FuelModel m2;
+        size_t j = replay( ticks, 0, 6, m2, cfg );
+        for( int k=0; k<5; ++k )
+            m2.update( toInput(ticks[j+k]), cfg );
+        CHECK_NEAR( m2.estimate().lapUsed, 1.0, 1e-3 );
+        CHECK_NEAR( m2.estimate().lapProjected, 2.5, 1e-3 );
+
+        // Enough fuel on the last stint: no plan
+        FuelModel m3;
+        size_t l = replay( ticks, 0, 30, m3, cfg );
+        std::vector<Tick> tail( ticks.begin()+l, ticks.end() );
+        for( Tick& t : tail )
+            t.fuelLevel += 50;
+        m3.update( toInput(tail[0]), cfg );
+        CHECK( m3.estimate().toFinish == 0 );
+        CHECK( m3.estimate().minStops == 0 );
+        CHECK( m3.estimate().earliestPitLap == -1 );
+    }
+
+    // A race stint: noise, a spin on lap 4, a caution on laps 9 and 10, and a stop at the end of lap 15
+    {
+        std::vector<float> usage( 31 );
+        for( int lap=1; lap<=30; ++lap )
+            usage[lap] = 2.5f + 0.02f * ((lap*7) % 5 - 2);
+        usage[4] = 4.0f;
+        usage[9] = usage[10] = 1.5f;
+        const std::vector<Tick> ticks = race( 30, 50, usage, 9, 10, 15 );
+
+        FuelModel m;
+
+        // The spin lap is in the last four, but hardly moves the estimate. A plain average would be 2.87.
+        size_t i = replay( ticks, 0, 6, m, cfg );
+        m.update( toInput(ticks[i]), cfg );
+        CHECK( m.numLaps() == 4 );
+        CHECK( m.estimate().perLap > 2.45f && m.estimate().perLap < 2.6f );
+
+        // The caution laps don't count
+        i = replay( ticks, i, 12, m, cfg );
+        m.update( toInput(ticks[i]), cfg );
+        for( int k=0; k<m.numLaps(); ++k )
+            CHECK( m.lapUsage(k) > 2.4f && m.lapUsage(k) < 2.6f );
+        CHECK_NEAR( m.lapUsage(m.numLaps()-1), usage[11], 1e-3 );
+
+        // Neither do the in and out laps, or the refill: 14 is still the latest one
+        i = replay( ticks, i, 17, m, cfg );
+        m.update( toInput(ticks[i]), cfg );
+        CHECK_NEAR( m.lapUsage(m.numLaps()-1), usage[14], 1e-3 );
+        for( int k=0; k<m.numLaps(); ++k )
+            CHECK( m.lapUsage(k) > 2.4f && m.lapUsage(k) < 2.6f );
+
+        // And a full tank at the start of lap 17 makes it to the end of 30 with margin
+        CHECK( m.estimate().minStops == 0 );
+        CHECK( m.estimate().toFinish == 0 );
+
+        // Replaying the same stint gives the same answers
+        FuelModel a, b;
+        replay( ticks, 0, -1, a, cfg );
+        replay( ticks, 0, -1, b, cfg );
+        CHECK( a.numLaps() == b.numLaps() );
+        CHECK( memcmp( &a.estimate(), &b.estimate(), sizeof(FuelEstimate) ) == 0 );
+    }
+
+    // Recordings given on the command line: nothing to compare against, but the plan has to stay sane all the way
+    for( int f=1; f<argc; ++f )
+    {
+        std::vector<Tick> ticks;
+        CHECK( readCsv( argv[f], ticks ) );
+
+        FuelModel m;
+        int numBad = 0;
+        for( const Tick& t : ticks )
+        {
+            m.update( toInput(t), cfg );
+            const FuelEstimate& e = m.estimate();
+            const bool ok = e.perLap >= 0 && e.perLap == e.perLap && e.toFinish >= 0 && e.minStops >= 0 &&
+                            e.earliestPitLap <= e.latestPitLap && (e.minStops == 0) == (e.latestPitLap < 0);
+            numBad += ok ? 0 : 1;
+        }
+        CHECK( numBad == 0 );
+
+        const FuelEstimate& e = m.estimate();
+        printf( "%s: %d ticks, %.2f per lap over %d laps, %d stops left\n", argv[f], (int)ticks.size(), e.perLap, m.numLaps(), e.minStops );
+    }
+
+    return testResult( "fuel_test" );
+}
@@ -0,0 +1,187 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Hazard detector test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Four cars lapping a 4km track with one slow corner, so the speed profile gets learned, then
+// a spin, an off into a rejoin, a car stopping, a hazard just past the line, a car leaving the
+// session and a replay jump back in time.
+//
+// Usage: hazard_test
+//
+
+#include "../HazardDetector.h"
+#include "test.h"
+
+static const float  TrackLength = 4000;
+static const int    NumCars = 4;
+static const double Dt = 1/60.0;
+
+static Session        s_session;
+static HazardDetector s_hazards;
+static double         s_time = 0;
+static float          s_pct[IR_MAX_CARS];
+static float          s_speed[IR_MAX_CARS];
+static bool           s_offTrack[IR_MAX_CARS];
+static bool           s_onPitRoad[IR_MAX_CARS];
+static bool           s_inWorld[IR_MAX_CARS];
+
+// 70 m/s everywhere, except for a corner taken at 18 m/s between 0.5 and 0.55, braking and
+// accelerating over 200m either side. Taken at full speed, 18 m/s would look like a spin.
+static float profileSpeed( float pct )
+{
+    if( pct < 0.45f || pct >= 0.6f )
+        return 70;
+    if( pct < 0.5f )
+        return 70 - (pct-0.45f) / 0.05f * 52;
+    if( pct < 0.55f )
+        return 18;
+    return 18 + (pct-0.55f) / 0.05f * 52;
+}
+
+static void setActive( int numCars )
+{
+    s_session.numActiveCars = numCars;
+    s_session.activeMask = 0;
+    for( int i=0; i<numCars; ++i ) {
+        s_session.activeCarIdx[i] = i;
+        s_session.activeMask |= 1ULL << i;
+    }
+}
+
+static void tick()
+{
+    s_time += Dt;
+    s_hazards.update( s_time, s_session, s_pct, s_speed, s_offTrack, s_onPitRoad, s_inWorld, s_session.activeMask );
+}
+
+// Cars in 'mask' follow the speed profile for 'seconds', the others stay as they are
+static void drive( double seconds, unsigned long long mask = ~0ULL )
+{
+    for( const double end = s_time + seconds; s_time < end; )
+    {
+        for( int i=0; i<NumCars; ++i )
+        {
+            if( !((mask >> i) & 1) )
+                continue;
+            s_speed[i] = profileSpeed( s_pct[i] );
+            s_pct[i] += float( s_speed[i] * Dt / TrackLength );
+            if( s_pct[i] >= 1 )
+                s_pct[i] -= 1;
+        }
+        tick();
+    }
+}
+
+int main()
+{
+    for( int i=0; i<IR_MAX_CARS; ++i ) {
+        s_pct[i] = i < NumCars ? i * 0.25f : -1;
+        s_inWorld[i] = i < NumCars;
+    }
+    setActive( NumCars );
+    s_hazards.setTrackLength( TrackLength );
+
+    // A few laps to learn the profile. Braking for the corner is normal.
+    drive( 200 );
+    CHECK( s_hazards.numEvents() == 0 );
+
+    // Sudden loss of speed on the straight is a spin right away, and back up to speed a rejoin
+    s_pct[1] = 0.2f;
+    s_speed[1] = 15;
+    tick();
+    CHECK( s_hazards.numEvents() == 1 );
+    CHECK( s_hazards.event(0).carIdx == 1 );
+    CHECK( s_hazards.event(0).type == HazardType::SPIN );
+    CHECK( s_hazards.isHazard( 1 ) );
+    drive( 0.5 );
+    CHECK( s_hazards.isHazard( 1 ) );
+    drive( 1.0 );
+    CHECK( !s_hazards.isHazard( 1 ) );
+    CHECK( s_hazards.numEvents() == 2 );
+    CHECK( s_hazards.event(0).type == HazardType::REJOIN );
+
+    // Off track stays a hazard for as long as it lasts, and a moment after coming back
+    s_offTrack[2] = true;
+    drive( 2.0 );
+    CHECK( s_hazards.numEvents() == 3 );
+    CHECK( s_hazards.event(0).carIdx == 2 );
+    CHECK( s_hazards.event(0).type == HazardType::OFF_TRACK );
+    CHECK( s_hazards.isHazard( 2 ) );
+    CHECK( s_hazards.hazardType( 2 ) == HazardType::OFF_TRACK );
+    s_offTrack[2] = false;
+    drive( 0.5 );
+    CHECK( s_hazards.isHazard( 2 ) );
+    drive( 1.0 );
+    CHECK( !s_hazards.isHazard( 2 ) );
+    CHECK( s_hazards.numEvents() == 4 );
+    CHECK( s_hazards.event(0).type == HazardType::REJOIN );
+
+    // Crawling through the slow corner isn't a spin, but not moving for StoppedDelay is a stop
+    s_pct[3] = 0.52f;
+    s_speed[3] = 2;
+    drive( 0.9, 0x7 );
+    CHECK( !s_hazards.isHazard( 3 ) );
+    CHECK( s_hazards.numEvents() == 4 );
+    drive( 0.2, 0x7 );
+    CHECK( s_hazards.isHazard( 3 ) );
+    CHECK( s_hazards.hazardType( 3 ) == HazardType::STOPPED );
+    CHECK( s_hazards.numEvents() == 5 );
+    CHECK( s_hazards.event(0).carIdx == 3 );
+    CHECK( s_hazards.event(0).type == HazardType::STOPPED );
+
+    // Just past the line is just ahead of a car about to cross it
+    s_pct[3] = 0.01f;
+    s_pct[0] = 0.98f;
+    tick();
+    float distance = 0;
+    CHECK( s_hazards.hazardAhead( 0, 200, &distance ) == 3 );
+    CHECK_NEAR( distance, 120, 1 );
+    CHECK( s_hazards.hazardAhead( 0, 100 ) == -1 );
+    CHECK( s_hazards.hazardAhead( 3, 4000 ) == -1 );
+
+    // A car that left the session isn't a hazard anymore
+    setActive( 3 );
+    tick();
+    CHECK( !s_hazards.isHazard( 3 ) );
+    CHECK( s_hazards.hazardAhead( 0, 200 ) == -1 );
+
+    // Time going backwards forgets everything but the track length. Car 0 is kept from driving past
+    // car 3 afterwards, which would teach the empty profile that it should be going fast there.
+    setActive( NumCars );
+    s_pct[0] = 0.3f;
+    drive( 1.2, 0x7 );
+    CHECK( s_hazards.isHazard( 3 ) );
+    s_time -= 100;
+    tick();
+    CHECK( s_hazards.numEvents() == 0 );
+    CHECK( !s_hazards.isHazard( 3 ) );
+    drive( 1.2, 0x7 );
+    CHECK( s_hazards.isHazard( 3 ) );
+    CHECK( s_hazards.numEvents() == 1 );
+    CHECK( s_hazards.event(0).type == HazardType::STOPPED );
+
+    return testResult( "hazard_test" );
+}
@@ -0,0 +1,125 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// IRatingProjection test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Hand-made classes with known pairwise outcomes: equal ratings, a strong and a weak driver
+// finishing either way round, and a class where only one car moves between updates.
+//
+// Usage: irating_test
+//
+
+#include <algorithm>
+#include "../IRatingProjection.h"
+#include "test.h"
+
+static Session g_session;
+
+static void setClass( const int* irating, int numCars )
+{
+    Session& s = g_session;
+    s.numClasses = 1;
+    s.numActiveCars = numCars;
+    s.classes[0].numCars = numCars;
+    for( int i=0; i<numCars; ++i )
+    {
+        s.cars[i].irating = irating[i];
+        s.cars[i].classIdx = 0;
+        s.classes[0].carIdx[i] = i;
+        s.activeCarIdx[i] = i;
+    }
+}
+
+int main()
+{
+    IRatingProjection proj;
+    int pos[IR_MAX_CARS] = {};
+    int version = 0;
+
+    // Two equal drivers: even odds, so it's all the position (and the small fudge for finishing
+    // in the bottom half)
+    {
+        const int ir[] = { 1500, 1500 };
+        setClass( ir, 2 );
+        pos[0] = 1; pos[1] = 2;
+        proj.update( g_session, ++version, pos );
+        CHECK_NEAR( proj.change(0),  50.0, 0.01 );
+        CHECK_NEAR( proj.change(1), -49.0, 0.01 );
+    }
+
+    // 3000 vs 1000: the favourite is expected to win 83% of the time, so winning is worth little
+    // and losing costs a lot. The underdog winning is the big gain.
+    {
+        const int ir[] = { 3000, 1000 };
+        setClass( ir, 2 );
+        pos[0] = 1; pos[1] = 2;
+        proj.update( g_session, ++version, pos );
+        CHECK_NEAR( proj.change(0),  16.9, 0.1 );
+        CHECK_NEAR( proj.change(1), -15.9, 0.1 );
+
+        pos[0] = 2; pos[1] = 1;
+        proj.update( g_session, version, pos );
+        CHECK_NEAR( proj.change(0), -82.1, 0.1 );
+        CHECK_NEAR( proj.change(1),  83.1, 0.1 );
+    }
+
+    // Mixed field finishing in rating order: gains shrink, losses grow down the order, and everyone
+    // finishing where their rating puts them stays close to zero
+    {
+        const int ir[] = { 4000, 3000, 2500, 2000, 1500, 1000 };
+        setClass( ir, 6 );
+        for( int i=0; i<6; ++i )
+            pos[i] = i+1;
+        proj.update( g_session, ++version, pos );
+        for( int i=0; i<6; ++i ) {
+            CHECK( fabs(proj.change(i)) < 40 );
+            if( i )
+                CHECK( proj.change(i) < proj.change(i-1) );
+        }
+        CHECK( proj.change(0) > 0 );
+        CHECK( proj.change(5) < 0 );
+
+        // Reversed order: the 1000 winning gains far more than the 4000 winning did
+        const float favouriteWin = proj.change(0);
+        for( int i=0; i<6; ++i )
+            pos[i] = 6-i;
+        proj.update( g_session, version, pos );
+        CHECK( proj.change(5) > 3*favouriteWin );
+        CHECK( proj.change(0) < -100 );
+    }
+
+    // Between session updates only the cars that moved are recomputed
+    {
+        const int rebuilds = proj.expectedRebuilds();
+        const int updates  = proj.changeUpdates();
+        std::swap( pos[2], pos[3] );
+        proj.update( g_session, version, pos );
+        proj.update( g_session, version, pos );
+        CHECK( proj.expectedRebuilds() == rebuilds );
+        CHECK( proj.changeUpdates() == updates + 2 );
+    }
+
+    return testResult( "irating_test" );
+}
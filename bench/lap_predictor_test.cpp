@@ -0,0 +1,192 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Lap predictor test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Synthetic telemetry rows for a few cars, with their speeds as RaceState would have them: steady
+// laps across the line, a tow that makes a car snap, a car going backwards, one leaving the world,
+// and a paused sim. Predictions are compared against where the cars actually are at render time.
+//
+// Usage: lap_predictor_test
+//
+
+#include <math.h>
+#include "../LapPredictor.h"
+#include "test.h"
+
+struct Rows
+{
+    float   pct[IR_MAX_CARS];
+    float   speed[IR_MAX_CARS];
+    float   est[IR_MAX_CARS];
+    int     lap[IR_MAX_CARS];
+
+    Rows()
+    {
+        for( int i=0; i<IR_MAX_CARS; ++i ) {
+            pct[i] = -1;
+            speed[i] = 0;
+            est[i] = 0;
+            lap[i] = -1;
+        }
+    }
+
+    // Car at 'dist' laps from the start of the race, on a lap of 'laptime' seconds. The speed is what
+    // RaceState would have: none for a jump, negative going backwards.
+    void set( int carIdx, double dist, float laptime, float lapSpeed )
+    {
+        lap[carIdx] = (int)floor( dist );
+        pct[carIdx] = float( dist - floor( dist ) );
+        est[carIdx] = pct[carIdx] * laptime;
+        speed[carIdx] = lapSpeed;
+    }
+    void set( int carIdx, double dist, float laptime ) { set( carIdx, dist, laptime, 1/laptime ); }
+};
+
+struct Prediction
+{
+    float   pct[IR_MAX_CARS];
+    float   est[IR_MAX_CARS];
+    int     lap[IR_MAX_CARS];
+
+    void get( const LapPredictor& p, double renderTime ) { p.predict( renderTime, pct, est, lap ); }
+    double dist( int carIdx ) const { return lap[carIdx] + (double)pct[carIdx]; }
+};
+
+int main()
+{
+    // Steady car on 90s laps at 60Hz, across the line. Rows arrive 3ms after their session time.
+    {
+        LapPredictor p;
+        Rows r;
+        Prediction out;
+        double maxErr = 0;
+        int numWraps = 0;
+        for( int k=0; k<600; ++k )
+        {
+            const double t = k / 60.0;
+            r.set( 0, 4.951 + t/90, 90 );
+            p.addSample( t, t+0.003, r.pct, r.speed, r.est, r.lap );
+
+            if( k < 2 )
+                continue;
+            out.get( p, t+0.003+0.01 );
+            maxErr = std::max( maxErr, fabs( out.dist(0) - (4.951 + (t+0.01)/90) ) );
+            numWraps += out.lap[0] != r.lap[0];
+        }
+        CHECK( maxErr < 1e-5 );
+        CHECK( numWraps > 0 );
+        CHECK( p.numSnaps() == 0 );
+        CHECK( out.pct[1] == -1 );      // not in the world
+    }
+
+    // A fast car with sparse rows: 30s laps at 10Hz covers more than SnapPct per row. It still picks
+    // up its speed from the first two rows, and again right after a tow snaps it.
+    {
+        LapPredictor p;
+        Rows r;
+        Prediction out;
+        double t = 0;
+        for( int k=0; k<3; ++k, t+=0.1 )
+        {
+            r.set( 2, 0.2 + t/30, 30 );
+            p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        }
+        t -= 0.1;
+        out.get( p, t+0.05 );
+        CHECK_NEAR( out.dist(2), 0.2 + (t+0.05)/30, 1e-5 );
+
+        // Towed 0.3 laps down the road: snaps to the new row and stands still there
+        t += 0.1;
+        r.set( 2, 0.5 + t/30, 30, 0 );
+        p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        CHECK( p.numSnaps() == 1 );
+        out.get( p, t+0.05 );
+        CHECK( out.pct[2] == r.pct[2] );
+
+        // The next row has a speed again, not another snap against standing still
+        t += 0.1;
+        r.set( 2, 0.5 + t/30, 30 );
+        p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        CHECK( p.numSnaps() == 1 );
+        out.get( p, t+0.05 );
+        CHECK_NEAR( out.dist(2), 0.5 + (t+0.05)/30, 1e-5 );
+        CHECK_NEAR( out.est[2], r.est[2] + 0.05f, 1e-4 );
+
+        // And keeps it
+        for( int k=0; k<20; ++k )
+        {
+            t += 0.1;
+            r.set( 2, 0.5 + t/30, 30 );
+            p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        }
+        CHECK( p.numSnaps() == 1 );
+        out.get( p, t+0.05 );
+        CHECK_NEAR( out.dist(2), 0.5 + (t+0.05)/30, 1e-5 );
+    }
+
+    // Spinning backwards, jumping further than any car drives right after a snap, leaving the world, pausing
+    {
+        LapPredictor p;
+        Rows r;
+        Prediction out;
+        double t = 0;
+        for( int k=0; k<10; ++k, t+=1/60.0 )
+        {
+            r.set( 3, 0.3 + t/90, 90 );
+            p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        }
+
+        r.set( 3, 0.29, 90, -0.5f );
+        p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        CHECK( p.numSnaps() == 1 );
+        out.get( p, t+0.02 );
+        CHECK( out.pct[3] == r.pct[3] );
+
+        t += 1/60.0;
+        r.set( 3, 0.6, 90, 0 );
+        p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        out.get( p, t+0.02 );
+        CHECK( out.pct[3] == r.pct[3] );
+
+        t += 1/60.0;
+        r.pct[3] = -1;
+        p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        out.get( p, t+0.02 );
+        CHECK( out.pct[3] == -1 );
+
+        // Paused: the same session time again, nobody moves however long we wait
+        r.set( 4, 0.7, 90, 0 );
+        p.addSample( t, t, r.pct, r.speed, r.est, r.lap );
+        p.addSample( t+1/60.0, t, r.pct, r.speed, r.est, r.lap );
+        r.set( 4, 0.7 + 1/(60.0*90), 90, 0 );
+        p.addSample( t+2/60.0, t, r.pct, r.speed, r.est, r.lap );
+        p.addSample( t+2/60.0, t+1, r.pct, r.speed, r.est, r.lap );
+        out.get( p, t+1.04 );
+        CHECK( out.pct[4] == r.pct[4] );
+    }
+
+    return testResult( "lap_predictor_test" );
+}
@@ -0,0 +1,148 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Lap statistics test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// A long race for one car with random lap times, some of them pit or caution laps. Mean and
+// standard deviation are checked against a two-pass computation, the streaming median against
+// the exact one, and pit and caution laps must not count.
+//
+// Usage: lap_stats_test
+//
+
+#include <vector>
+#include <algorithm>
+#include "../LapStats.h"
+#include "test.h"
+
+static const int NumLaps = 400;
+
+static Session  s_session;
+static LapStats s_stats;
+static double   s_time = 0;
+static int      s_lapCompleted[IR_MAX_CARS];
+static float    s_lastLapTime[IR_MAX_CARS];
+static bool     s_onPitRoad[IR_MAX_CARS];
+static bool     s_inWorld[IR_MAX_CARS];
+static bool     s_caution = false;
+
+static void tick()
+{
+    s_time += 1;
+    s_stats.update( s_time, s_session, s_lapCompleted, s_lastLapTime, s_onPitRoad, s_inWorld, s_caution, s_session.activeMask );
+}
+
+// Uniform in [0,1), the same on every run
+static float rnd()
+{
+    static unsigned s = 12345;
+    s = s * 1664525u + 1013904223u;
+    return (s >> 8) / 16777216.0f;
+}
+
+static float exactMedian( std::vector<float> v )
+{
+    std::sort( v.begin(), v.end() );
+    const size_t n = v.size();
+    return n & 1 ? v[n/2] : (v[n/2-1] + v[n/2]) / 2;
+}
+
+int main()
+{
+    s_session.numActiveCars = 1;
+    s_session.activeCarIdx[0] = 0;
+    s_session.activeMask = 1;
+    s_inWorld[0] = true;
+
+    // P-square is exact up to five samples
+    {
+        P2Quantile q;
+        const float x[5] = { 3, 1, 4, 1, 5 };
+        for( int i=0; i<5; ++i )
+            q.add( x[i] );
+        CHECK( q.estimate() == 3 );
+    }
+
+    // Around 90s with a bit of noise, and now and then a lap lost in traffic. Every 40th lap has a pit
+    // stop in it, every 25th a caution.
+    std::vector<float> raceLaps, stintLaps;
+    for( int lap=0; lap<NumLaps; ++lap )
+    {
+        float t = 90 + (rnd() + rnd() + rnd() - 1.5f) * 0.8f;
+        if( rnd() < 0.05f )
+            t += 3 + 5 * rnd();
+
+        const bool pit = lap % 40 == 20;
+        const bool caution = lap % 25 == 10;
+        for( int k=0; k<10; ++k )
+        {
+            s_onPitRoad[0] = pit && k < 3;
+            s_caution = caution && k == 5;
+            tick();
+        }
+
+        // Completed, with the time showing up a tick later
+        s_lapCompleted[0] = lap+1;
+        tick();
+        s_lastLapTime[0] = t;
+        tick();
+
+        if( pit )
+            stintLaps.clear();
+        if( lap > 0 && !pit && !caution ) {     // the first lap was already in progress when we started looking
+            raceLaps.push_back( t );
+            stintLaps.push_back( t );
+        }
+    }
+
+    // Two passes over the clean laps
+    double sum = 0;
+    for( float t : raceLaps )
+        sum += t;
+    const double mean = sum / raceLaps.size();
+    double sq = 0;
+    for( float t : raceLaps )
+        sq += (t - mean) * (t - mean);
+    const double stddev = sqrt( sq / (raceLaps.size()-1) );
+
+    const LapStatSet& race = s_stats.race( 0 );
+    CHECK( race.numLaps() == (int)raceLaps.size() );
+    CHECK_NEAR( race.mean(), mean, 1e-4 );
+    CHECK_NEAR( race.stddev(), stddev, 1e-4 );
+    CHECK( race.best == *std::min_element( raceLaps.begin(), raceLaps.end() ) );
+    CHECK_NEAR( race.median.estimate(), exactMedian( raceLaps ), 0.02 );
+
+    const LapStatSet& stint = s_stats.stint( 0 );
+    CHECK( stint.numLaps() == (int)stintLaps.size() );
+    CHECK_NEAR( stint.median.estimate(), exactMedian( stintLaps ), 0.1 );
+
+    const std::vector<float> recent( raceLaps.end() - LapStats::RecentLaps, raceLaps.end() );
+    CHECK_NEAR( s_stats.recentPace( 0 ), exactMedian( recent ), 1e-6 );
+
+    // A car that isn't in the session isn't looked at
+    CHECK( s_stats.race( 1 ).numLaps() == 0 );
+
+    return testResult( "lap_stats_test" );
+}
@@ -0,0 +1,137 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// IncrementalOrder test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Checks the frame-to-frame order repair and the window query around one item against a full
+// sort (compared by key, as exact ties may legitimately come out either way), over random fields that shuffle a little every frame like cars overtaking, and that ties
+// keep their order.
+//
+// Usage: order_test [-n frames]
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "../util.h"
+#include "test.h"
+
+static std::vector<int> sortedItems( const float* keys, unsigned long long mask )
+{
+    std::vector<int> items;
+    for( int item=0; item<64; ++item )
+        if( (mask >> item) & 1 )
+            items.push_back( item );
+    std::stable_sort( items.begin(), items.end(), [&]( int a, int b ) { return keys[a] < keys[b]; } );
+    return items;
+}
+
+int main( int argc, char** argv )
+{
+    int frames = 20000;
+    for( int i=1; i<argc; ++i )
+    {
+        if( !strcmp(argv[i],"-n") && i+1<argc )
+            frames = std::max( 1, atoi(argv[++i]) );
+    }
+
+    float keys[64];
+    srand( 1 );
+    for( int item=0; item<64; ++item )
+        keys[item] = (rand() % 100000) / 1000.0f;
+
+    IncrementalOrder full, window;
+    unsigned long long mask = ~0ULL;
+    int orderMismatches = 0, windowMismatches = 0;
+    for( int frame=0; frame<frames; ++frame )
+    {
+        // Small moves every frame, cars coming and going now and then
+        for( int item=0; item<64; ++item )
+            keys[item] += ((rand() % 2001) - 1000) / 10000.0f;
+        if( rand() % 50 == 0 )
+            mask ^= 1ULL << (rand() % 64);
+
+        const int center = rand() % 64;
+        const int before = rand() % 8;
+        const int after  = rand() % 8;
+
+        full.update( keys, mask );
+        window.updateWindow( keys, mask, center, before, after );
+
+        const std::vector<int> ref = sortedItems( keys, mask );
+
+        bool same = full.size() == (int)ref.size();
+        for( int i=0; same && i<full.size(); ++i )
+            same = keys[full[i]] == keys[ref[i]] && full.indexOf(full[i]) == i;
+        orderMismatches += !same;
+
+        const auto it = std::find( ref.begin(), ref.end(), center );
+        if( it == ref.end() )
+        {
+            windowMismatches += window.size() != 0 || window.indexOf(center) != -1;
+            continue;
+        }
+        const int c     = int( it - ref.begin() );
+        const int first = std::max( 0, c - before );
+        const int last  = std::min( (int)ref.size()-1, c + after );
+        same = window.size() == last-first+1 && window[c-first] == center;
+        for( int i=first; same && i<=last; ++i )
+            same = keys[window[i-first]] == keys[ref[i]] && window.indexOf(window[i-first]) == i-first;
+        int numIndexed = 0;
+        for( int item=0; item<64; ++item )
+            numIndexed += window.indexOf(item) >= 0;
+        same = same && numIndexed == window.size();
+        windowMismatches += !same;
+    }
+    CHECK( orderMismatches == 0 );
+    CHECK( windowMismatches == 0 );
+
+    // Ties keep whatever order they had, in both
+    {
+        float tied[64];
+        for( int item=0; item<64; ++item )
+            tied[item] = float( item );
+        const unsigned long long m = 0xffULL;
+        IncrementalOrder o, w;
+        o.update( tied, m );
+        w.updateWindow( tied, m, 4, 3, 3 );
+        CHECK( w.size() == 7 && w[0] == 1 && w[3] == 4 && w[6] == 7 );
+
+        tied[2] = tied[3] = tied[4] = tied[5] = 3.0f;
+        o.update( tied, m );
+        w.updateWindow( tied, m, 4, 3, 3 );
+        CHECK( o[2] == 2 && o[3] == 3 && o[4] == 4 && o[5] == 5 );
+        CHECK( w[1] == 2 && w[2] == 3 && w[3] == 4 && w[4] == 5 );
+
+        // Nothing shown ahead or behind
+        w.updateWindow( tied, m, 0, 0, 0 );
+        CHECK( w.size() == 1 && w[0] == 0 && w.indexOf(1) == -1 );
+        w.updateWindow( tied, m, 7, 10, 0 );
+        CHECK( w.size() == 8 && w.indexOf(7) == 7 );
+    }
+
+    return testResult( "order_test" );
+}
@@ -0,0 +1,129 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Pit log test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// A regular stop, a drive-through, and cars vanishing from the world or the session while in the
+// pit lane, which mustn't count as stops.
+//
+// Usage: pit_log_test
+//
+
+#include "../PitLog.h"
+#include "test.h"
+
+static PitLog   s_log;
+static double   s_time = 0;
+static int      s_lap[IR_MAX_CARS];
+static bool     s_onPitRoad[IR_MAX_CARS];
+static bool     s_inPitStall[IR_MAX_CARS];
+static bool     s_inWorld[IR_MAX_CARS];
+static unsigned long long s_validMask = 0xf;
+
+// Half second ticks
+static void run( double seconds )
+{
+    for( const double end = s_time + seconds; s_time < end; )
+    {
+        s_time += 0.5;
+        s_log.update( s_time, s_lap, s_onPitRoad, s_inPitStall, s_inWorld, s_validMask );
+    }
+}
+
+int main()
+{
+    for( int i=0; i<4; ++i ) {
+        s_lap[i] = 5;
+        s_inWorld[i] = true;
+    }
+    run( 10 );
+
+    // Car 0 stops for 20s, car 1 drives through, car 2 goes back to the garage from the pit lane
+    // and car 3 disconnects there
+    for( int i=0; i<4; ++i )
+        s_onPitRoad[i] = true;
+    run( 15 );
+    CHECK( s_log.isInLane( 0 ) );
+    CHECK( s_log.current( 0 ).lap == 5 );
+    CHECK( s_log.current( 0 ).entryTime == 10.5 );
+
+    s_inPitStall[0] = true;
+    s_inWorld[2] = false;
+    s_validMask &= ~(1ULL << 3);
+    run( 20 );
+    CHECK( !s_log.isInLane( 2 ) );
+    CHECK( !s_log.isInLane( 3 ) );
+
+    s_inPitStall[0] = false;
+    run( 15 );
+    s_onPitRoad[0] = false;
+    s_onPitRoad[1] = false;
+    s_lap[0] = s_lap[1] = 6;
+    run( 1 );
+
+    CHECK( s_log.numStops( 0 ) == 1 );
+    CHECK( !s_log.isInLane( 0 ) );
+    const PitStop& ps = s_log.stop( 0, 0 );
+    CHECK( ps.lap == 5 );
+    CHECK( ps.entryTime == 10.5 );
+    CHECK( ps.exitTime == 60.5 );
+    CHECK_NEAR( ps.laneTime, 50, 1e-4 );
+    CHECK_NEAR( ps.stallTime, 20, 1e-4 );
+    CHECK_NEAR( s_log.avgLaneTime( 0 ), 50, 1e-4 );
+    CHECK_NEAR( s_log.avgStallTime( 0 ), 20, 1e-4 );
+
+    CHECK( s_log.numStops( 1 ) == 1 );
+    CHECK_NEAR( s_log.stop( 1, 0 ).laneTime, 50, 1e-4 );
+    CHECK( s_log.stop( 1, 0 ).stallTime == 0 );
+
+    // Back from the garage onto pit road and out isn't a stop either, and neither is coming back
+    // into the session on track
+    s_inWorld[2] = true;
+    s_validMask |= 1ULL << 3;
+    s_onPitRoad[3] = false;
+    run( 10 );
+    s_onPitRoad[2] = false;
+    run( 10 );
+    CHECK( s_log.numStops( 2 ) == 0 );
+    CHECK( s_log.numStops( 3 ) == 0 );
+    CHECK( !s_log.isInLane( 2 ) );
+    CHECK( !s_log.isInLane( 3 ) );
+
+    // A second stop for car 0 counts towards the averages
+    s_onPitRoad[0] = true;
+    run( 10 );
+    s_inPitStall[0] = true;
+    run( 30 );
+    s_inPitStall[0] = false;
+    run( 10 );
+    s_onPitRoad[0] = false;
+    run( 1 );
+    CHECK( s_log.numStops( 0 ) == 2 );
+    CHECK_NEAR( s_log.stop( 0, 0 ).stallTime, 30, 1e-4 );
+    CHECK_NEAR( s_log.stop( 0, 1 ).stallTime, 20, 1e-4 );
+    CHECK_NEAR( s_log.avgStallTime( 0 ), 25, 1e-4 );
+
+    return testResult( "pit_log_test" );
+}
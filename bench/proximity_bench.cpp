@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Spotter proximity benchmark. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Times Proximity::update() over full fields of cars driving around a track at slightly different
+// speeds, with some in the pits, like ir_tick() calls it once per telemetry update. Speeds are
+// given, like RaceState has them.
+// Reports median and p99 time per update.
+//
+// Usage: proximity_bench [-n iterations]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include "../Proximity.h"
+
+static float g_sink = 0;
+
+int main( int argc, char** argv )
+{
+    int iterations = 200000;
+    for( int i=1; i<argc; ++i )
+    {
+        if( !strcmp(argv[i],"-n") && i+1<argc )
+            iterations = std::max( 1, atoi(argv[++i]) );
+    }
+
+    printf( "Proximity benchmark, %d updates per measurement\n\n", iterations );
+
+    const int fieldSizes[] = { 2, 20, 40, 64 };
+    for( int numCars : fieldSizes )
+    {
+        srand( 1 );
+        float pct[IR_MAX_CARS] = {};
+        float lapTime[IR_MAX_CARS] = {};
+        float speed[IR_MAX_CARS] = {};
+        unsigned long long mask = 0;
+        for( int i=0; i<numCars; ++i ) {
+            pct[i] = (rand() % 10000) / 10000.0f;
+            lapTime[i] = 100.0f + (rand() % 300) / 100.0f;
+            speed[i] = 5000 / lapTime[i];
+            if( rand() % 10 )
+                mask |= 1ULL << i;
+        }
+        mask |= 1;
+
+        Proximity prox;
+        prox.setTrackLength( 5000 );
+
+        std::vector<double> samples;
+        samples.reserve( iterations );
+        const double dt = 1.0 / 60.0;
+        for( int it=0; it<iterations; ++it )
+        {
+            for( int i=0; i<numCars; ++i ) {
+                pct[i] += float(dt) / lapTime[i];
+                if( pct[i] >= 1 )
+                    pct[i] -= 1;
+            }
+
+            const auto t0 = std::chrono::steady_clock::now();
+            prox.update( 0, pct, speed, mask );
+            const auto t1 = std::chrono::steady_clock::now();
+            samples.push_back( std::chrono::duration<double,std::micro>(t1-t0).count() );
+
+            g_sink += prox.result().ahead.meters + prox.result().behind.closingSpeed;
+        }
+
+        std::sort( samples.begin(), samples.end() );
+        printf( "%2d cars  update  median %7.3f us  p99 %7.3f us\n", numCars, samples[samples.size()/2], samples[std::min(samples.size()-1, (size_t)(samples.size()*0.99))] );
+    }
+
+    return g_sink == 12345.0f;
+}
@@ -0,0 +1,158 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Race end projection test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Synthetic timed races close to the time boundary: the leader crossing just before, exactly at
+// and just after the clock runs out, lapped cars, cars right behind the leader, and what's left
+// once the checkered flag is out.
+//
+// Usage: race_end_test
+//
+
+#include "../RaceEndProjection.h"
+#include "test.h"
+
+static RaceEndInput race( double timeRemaining, float leaderDistance, float leaderPace, float selfDistance, float selfPace )
+{
+    RaceEndInput in;
+    in.timeRemaining  = timeRemaining;
+    in.leaderDistance = leaderDistance;
+    in.leaderPace     = leaderPace;
+    in.selfDistance   = selfDistance;
+    in.selfPace       = selfPace;
+    return in;
+}
+
+int main()
+{
+    // Leader half way round lap 10 at 100s laps: 50s to the line
+    {
+        // Clock runs out just before the leader gets there: the flag comes out at 11
+        RaceEndProjection p = ir_projectRaceEnd( race( 49.9, 10.5f, 100, 10.2f, 100 ) );
+        CHECK( p.valid );
+        CHECK( p.leaderFinishLap == 11 );
+        CHECK_NEAR( p.timeToLeaderFinish, 50.0, 1e-3 );
+        CHECK( p.selfFinishLap == 11 );
+        CHECK_NEAR( p.lapsToGo, 0.8, 1e-4 );
+        CHECK( p.remainingLaps == 1 );
+
+        // Crossing right as the clock hits zero still ends it
+        p = ir_projectRaceEnd( race( 50.0, 10.5f, 100, 10.2f, 100 ) );
+        CHECK( p.leaderFinishLap == 11 );
+
+        // Just after: one more lap for everyone
+        p = ir_projectRaceEnd( race( 50.1, 10.5f, 100, 10.2f, 100 ) );
+        CHECK( p.leaderFinishLap == 12 );
+        CHECK_NEAR( p.timeToLeaderFinish, 150.0, 1e-3 );
+        CHECK( p.selfFinishLap == 12 );
+        CHECK_NEAR( p.lapsToGo, 1.8, 1e-4 );
+        CHECK( p.remainingLaps == 2 );
+
+        // Clock already ran out: the leader's next crossing
+        p = ir_projectRaceEnd( race( -5.0, 10.5f, 100, 10.2f, 100 ) );
+        CHECK( p.leaderFinishLap == 11 );
+        CHECK_NEAR( p.lapsToGo, 0.8, 1e-4 );
+    }
+
+    // A lapped, slower car: at 9.9 with 105s laps it's at 10.38 when the leader finishes in 50s,
+    // so it still has to get to 11
+    {
+        const RaceEndProjection p = ir_projectRaceEnd( race( 10.0, 10.5f, 100, 9.9f, 105 ) );
+        CHECK( p.leaderFinishLap == 11 );
+        CHECK( p.selfFinishLap == 11 );
+        CHECK_NEAR( p.lapsToGo, 1.1, 1e-4 );
+        CHECK( p.remainingLaps == 2 );
+    }
+
+    // Right behind the leader as it takes the flag: we finish at the same line
+    {
+        const RaceEndProjection p = ir_projectRaceEnd( race( 0, 10.995f, 100, 10.99f, 100 ) );
+        CHECK( p.leaderFinishLap == 11 );
+        CHECK( p.selfFinishLap == 11 );
+        CHECK_NEAR( p.lapsToGo, 0.01, 1e-4 );
+        CHECK( p.remainingLaps == 1 );
+    }
+
+    // A much faster car a lap down gets to its line before the leader finishes, and goes on to the next
+    {
+        const RaceEndProjection p = ir_projectRaceEnd( race( 0, 10.5f, 100, 9.8f, 50 ) );
+        CHECK( p.leaderFinishLap == 11 );
+        CHECK( p.selfFinishLap == 11 );
+        CHECK_NEAR( p.lapsToGo, 1.2, 1e-4 );
+        CHECK( p.remainingLaps == 2 );
+    }
+
+    // We're the leader: our own crossing ends it
+    {
+        const RaceEndProjection p = ir_projectRaceEnd( race( 30, 10.5f, 100, 10.5f, 100 ) );
+        CHECK( p.leaderFinishLap == 11 );
+        CHECK( p.selfFinishLap == 11 );
+        CHECK_NEAR( p.lapsToGo, 0.5, 1e-4 );
+    }
+
+    // The leader took the flag at 20 and is on its cool-down lap. We're at 19.5, so it's half a lap
+    // to the flag, not another lap after the leader's next crossing.
+    {
+        RaceEndInput in = race( -20, 20.1f, 100, 19.5f, 100 );
+        in.leaderFinished = true;
+        RaceEndProjection p = ir_projectRaceEnd( in );
+        CHECK( p.valid );
+        CHECK( p.leaderFinishLap == 20 );
+        CHECK( p.selfFinishLap == 20 );
+        CHECK_NEAR( p.lapsToGo, 0.5, 1e-4 );
+        CHECK( p.remainingLaps == 1 );
+
+        // Same for a car laps down
+        in.selfDistance = 17.25f;
+        p = ir_projectRaceEnd( in );
+        CHECK( p.selfFinishLap == 18 );
+        CHECK_NEAR( p.lapsToGo, 0.75, 1e-4 );
+
+        // Once we've crossed the line too, there's nothing left
+        in.selfDistance = 20.05f;
+        in.selfFinished = true;
+        p = ir_projectRaceEnd( in );
+        CHECK( p.valid );
+        CHECK( p.lapsToGo == 0 );
+        CHECK( p.remainingLaps == 0 );
+
+        // The leader may have left the track (in the pits, or out of the world); doesn't matter anymore
+        in.leaderDistance = -1;
+        in.leaderPace = 0;
+        in.selfDistance = 19.5f;
+        in.selfFinished = false;
+        p = ir_projectRaceEnd( in );
+        CHECK( p.valid );
+        CHECK_NEAR( p.lapsToGo, 0.5, 1e-4 );
+    }
+
+    // Nothing to go on
+    CHECK( !ir_projectRaceEnd( race( 100, -1, 100, 10.2f, 100 ) ).valid );
+    CHECK( !ir_projectRaceEnd( race( 100, 10.5f, 0, 10.2f, 100 ) ).valid );
+    CHECK( !ir_projectRaceEnd( race( 100, 10.5f, 100, -1, 100 ) ).valid );
+
+    return testResult( "race_end_test" );
+}
@@ -0,0 +1,241 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// RaceState test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Parses a race session from the synthetic corpus (three classes, one driver turned into a
+// spectator), feeds ir_updateRaceState() fixed telemetry arrays and checks what the overlays read
+// from it: which cars are valid, positions and the position tables, class leaders, lap deltas
+// and gaps, and pit age.
+//
+// Usage: race_state_test
+//
+
+#include <string.h>
+#include <string>
+#include "../RaceState.h"
+#include "session_corpus.h"
+#include "test.h"
+
+static Session        g_session;
+static RaceStateInput g_in;
+static RaceState      g_state;
+
+static const int NumDrivers   = 20;
+static const int SpectatorIdx = 9;
+
+// Race distance of each driver: car 1 leads at 10.5 laps, everyone else 0.15 laps further back
+// than the car before
+static float distanceOf( int carIdx )
+{
+    return 10.5f - 0.15f * (carIdx-1);
+}
+
+static void setCar( int carIdx, float distance, int position, int classPosition )
+{
+    g_in.lap[carIdx]           = int( distance );
+    g_in.lapCompleted[carIdx]  = int( distance ) - 1;
+    g_in.lapDistPct[carIdx]    = distance - int( distance );
+    g_in.position[carIdx]      = position;
+    g_in.classPosition[carIdx] = classPosition;
+    g_in.estTime[carIdx]       = g_in.lapDistPct[carIdx] * 140.0f;
+    g_in.f2Time[carIdx]        = (distanceOf(1) - distance) * 140.0f;
+    g_in.inWorld[carIdx]       = true;
+}
+
+int main()
+{
+    CorpusSpec spec;
+    spec.numDrivers  = NumDrivers;
+    spec.numClasses  = 3;
+    spec.sessionNum  = 2;
+    spec.withResults = false;
+
+    // Turn one driver into a spectator
+    std::string str = makeSessionStr( spec );
+    {
+        char key[32];
+        snprintf( key, sizeof(key), " - CarIdx: %d\n", SpectatorIdx );
+        const size_t car  = str.find( key );
+        const size_t flag = str.find( "IsSpectator: 0", car );
+        CHECK( car != std::string::npos && flag != std::string::npos );
+        str[flag + strlen("IsSpectator: ")] = '1';
+    }
+    ir_parseSessionStr( str.c_str(), spec.sessionNum, g_session );
+
+    CHECK( g_session.sessionType == SessionType::RACE );
+    CHECK( g_session.paceCarIdx == 0 );
+    CHECK( g_session.numClasses == 3 );
+    CHECK( g_session.numActiveCars == NumDrivers );   // the pace car and the drivers minus the spectator
+    CHECK( g_session.cars[0].userId == -1 );
+    CHECK( g_session.cars[5].userId == 100000 + 5*3119 );
+
+    // Telemetry: drivers strung out in carIdx order, class positions in the same order. The
+    // pace car is laps 'ahead' and both it and the spectator claim P1, as iRacing can report.
+    for( int i=0; i<IR_MAX_CARS; ++i ) {
+        g_in.lap[i] = -1;
+        g_in.lapDistPct[i] = -1;
+    }
+    int classCount[3] = {};
+    for( int carIdx=1, pos=1; carIdx<=NumDrivers; ++carIdx )
+    {
+        if( carIdx == SpectatorIdx )
+            continue;
+        const int classIdx = g_session.cars[carIdx].classIdx;
+        CHECK( classIdx >= 0 && classIdx < 3 );
+        setCar( carIdx, distanceOf(carIdx), pos++, ++classCount[classIdx] );
+    }
+    setCar( 0, 12.1f, 1, 1 );
+    setCar( SpectatorIdx, 10.99f, 1, 1 );
+    g_in.sessionStateValid = true;
+    g_in.sessionVersion    = 1;
+
+    ir_updateRaceState( g_session, g_in, g_state );
+
+    // Valid: drivers 1..20 except the spectator. Not the pace car, not empty slots.
+    {
+        unsigned long long expected = 0;
+        for( int carIdx=1; carIdx<=NumDrivers; ++carIdx )
+            if( carIdx != SpectatorIdx )
+                expected |= 1ULL << carIdx;
+        CHECK( g_state.validMask == expected );
+        CHECK( !g_state.isValid(0) );
+        CHECK( !g_state.isValid(SpectatorIdx) );
+        CHECK( !g_state.isValid(NumDrivers+1) );
+        CHECK( !g_state.isValid(-1) );
+    }
+
+    // Positions and the tables built from them. Neither the pace car nor the spectator take P1.
+    CHECK( g_state.leaderCarIdx == 1 );
+    CHECK( g_state.carAtPosition(1) == 1 );
+    CHECK( g_state.carAtPosition(8) == 8 );
+    CHECK( g_state.carAtPosition(9) == 10 );
+    CHECK( g_state.carAtPosition(NumDrivers) == -1 );
+    CHECK( g_state.position[10] == 9 );
+    CHECK( g_state.carAhead(10) == 8 );
+    CHECK( g_state.carAhead(1) == -1 );
+    for( int classIdx=0; classIdx<3; ++classIdx )
+    {
+        const int ldr = g_state.classLeaderCarIdx[classIdx];
+        CHECK( ldr == classIdx+1 );
+        CHECK( g_state.carAtClassPosition(g_session, classIdx, 1) == ldr );
+    }
+    CHECK( g_state.carAheadInClass(g_session, 7) == 4 );
+    CHECK( g_state.carAheadInClass(g_session, 12) == 6 );  // 9 would be in between, but it's spectating
+
+    // Lap deltas to the leader (10.5 laps): within a lap behind counts as the lead lap
+    CHECK( g_state.lapDeltaToLeader[1] == 0 );
+    CHECK( g_state.lapDeltaToLeader[2] == 0 );     // 10.35
+    CHECK( g_state.lapDeltaToLeader[7] == 0 );     // 9.6
+    CHECK( g_state.lapDeltaToLeader[8] == -1 );    // 9.45
+    CHECK( g_state.lapDeltaToLeader[15] == -2 );   // 8.4
+    CHECK( g_state.lapDeltaToLeader[20] == -2 );   // 7.65
+
+    // ... and to the class leaders: car 3 (10.2) leads car 12 (8.85) and car 18 (7.95)
+    CHECK( g_state.lapDeltaToClassLeader[12] == -1 );
+    CHECK( g_state.lapDeltaToClassLeader[18] == -2 );
+    CHECK( g_state.classLeader(g_session, 18) == 3 );
+    CHECK_NEAR( g_state.gapToLeader[18], (distanceOf(1)-distanceOf(18))*140.0f, 1e-3 );
+    CHECK_NEAR( g_state.gapToClassLeader[18], (distanceOf(3)-distanceOf(18))*140.0f, 1e-3 );
+
+    CHECK_NEAR( g_state.distance[2], distanceOf(2), 1e-4 );
+    CHECK( g_state.lapCount[2] == 10 );
+
+    // No new positions, no rebuild of the tables
+    const int rebuilds = g_state.positionRebuilds;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.positionRebuilds == rebuilds );
+
+    // Car 10 passes car 8
+    g_in.position[10] = 8;
+    g_in.position[8]  = 9;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.positionRebuilds == rebuilds+1 );
+    CHECK( g_state.carAtPosition(8) == 10 );
+    CHECK( g_state.carAhead(8) == 10 );
+
+    // Before the start and outside of races nobody has a lap delta
+    g_in.isPreStart = true;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.lapDeltaToLeader[15] == 0 );
+    CHECK( g_state.lapDeltaToClassLeader[18] == 0 );
+    g_in.isPreStart = false;
+
+    g_session.sessionType = SessionType::PRACTICE;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.lapDeltaToLeader[15] == 0 );
+    CHECK( g_state.gapToLeader[18] == 0 );
+    g_session.sessionType = SessionType::RACE;
+
+    // Pit age: car 5 stops on lap 9, two laps later it's 2. Warmup resets it.
+    g_in.onPitRoad[5] = true;
+    g_in.lap[5] = 9;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.pitAge[5] == 0 );
+    g_in.onPitRoad[5] = false;
+    g_in.lap[5] = 11;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.pitAge[5] == 2 );
+    g_in.isWarmup = true;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.pitAge[5] == 11 );
+    g_in.isWarmup = false;
+
+    // Along-track speeds from consecutive rows: car 2 crosses the line, car 4 gets towed, and the
+    // pace car has one too. Nothing moves without a new row.
+    CHECK_NEAR( g_session.trackLengthM, 6930, 0.1 );
+    g_in.sessionTime = 100;
+    g_in.lapDistPct[0] = 0.1f;
+    g_in.lapDistPct[2] = 0.998f;
+    g_in.lapDistPct[4] = 0.5f;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.lapSpeed[2] == 0 );
+
+    g_in.sessionTime = 100.1;
+    g_in.lapDistPct[0] = 0.1015f;
+    g_in.lapDistPct[2] = 0.0004f;
+    g_in.lapDistPct[4] = 0.8f;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK_NEAR( g_state.lapSpeed[0], 0.015, 1e-5 );
+    CHECK_NEAR( g_state.lapSpeed[2], 0.024, 1e-5 );
+    CHECK_NEAR( g_state.speed[2], 0.024*6930, 0.1 );
+    CHECK( g_state.lapSpeed[4] == 0 );
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK_NEAR( g_state.lapSpeed[2], 0.024, 1e-5 );
+
+    g_in.sessionTime = 100.2;
+    g_in.lapDistPct[2] = 0.0024f;
+    g_in.lapDistPct[4] = 0.8015f;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK_NEAR( g_state.lapSpeed[2], 0.022, 1e-5 );     // half way to the new 0.02
+    CHECK_NEAR( g_state.lapSpeed[4], 0.015, 1e-5 );     // right away after the tow
+
+    // Time going backwards starts over
+    g_in.sessionTime = 50;
+    ir_updateRaceState( g_session, g_in, g_state );
+    CHECK( g_state.lapSpeed[2] == 0 && g_state.speed[4] == 0 );
+
+    return testResult( "race_state_test" );
+}
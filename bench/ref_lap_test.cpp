@@ -0,0 +1,90 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Reference lap test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Records laps at constant speed, saves them through the background writer and loads them back.
+//
+// Usage: ref_lap_test
+//
+
+#include <stdio.h>
+#include "../ReferenceLap.h"
+#include "test.h"
+
+static void drive( RefLapRecorder& r, double t0, double t1, float laptime )
+{
+    for( double t=t0; t<t1; t+=1/60.0 )
+    {
+        const double d = t / laptime + 0.5;
+        r.update( t, float( d - (int)d ), true );
+    }
+}
+
+int main()
+{
+    const char* filename = "ref_lap_test.bin";
+    remove( filename );
+
+    // Joining half way round, so the first full lap is the second one
+    RefLapRecorder rec;
+    drive( rec, 0, 100, 40 );
+    CHECK( rec.isDirty() );
+    CHECK( rec.ref( RefLapKind::BEST ).valid );
+    CHECK_NEAR( rec.ref( RefLapKind::BEST ).lapTime(), 40, 0.05 );
+
+    {
+        RefLapWriter writer;
+        RefLapFile file;
+        rec.snapshot( file );
+        CHECK( !rec.isDirty() );
+        writer.post( filename, file );
+
+        // A faster lap before the first one is written: whichever gets there, the last one wins
+        drive( rec, 100, 200, 38 );
+        CHECK( rec.isDirty() );
+        rec.snapshot( file );
+        writer.post( filename, file );
+    }   // waits for the writer
+
+    RefLapRecorder loaded;
+    CHECK( loaded.load( filename ) );
+    CHECK( loaded.ref( RefLapKind::BEST ).valid );
+    CHECK_NEAR( loaded.ref( RefLapKind::BEST ).lapTime(), rec.ref( RefLapKind::BEST ).lapTime(), 1e-4 );
+    CHECK( rec.ref( RefLapKind::BEST ).lapTime() < 39 );
+    CHECK( !loaded.isDirty() );
+
+    // Nowhere to write to: reported, and nothing else happens
+    {
+        RefLapWriter writer;
+        RefLapFile file;
+        rec.snapshot( file );
+        writer.post( "no/such/dir/ref_lap_test.bin", file );
+    }
+    CHECK( !loaded.load( "no/such/dir/ref_lap_test.bin" ) );
+
+    remove( filename );
+    return testResult( "ref_lap_test" );
+}
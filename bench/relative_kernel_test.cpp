@@ -0,0 +1,199 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Relative delta kernel test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Checks ir_computeRelatives() (the SSE2 version on x86) against ir_computeRelativesScalar() on
+// random fields, and both against hand-made cases: cars across the start/finish line either way,
+// the pace car, and deltas before the start.
+//
+// Usage: relative_kernel_test [-n iterations]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "../RelativeKernel.h"
+#include "test.h"
+
+static bool sameOutput( const RelativeOutput& a, const RelativeOutput& b )
+{
+    if( a.validMask != b.validMask )
+        return false;
+    if( memcmp(a.lapDelta, b.lapDelta, sizeof(a.lapDelta)) )
+        return false;
+    for( int i=0; i<IR_MAX_CARS; ++i )
+        if( a.delta[i] != b.delta[i] && !(a.delta[i] != a.delta[i] && b.delta[i] != b.delta[i]) )
+            return false;
+    return true;
+}
+
+// Both versions, checked against each other, so every hand-made case covers both
+static void compute( const RelativeInput& in, RelativeOutput& out )
+{
+    RelativeOutput ref;
+    ir_computeRelativesScalar( in, ref );
+    ir_computeRelatives( in, out );
+    CHECK( sameOutput(ref, out) );
+}
+
+int main( int argc, char** argv )
+{
+    int iterations = 100000;
+    for( int i=1; i<argc; ++i )
+    {
+        if( !strcmp(argv[i],"-n") && i+1<argc )
+            iterations = std::max( 1, atoi(argv[++i]) );
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    printf( "Checking the SSE2 kernel against the scalar one, %d random fields\n", iterations );
+#else
+    printf( "No SSE2, ir_computeRelatives() is the scalar kernel\n" );
+#endif
+
+    float estTime[IR_MAX_CARS];
+    float pct[IR_MAX_CARS];
+    int   lap[IR_MAX_CARS];
+
+    RelativeInput in;
+    in.estTime    = estTime;
+    in.lapDistPct = pct;
+    in.lap        = lap;
+
+    // Random fields, including cars out of the world (pct and lap -1) and exact half lap distances
+    srand( 1 );
+    int mismatches = 0;
+    for( int it=0; it<iterations; ++it )
+    {
+        for( int i=0; i<IR_MAX_CARS; ++i )
+        {
+            pct[i]     = rand()%20 ? (rand()%1000)/1000.0f : -1.0f;
+            estTime[i] = pct[i] * 90.0f;
+            lap[i]     = pct[i] < 0 ? -1 : rand()%5;
+        }
+        in.candidateMask    = ((unsigned long long)rand() << 32) ^ ((unsigned long long)rand() << 16) ^ rand();
+        in.zeroLapDeltaMask = 1ULL << (rand()%IR_MAX_CARS);
+        in.zeroLapDeltas    = rand()%4 == 0;
+        in.selfIdx          = rand()%IR_MAX_CARS;
+        in.estLaptime       = 90.0f;
+
+        RelativeOutput ref, out;
+        ir_computeRelativesScalar( in, ref );
+        ir_computeRelatives( in, out );
+        if( !sameOutput(ref, out) )
+            mismatches++;
+    }
+    CHECK( mismatches == 0 );
+
+    // Hand-made field: everyone mid-lap on lap 3, we're car 0
+    for( int i=0; i<IR_MAX_CARS; ++i ) {
+        pct[i]     = 0.5f;
+        estTime[i] = 45.0f;
+        lap[i]     = 3;
+    }
+    in.candidateMask    = ~0ULL;
+    in.zeroLapDeltaMask = 0;
+    in.zeroLapDeltas    = false;
+    in.selfIdx          = 0;
+    in.estLaptime       = 90.0f;
+
+    RelativeOutput out;
+
+    // Same lap, no wrap
+    pct[0] = 0.40f; estTime[0] = 36.0f;
+    pct[1] = 0.45f; estTime[1] = 40.5f;
+    compute( in, out );
+    CHECK_NEAR( out.delta[1], 4.5, 1e-4 );
+    CHECK( out.lapDelta[1] == 0 );
+    CHECK_NEAR( out.delta[0], 0.0, 1e-6 );
+
+    // We're at 95%, car 1 has just crossed the line a lap up on the timing: it's 6.3s ahead on track,
+    // on the same lap as us
+    pct[0] = 0.95f; estTime[0] = 85.5f; lap[0] = 3;
+    pct[1] = 0.02f; estTime[1] = 1.8f;  lap[1] = 4;
+    compute( in, out );
+    CHECK_NEAR( out.delta[1], 6.3, 1e-4 );
+    CHECK( out.lapDelta[1] == 0 );
+
+    // The other way round: we just crossed the line, car 1 is 6.3s behind us
+    pct[0] = 0.02f; estTime[0] = 1.8f;  lap[0] = 4;
+    pct[1] = 0.95f; estTime[1] = 85.5f; lap[1] = 3;
+    compute( in, out );
+    CHECK_NEAR( out.delta[1], -6.3, 1e-4 );
+    CHECK( out.lapDelta[1] == 0 );
+
+    // Car 2 is a lap down behind us across the line, car 3 a lap up ahead of us across the line
+    pct[2] = 0.97f; estTime[2] = 87.3f; lap[2] = 2;
+    pct[3] = 0.10f; estTime[3] = 9.0f;  lap[3] = 5;
+    compute( in, out );
+    CHECK_NEAR( out.delta[2], -4.5, 1e-4 );
+    CHECK( out.lapDelta[2] == -1 );
+    CHECK_NEAR( out.delta[3], 7.2, 1e-4 );
+    CHECK( out.lapDelta[3] == 1 );
+
+    // Pace car (car 4) several laps 'up' on the timing: no lap delta, but its time delta stays
+    pct[4] = 0.20f; estTime[4] = 18.0f; lap[4] = 9;
+    in.zeroLapDeltaMask = 1ULL << 4;
+    compute( in, out );
+    CHECK( out.lapDelta[4] == 0 );
+    CHECK_NEAR( out.delta[4], 16.2, 1e-4 );
+    CHECK( out.lapDelta[3] == 1 );
+
+    // Before the start nobody has a lap delta, wrapped or not
+    in.zeroLapDeltaMask = 0;
+    in.zeroLapDeltas = true;
+    compute( in, out );
+    for( int i=0; i<IR_MAX_CARS; ++i )
+        CHECK( out.lapDelta[i] == 0 );
+    CHECK_NEAR( out.delta[3], 7.2, 1e-4 );
+    in.zeroLapDeltas = false;
+
+    // Cars out of the world or not candidates aren't valid
+    lap[5] = -1; pct[5] = -1.0f;
+    in.candidateMask = ~(1ULL << 6);
+    compute( in, out );
+    CHECK( !((out.validMask >> 5) & 1) );
+    CHECK( !((out.validMask >> 6) & 1) );
+    CHECK( (out.validMask >> 1) & 1 );
+
+    // Matrix rows are the same as computing from that car's point of view
+    {
+        float estLaptime[IR_MAX_CARS];
+        for( int i=0; i<IR_MAX_CARS; ++i )
+            estLaptime[i] = 90.0f;
+        static RelativeMatrix matrix;
+        ir_computeRelativeMatrix( in, estLaptime, (1ULL << 0) | (1ULL << 3), matrix );
+        RelativeInput row3 = in;
+        row3.selfIdx = 3;
+        compute( row3, out );
+        CHECK( sameOutput(matrix.rows[3], out) );
+        CHECK_NEAR( matrix.rows[3].delta[0], -7.2, 1e-4 );
+        CHECK( matrix.rows[3].lapDelta[0] == -1 );
+    }
+
+    return testResult( "relative_kernel_test" );
+}
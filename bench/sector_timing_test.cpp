@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Sector timing test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Three cars in two classes lapping at constant speeds: sector times, bests per car and per
+// class, and what happens when a car slot gets a different driver or a class goes away.
+//
+// Usage: sector_timing_test
+//
+
+#include "../SectorTiming.h"
+#include "test.h"
+
+static Session      s_session;
+static SectorTiming s_timing;
+static float        s_pct[IR_MAX_CARS];
+static bool         s_onPitRoad[IR_MAX_CARS];
+static const unsigned long long ValidMask = 0x7;
+
+// Drive everyone from t0 to t1 at 60Hz, car i doing laps of laptime[i] seconds
+static void drive( double t0, double t1, const float* laptime )
+{
+    for( double t=t0; t<t1; t+=1/60.0 )
+    {
+        for( int i=0; i<3; ++i ) {
+            const double d = t / laptime[i] + 0.01;
+            s_pct[i] = float( d - (int)d );
+        }
+        s_timing.update( t, s_session, s_pct, s_onPitRoad, ValidMask );
+    }
+}
+
+int main()
+{
+    for( int i=0; i<IR_MAX_CARS; ++i )
+        s_pct[i] = -1;
+
+    // Cars 0 and 1 in the slower class, car 2 in the faster one
+    s_session.numClasses = 2;
+    s_session.classes[0].classId = 20;
+    s_session.classes[1].classId = 10;
+    const int classIdx[3] = { 0, 0, 1 };
+    for( int i=0; i<3; ++i ) {
+        s_session.cars[i].userId = 1000 + i;
+        s_session.cars[i].classIdx = classIdx[i];
+    }
+
+    s_timing.setNumSectors( 4 );
+    const float laptime[3] = { 40, 44, 36 };
+    drive( 0, 100, laptime );
+
+    for( int s=0; s<4; ++s )
+    {
+        CHECK_NEAR( s_timing.sectorTime( 0, s ), 10, 0.01 );
+        CHECK_NEAR( s_timing.bestSectorTime( 1, s ), 11, 0.01 );
+        CHECK_NEAR( s_timing.classBestSectorTime( 0, s ), 10, 0.01 );   // not car 2's 9s, that's another class
+        CHECK( s_timing.classBestCarIdx( 0, s ) == 0 );
+        CHECK_NEAR( s_timing.classBestSectorTime( 1, s ), 9, 0.01 );
+        CHECK( s_timing.classBestCarIdx( 1, s ) == 2 );
+    }
+    CHECK( s_timing.classBestSectorTime( -1, 0 ) == 0 );
+    CHECK( s_timing.classBestCarIdx( -1, 0 ) == -1 );
+
+    // Someone else takes over slot 0. Their own times start from scratch, the class best stays
+    // but isn't theirs. Nobody else is affected.
+    s_session.cars[0].userId = 2000;
+    const float laptime2[3] = { 42, 44, 36 };
+    drive( 100, 101, laptime2 );
+    for( int s=0; s<4; ++s )
+    {
+        CHECK( s_timing.bestSectorTime( 0, s ) == 0 );
+        CHECK_NEAR( s_timing.classBestSectorTime( 0, s ), 10, 0.01 );
+        CHECK( s_timing.classBestCarIdx( 0, s ) == -1 );
+        CHECK_NEAR( s_timing.bestSectorTime( 1, s ), 11, 0.01 );
+        CHECK( s_timing.classBestCarIdx( 1, s ) == 2 );
+    }
+
+    drive( 101, 200, laptime2 );
+    for( int s=0; s<4; ++s )
+    {
+        CHECK_NEAR( s_timing.bestSectorTime( 0, s ), 10.5, 0.01 );
+        CHECK_NEAR( s_timing.classBestSectorTime( 0, s ), 10, 0.01 );
+    }
+
+    // A different class in that slot of Session::classes forgets the old class' bests
+    s_session.classes[1].classId = 30;
+    drive( 200, 201, laptime2 );
+    CHECK( s_timing.classBestSectorTime( 1, 0 ) == 0 );
+    CHECK( s_timing.classBestCarIdx( 1, 0 ) == -1 );
+
+    return testResult( "sector_timing_test" );
+}
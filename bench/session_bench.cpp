@@ -0,0 +1,297 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Session string benchmark. Builds on Linux (see Makefile), no iRacing needed.
+//
+// Times the individual parseYaml lookups the session code relies on, and the full session
+// string update as done in ir_tick(), over the synthetic corpus in session_corpus.h and any
+// recorded session strings passed on the command line (session journals written by iRon, or
+// plain text dumps).
+// Reports median and p99 time per update and heap allocations per update.
+//
+// Usage: session_bench [-n iterations] [-s sessionNum] [recorded files...]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../Session.h"
+#include "../SessionJournal.h"
+#include "../irsdk/yaml_parser.h"
+#include "session_corpus.h"
+
+//
+// Allocation counting
+//
+
+static size_t g_numAllocs = 0;
+
+void* operator new( size_t sz )
+{
+    g_numAllocs++;
+    if( void* p = malloc(sz ? sz : 1) )
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+    free( p );
+}
+
+void operator delete( void* p, size_t ) noexcept
+{
+    free( p );
+}
+
+//
+// Parsers under test. Add replacement parsers here to compare them against the current one.
+//
+
+struct SessionParser
+{
+    const char*     name;
+    void            (*parse)( const char* sessionYaml, int sessionNum, Session& session );
+};
+
+static const SessionParser Parsers[] =
+{
+    { "ir_parseSessionStr", ir_parseSessionStr },
+};
+
+//
+// Test inputs
+//
+
+struct BenchInput
+{
+    std::string                 name;
+    int                         sessionNum = 0;
+    std::vector<std::string>    versions;   // consecutive session string updates
+};
+
+static bool loadRecorded( const char* fname, int sessionNum, BenchInput& input )
+{
+    input.name = fname;
+    input.sessionNum = sessionNum;
+
+    // Session journal: replay every version in it
+    if( SessionJournalReader::isJournal(fname) )
+    {
+        SessionJournalReader reader;
+        if( !reader.open(fname) )
+            return false;
+
+        std::string yaml;
+        for( int i=0; i<reader.numVersions(); ++i )
+        {
+            if( !reader.getVersion(i, yaml) )
+                return false;
+            input.versions.push_back( yaml );
+        }
+        input.sessionNum = reader.entry( reader.numVersions()-1 ).sessionNum;
+        return true;
+    }
+
+    std::string data;
+    FILE* fp = fopen( fname, "rb" );
+    if( !fp )
+        return false;
+    char buf[64*1024];
+    size_t n;
+    while( (n = fread(buf,1,sizeof(buf),fp)) > 0 )
+        data.append( buf, n );
+    fclose( fp );
+
+    // Debug dumps contain many versions, separated by a marker line
+    const char* marker = "==== NEW SESSION STRING";
+    size_t pos = data.find( marker );
+    if( pos == std::string::npos )
+    {
+        input.versions.push_back( data );
+    }
+    else
+    {
+        while( pos != std::string::npos )
+        {
+            const size_t start = data.find( '\n', pos );
+            if( start == std::string::npos )
+                break;
+            const size_t next = data.find( marker, start );
+            input.versions.push_back( data.substr(start+1, next==std::string::npos ? std::string::npos : next-start-1) );
+            pos = next;
+        }
+    }
+
+    return !input.versions.empty();
+}
+
+//
+// Measurement
+//
+
+struct Stats
+{
+    double  medianUs = 0;
+    double  p99Us = 0;
+    double  allocsPerUpdate = 0;
+};
+
+static Stats computeStats( std::vector<double>& samples, size_t allocs )
+{
+    Stats st;
+    if( samples.empty() )
+        return st;
+    std::sort( samples.begin(), samples.end() );
+    st.medianUs = samples[samples.size()/2];
+    st.p99Us = samples[std::min(samples.size()-1, (size_t)(samples.size()*0.99))];
+    st.allocsPerUpdate = (double)allocs / (double)samples.size();
+    return st;
+}
+
+// Runs 'fn' up to 'iterations' times, but stops early once a few samples have been taken
+// and the time budget is used up, so the 1 MB inputs don't take forever.
+template<typename F>
+static Stats measure( int iterations, F fn )
+{
+    const double budgetUs = 2e6;
+    const int    minSamples = 5;
+
+    std::vector<double> samples;
+    samples.reserve( iterations );
+
+    size_t allocs = 0;
+    double totalUs = 0;
+    for( int i=0; i<iterations && (i<minSamples || totalUs<budgetUs); ++i )
+    {
+        const size_t allocsBefore = g_numAllocs;
+        const auto t0 = std::chrono::steady_clock::now();
+        fn( i );
+        const auto t1 = std::chrono::steady_clock::now();
+        allocs += g_numAllocs - allocsBefore;
+        samples.push_back( std::chrono::duration<double,std::micro>(t1-t0).count() );
+        totalUs += samples.back();
+    }
+
+    return computeStats( samples, allocs );
+}
+
+static volatile int g_sink = 0;
+
+static void benchInput( const BenchInput& input, int iterations )
+{
+    const size_t bytes = input.versions[0].size();
+
+    // Individual lookups: one near the top, one in the driver list, one deep in the results.
+    static const char* const lookups[] =
+    {
+        "WeekendInfo:SubSessionID:",
+        "DriverInfo:DriverCarIdx:",
+        "DriverInfo:Drivers:CarIdx:{20}UserName:",
+        "SessionInfo:Sessions:SessionNum:{0}ResultsPositions:Position:{20}CarIdx:",
+    };
+    for( const char* path : lookups )
+    {
+        const char* yaml = input.versions[0].c_str();
+        const Stats st = measure( iterations, [&]( int ) {
+            const char* val = nullptr;
+            int len = 0;
+            g_sink += parseYaml( yaml, path, &val, &len ) ? len : 0;
+        } );
+        printf( "%-36s %5zu KB  lookup %-72s median %9.1f us  p99 %9.1f us\n", input.name.c_str(), bytes/1024, path, st.medianUs, st.p99Us );
+    }
+
+    // The hash ir_tick() uses to skip updates that don't change anything we parse
+    {
+        const std::string& yaml = input.versions[0];
+        const Stats st = measure( iterations, [&]( int ) {
+            g_sink += (int)ir_hashSessionStr( yaml.c_str(), (int)yaml.size(), input.sessionNum );
+        } );
+        printf( "%-36s %5zu KB  hash   %-72s median %9.1f us  p99 %9.1f us\n", input.name.c_str(), bytes/1024, "ir_hashSessionStr", st.medianUs, st.p99Us );
+    }
+
+    // Full session update, cycling through all versions. The Session is kept across updates, like ir_session.
+    for( const SessionParser& parser : Parsers )
+    {
+        Session* session = new Session();
+        parser.parse( input.versions[0].c_str(), input.sessionNum, *session );   // warm up, pool grows to size here
+
+        const Stats st = measure( iterations, [&]( int i ) {
+            const std::string& yaml = input.versions[i % input.versions.size()];
+            parser.parse( yaml.c_str(), input.sessionNum, *session );
+        } );
+        printf( "%-36s %5zu KB  update %-72s median %9.1f us  p99 %9.1f us  allocs/update %.1f\n", input.name.c_str(), bytes/1024, parser.name, st.medianUs, st.p99Us, st.allocsPerUpdate );
+        delete session;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    int iterations = 100;
+    int sessionNum = 0;
+    std::vector<BenchInput> inputs;
+
+    for( int i=1; i<argc; ++i )
+    {
+        if( !strcmp(argv[i],"-n") && i+1<argc )
+            iterations = std::max( 1, atoi(argv[++i]) );
+        else if( !strcmp(argv[i],"-s") && i+1<argc )
+            sessionNum = atoi( argv[++i] );
+        else
+        {
+            BenchInput input;
+            if( loadRecorded(argv[i], sessionNum, input) )
+                inputs.push_back( input );
+            else
+                printf( "WARNING: could not load %s\n", argv[i] );
+        }
+    }
+
+    // Synthetic corpus, unless we were given recorded strings
+    if( inputs.empty() )
+    {
+        const int numVersions = 8;
+        for( const CorpusSpec& spec : makeCorpusSpecs() )
+        {
+            BenchInput input;
+            input.name = spec.name;
+            input.sessionNum = spec.sessionNum;
+            for( int v=0; v<numVersions; ++v )
+                input.versions.push_back( makeSessionStr(spec, v) );
+            inputs.push_back( input );
+        }
+    }
+
+    printf( "Session string benchmark, %d iterations per measurement\n\n", iterations );
+    for( const BenchInput& input : inputs )
+        benchInput( input, iterations );
+
+    return g_sink == 0x7fffffff;
+}
@@ -0,0 +1,446 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+//
+// Synthetic, but real-shaped, session strings for benchmarking the session string handling.
+//
+// The layout and key names follow what iRacing actually sends (WeekendInfo, SessionInfo with
+// ResultsPositions, QualifyResultsInfo, CameraInfo, RadioInfo, DriverInfo, SplitTimeInfo,
+// CarSetup), so parseYaml has to walk the same kind of structure as it does live.
+// Everything is deterministic, so numbers are comparable between runs.
+//
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <vector>
+
+struct CorpusSpec
+{
+    std::string     name;
+    int             numDrivers = 20;    // not counting the pace car
+    int             numClasses = 1;
+    int             sessionNum = 0;     // 0=practice, 1=qualify, 2=race
+    bool            withResults = true;
+    int             targetBytes = 0;    // pad with camera groups up to this size; 0 means no padding
+};
+
+class CorpusWriter
+{
+    public:
+
+        void line( const char* fmt, ... )
+        {
+            char s[512];
+            va_list args;
+            va_start( args, fmt );
+            vsnprintf( s, sizeof(s), fmt, args );
+            va_end( args );
+            m_str += s;
+            m_str += '\n';
+        }
+
+        size_t size() const { return m_str.size(); }
+        std::string& str() { return m_str; }
+
+    private:
+
+        std::string m_str;
+};
+
+static const char* const CorpusFirstNames[] = { "Max","Lewis","Sebastian","Fernando","Kimi","Charles","Lando","George","Oscar","Yuki","Pierre","Esteban","Valtteri","Zhou","Kevin","Nico","Logan","Alex","Daniel","Carlos" };
+static const char* const CorpusLastNames[]  = { "Verstappen","Hamilton","Vettel","Alonso","Raikkonen","Leclerc","Norris","Russell","Piastri","Tsunoda","Gasly","Ocon","Bottas","Guanyu","Magnussen","Hulkenberg","Sargeant","Albon","Ricciardo","Sainz" };
+static const char* const CorpusClassNames[] = { "GT3 Class","GT4 Class","LMP2","TCR" };
+static const char* const CorpusClassColors[]= { "0xffda59","0x33ceff","0xff5888","0xae6bff" };
+static const char* const CorpusLicColors[]  = { "0x0153db","0x00c702","0xfeec04","0xfc8a27","0xfc0706" };
+static const char* const CorpusSessionNames[]= { "PRACTICE","QUALIFY","RACE" };
+
+// 'update' perturbs the parts of the string that change during a session (results, incident counts),
+// so consecutive values give consecutive session string versions.
+inline std::string makeSessionStr( const CorpusSpec& spec, int update=0 )
+{
+    CorpusWriter w;
+    const int numCars = spec.numDrivers + 1;    // carIdx 0 is the pace car
+    const int selfIdx = numCars / 2;
+
+    w.line( "---" );
+    w.line( "WeekendInfo:" );
+    w.line( " TrackName: spa 2022 gp" );
+    w.line( " TrackID: 525" );
+    w.line( " TrackLength: 6.9300 km" );
+    w.line( " TrackLengthOfficial: 7.00 km" );
+    w.line( " TrackDisplayName: Circuit de Spa-Francorchamps" );
+    w.line( " TrackDisplayShortName: Spa" );
+    w.line( " TrackConfigName: Grand Prix Pits" );
+    w.line( " TrackCity: Stavelot" );
+    w.line( " TrackCountry: Belgium" );
+    w.line( " TrackAltitude: 401.85 m" );
+    w.line( " TrackLatitude: 50.437050 m" );
+    w.line( " TrackLongitude: 5.964370 m" );
+    w.line( " TrackNorthOffset: 5.3480 rad" );
+    w.line( " TrackNumTurns: 20" );
+    w.line( " TrackPitSpeedLimit: 60.00 kph" );
+    w.line( " TrackType: road course" );
+    w.line( " TrackDirection: neutral" );
+    w.line( " TrackWeatherType: Realistic" );
+    w.line( " TrackSkies: Partly Cloudy" );
+    w.line( " TrackSurfaceTemp: 31.11 C" );
+    w.line( " TrackAirTemp: 21.67 C" );
+    w.line( " TrackAirPressure: 28.69 Hg" );
+    w.line( " TrackWindVel: 2.24 m/s" );
+    w.line( " TrackWindDir: 4.71 rad" );
+    w.line( " TrackRelativeHumidity: 55 %%" );
+    w.line( " TrackFogLevel: 0 %%" );
+    w.line( " TrackCleanup: 0" );
+    w.line( " TrackDynamicTrack: 1" );
+    w.line( " TrackVersion: 2022.06.07.01" );
+    w.line( " SeriesID: 231" );
+    w.line( " SeasonID: 3815" );
+    w.line( " SessionID: 190000000" );
+    w.line( " SubSessionID: 51234567" );
+    w.line( " LeagueID: 0" );
+    w.line( " Official: 1" );
+    w.line( " RaceWeek: 4" );
+    w.line( " EventType: Race" );
+    w.line( " Category: Road" );
+    w.line( " SimMode: full" );
+    w.line( " TeamRacing: 0" );
+    w.line( " MinDrivers: 0" );
+    w.line( " MaxDrivers: 0" );
+    w.line( " DCRuleSet: None" );
+    w.line( " QualifierMustStartRace: 0" );
+    w.line( " NumCarClasses: %d", spec.numClasses );
+    w.line( " NumCarTypes: %d", spec.numClasses );
+    w.line( " HeatRacing: 0" );
+    w.line( " BuildType: Release" );
+    w.line( " BuildTarget: Members" );
+    w.line( " BuildVersion: 2022.06.21.01" );
+    w.line( " WeekendOptions:" );
+    w.line( "  NumStarters: %d", spec.numDrivers );
+    w.line( "  StartingGrid: single file" );
+    w.line( "  QualifyScoring: best lap" );
+    w.line( "  CourseCautions: local" );
+    w.line( "  StandingStart: 0" );
+    w.line( "  ShortParadeLap: 0" );
+    w.line( "  Restarts: single file" );
+    w.line( "  WeatherType: Realistic" );
+    w.line( "  Skies: Partly Cloudy" );
+    w.line( "  WindDirection: W" );
+    w.line( "  WindSpeed: 8.05 km/h" );
+    w.line( "  WeatherTemp: 21.67 C" );
+    w.line( "  RelativeHumidity: 55 %%" );
+    w.line( "  FogLevel: 0 %%" );
+    w.line( "  TimeOfDay: 1:00 pm" );
+    w.line( "  Date: 2022-07-02" );
+    w.line( "  EarthRotationSpeedupFactor: 1" );
+    w.line( "  Unofficial: 0" );
+    w.line( "  CommercialMode: consumer" );
+    w.line( "  NightMode: variable" );
+    w.line( "  IsFixedSetup: 1" );
+    w.line( "  StrictLapsChecking: default" );
+    w.line( "  HasOpenRegistration: 0" );
+    w.line( "  HardcoreLevel: 1" );
+    w.line( "  NumJokerLaps: 0" );
+    w.line( "  IncidentLimit: 17" );
+    w.line( "  FastRepairsLimit: 1" );
+    w.line( "  GreenWhiteCheckeredLimit: 0" );
+    w.line( " TelemetryOptions:" );
+    w.line( "  TelemetryDiskFile: \"\"" );
+    w.line( "" );
+
+    w.line( "SessionInfo:" );
+    w.line( " Sessions:" );
+    for( int num=0; num<=spec.sessionNum; ++num )
+    {
+        const bool isRace = num == 2;
+        w.line( " - SessionNum: %d", num );
+        w.line( "   SessionLaps: unlimited" );
+        w.line( "   SessionTime: %s", isRace ? "2400.0000 sec" : "900.0000 sec" );
+        w.line( "   SessionNumLapsToAvg: 0" );
+        w.line( "   SessionType: %s", num==0 ? "Practice" : (num==1 ? "Lone Qualify" : "Race") );
+        w.line( "   SessionTrackRubberState: moderate usage" );
+        w.line( "   SessionName: %s", CorpusSessionNames[num] );
+        w.line( "   SessionSubType: " );
+        w.line( "   SessionSkipped: 0" );
+        w.line( "   SessionRunGroupsUsed: 0" );
+        w.line( "   SessionEnforceTireCompoundChange: 0" );
+        if( !spec.withResults || (num==spec.sessionNum && num==2 && update==0) )
+        {
+            w.line( "   ResultsPositions: " );
+        }
+        else
+        {
+            w.line( "   ResultsPositions:" );
+            const int laps = num==spec.sessionNum ? 1 + update : 8;
+            for( int pos=1; pos<=spec.numDrivers; ++pos )
+            {
+                // Rotate the finishing order a bit between sessions and updates
+                const int carIdx = 1 + (pos - 1 + num*3 + (num==spec.sessionNum ? update/4 : 0)) % spec.numDrivers;
+                const float best = 137.0f + pos*0.173f + num*0.05f;
+                w.line( "   - Position: %d", pos );
+                w.line( "     ClassPosition: %d", (pos-1) / spec.numClasses );
+                w.line( "     CarIdx: %d", carIdx );
+                w.line( "     Lap: %d", laps );
+                w.line( "     Time: %.4f", isRace ? laps*139.0f + pos*1.7f : best );
+                w.line( "     FastestLap: %d", 1 + pos % laps );
+                w.line( "     FastestTime: %.4f", best );
+                w.line( "     LastTime: %.4f", best + 0.4f + (pos+update)%7 * 0.11f );
+                w.line( "     LapsLed: %d", pos==1 ? laps : 0 );
+                w.line( "     LapsComplete: %d", laps - (pos > spec.numDrivers-2 ? 1 : 0) );
+                w.line( "     JokerLapsComplete: 0" );
+                w.line( "     LapsDriven: %.3f", (float)laps );
+                w.line( "     Incidents: %d", (carIdx*7 + update) % 9 );
+                w.line( "     ReasonOutId: 0" );
+                w.line( "     ReasonOutStr: Running" );
+            }
+        }
+        w.line( "   ResultsFastestLap:" );
+        w.line( "   - CarIdx: %d", spec.withResults ? 1 : 255 );
+        w.line( "     FastestLap: 0" );
+        w.line( "     FastestTime: %.4f", spec.withResults ? 137.173f : -1.0f );
+        w.line( "   ResultsAverageLapTime: -1.0000" );
+        w.line( "   ResultsNumCautionFlags: 0" );
+        w.line( "   ResultsNumCautionLaps: 0" );
+        w.line( "   ResultsNumLeadChanges: 0" );
+        w.line( "   ResultsLapsComplete: -1" );
+        w.line( "   ResultsOfficial: 0" );
+    }
+    w.line( "" );
+
+    if( spec.withResults && spec.sessionNum >= 1 )
+    {
+        w.line( "QualifyResultsInfo:" );
+        w.line( " Results:" );
+        for( int pos=0; pos<spec.numDrivers; ++pos )
+        {
+            w.line( " - Position: %d", pos );
+            w.line( "   ClassPosition: %d", pos / spec.numClasses );
+            w.line( "   CarIdx: %d", 1 + (pos+3) % spec.numDrivers );
+            w.line( "   FastestLap: 2" );
+            w.line( "   FastestTime: %.4f", 136.5f + pos*0.2f );
+        }
+        w.line( "" );
+    }
+
+    w.line( "CameraInfo:" );
+    w.line( " Groups:" );
+    static const char* const camGroups[] = { "Nose","Gearbox","Roll Bar","LF Susp","LR Susp","Gyro","RF Susp","RR Susp","Cockpit","Blimp","Chopper","Chase","Far Chase","Rear Chase","TV1","TV2","TV3","Pit Lane","Pit Lane 2","Scenic" };
+    const int numCamGroups = sizeof(camGroups)/sizeof(camGroups[0]);
+    for( int g=0; g<numCamGroups || (spec.targetBytes && w.size() < (size_t)spec.targetBytes - 8*1024); ++g )
+    {
+        w.line( " - GroupNum: %d", g+1 );
+        w.line( "   GroupName: %s%s", camGroups[g % numCamGroups], g>=numCamGroups ? " Alt" : "" );
+        w.line( "   Cameras:" );
+        for( int c=0; c<(g%numCamGroups < 14 ? 1 : 8); ++c )
+        {
+            w.line( "   - CameraNum: %d", c+1 );
+            w.line( "     CameraName: Cam%s%02d", camGroups[g % numCamGroups], c );
+        }
+    }
+    w.line( "" );
+
+    w.line( "RadioInfo:" );
+    w.line( " SelectedRadioNum: 0" );
+    w.line( " Radios:" );
+    w.line( " - RadioNum: 0" );
+    w.line( "   HopCount: 2" );
+    w.line( "   NumFrequencies: 7" );
+    w.line( "   TunedToFrequencyNum: 0" );
+    w.line( "   ScanningIsOn: 1" );
+    w.line( "   Frequencies:" );
+    static const char* const freqs[] = { "@ALLTEAMS","@DRIVERS","@RACECONTROL","@CLUB","@ADMIN","@PRIVATE","@TEAM" };
+    for( int f=0; f<7; ++f )
+    {
+        w.line( "   - FrequencyNum: %d", f );
+        w.line( "     FrequencyName: \"%s\"", freqs[f] );
+        w.line( "     Priority: %d", 12 + f*10 );
+        w.line( "     CarIdx: -1" );
+        w.line( "     EntryIdx: -1" );
+        w.line( "     ClubID: 0" );
+        w.line( "     CanScan: 1" );
+        w.line( "     CanSquawk: 1" );
+        w.line( "     Muted: 0" );
+        w.line( "     IsMutable: 1" );
+        w.line( "     IsDeletable: 0" );
+    }
+    w.line( "" );
+
+    w.line( "DriverInfo:" );
+    w.line( " DriverCarIdx: %d", selfIdx );
+    w.line( " DriverUserID: 123456" );
+    w.line( " PaceCarIdx: 0" );
+    w.line( " DriverHeadPosX: -0.094" );
+    w.line( " DriverHeadPosY: 0.370" );
+    w.line( " DriverHeadPosZ: 0.645" );
+    w.line( " DriverCarIdleRPM: 900.000" );
+    w.line( " DriverCarRedLine: 8500.000" );
+    w.line( " DriverCarEngCylinderCount: 6" );
+    w.line( " DriverCarFuelKgPerLtr: 0.750" );
+    w.line( " DriverCarFuelMaxLtr: 120.000" );
+    w.line( " DriverCarMaxFuelPct: 1.000" );
+    w.line( " DriverCarGearNumForward: 6" );
+    w.line( " DriverCarGearNeutral: 1" );
+    w.line( " DriverCarGearReverse: 1" );
+    w.line( " DriverCarSLFirstRPM: 7250.000" );
+    w.line( " DriverCarSLShiftRPM: 8000.000" );
+    w.line( " DriverCarSLLastRPM: 8250.000" );
+    w.line( " DriverCarSLBlinkRPM: 8400.000" );
+    w.line( " DriverCarVersion: 2022.06.21.01" );
+    w.line( " DriverPitTrkPct: 0.962134" );
+    w.line( " DriverCarEstLapTime: 137.1234" );
+    w.line( " DriverSetupName: fixed.sto" );
+    w.line( " DriverSetupIsModified: 0" );
+    w.line( " DriverSetupLoadTypeName: fixed" );
+    w.line( " DriverSetupPassedTech: 1" );
+    w.line( " DriverIncidentCount: %d", update % 5 );
+    w.line( " Drivers:" );
+    for( int carIdx=0; carIdx<numCars; ++carIdx )
+    {
+        const bool isPace = carIdx == 0;
+        const int  cls    = isPace ? 0 : (carIdx-1) % spec.numClasses;
+        char name[64];
+        if( isPace )
+            snprintf( name, sizeof(name), "Pace Car" );
+        else
+            snprintf( name, sizeof(name), "%s %s%s", CorpusFirstNames[carIdx % 20], CorpusLastNames[(carIdx*7) % 20], carIdx>=20 ? "2" : "" );
+
+        w.line( " - CarIdx: %d", carIdx );
+        w.line( "   UserName: %s", name );
+        w.line( "   AbbrevName: " );
+        w.line( "   Initials: " );
+        w.line( "   UserID: %d", isPace ? -1 : 100000 + carIdx*3119 );
+        w.line( "   TeamID: 0" );
+        w.line( "   TeamName: %s", name );
+        w.line( "   CarNumber: \"%d\"", isPace ? 0 : carIdx*3 );
+        w.line( "   CarNumberRaw: %d", isPace ? 0 : carIdx*3 );
+        w.line( "   CarPath: %s", isPace ? "safety pcporsche911cup" : "porsche911rgt3" );
+        w.line( "   CarClassID: %d", isPace ? 11 : 2700 + cls );
+        w.line( "   CarID: %d", isPace ? 120 : 169 + cls );
+        w.line( "   CarIsPaceCar: %d", isPace ? 1 : 0 );
+        w.line( "   CarIsAI: 0" );
+        w.line( "   CarScreenName: %s", isPace ? "safety pcporsche911cup" : "Porsche 911 GT3 R" );
+        w.line( "   CarScreenNameShort: %s", isPace ? "safety pcporsche911cup" : "Porsche 911 GT3 R" );
+        w.line( "   CarClassShortName: %s", isPace ? "" : CorpusClassNames[cls % 4] );
+        w.line( "   CarClassRelSpeed: %d", isPace ? 0 : 100 - cls*10 );
+        w.line( "   CarClassLicenseLevel: 0" );
+        w.line( "   CarClassMaxFuelPct: 1.000 %%" );
+        w.line( "   CarClassWeightPenalty: 0.000 kg" );
+        w.line( "   CarClassPowerAdjust: 0.000 %%" );
+        w.line( "   CarClassDryTireSetLimit: 0 %%" );
+        w.line( "   CarClassColor: %s", isPace ? "0xffffff" : CorpusClassColors[cls % 4] );
+        w.line( "   CarClassEstLapTime: %.4f", 137.1234f + cls*6.5f );
+        w.line( "   IRating: %d", isPace ? 0 : 1000 + (carIdx*379) % 4000 );
+        w.line( "   LicLevel: %d", isPace ? 1 : 5 + carIdx % 15 );
+        w.line( "   LicSubLevel: %d", isPace ? 1 : 100 + (carIdx*37) % 399 );
+        w.line( "   LicString: %c %.2f", isPace ? 'R' : "DCBAP"[carIdx % 5], isPace ? 0.01f : 1.0f + (carIdx*37 % 399)/100.0f );
+        w.line( "   LicColor: %s", isPace ? "0xundefined" : CorpusLicColors[carIdx % 5] );
+        w.line( "   IsSpectator: 0" );
+        w.line( "   CarDesignStr: 1,ff0000,000000,ffffff" );
+        w.line( "   HelmetDesignStr: 20,ffffff,000000,ff0000" );
+        w.line( "   SuitDesignStr: 11,ffffff,ff0000,000000" );
+        w.line( "   CarNumberDesignStr: 0,0,ffffff,777777,000000" );
+        w.line( "   CarSponsor_1: %d", carIdx % 40 );
+        w.line( "   CarSponsor_2: %d", (carIdx*3) % 40 );
+        w.line( "   CurDriverIncidentCount: %d", isPace ? 0 : (carIdx*7 + update) % 9 );
+        w.line( "   TeamIncidentCount: %d", isPace ? 0 : (carIdx*7 + update) % 9 );
+    }
+    w.line( "" );
+
+    w.line( "SplitTimeInfo:" );
+    w.line( " Sectors:" );
+    for( int s=0; s<7; ++s )
+    {
+        w.line( " - SectorNum: %d", s );
+        w.line( "   SectorStartPct: %.6f", s/7.0f );
+    }
+    w.line( "" );
+
+    w.line( "CarSetup:" );
+    w.line( " UpdateCount: 1" );
+    static const char* const corners[] = { "LeftFront","LeftRear","RightFront","RightRear" };
+    w.line( " Tires:" );
+    for( int c=0; c<4; ++c )
+    {
+        w.line( "  %s:", corners[c] );
+        w.line( "   StartingPressure: 165.0 kPa" );
+        w.line( "   LastHotPressure: 165.0 kPa" );
+        w.line( "   LastTempsOMI: 35C, 35C, 35C" );
+        w.line( "   TreadRemaining: 100%%, 100%%, 100%%" );
+    }
+    w.line( " Chassis:" );
+    w.line( "  Front:" );
+    w.line( "   ArbSetting: 3" );
+    w.line( "   ToeIn: -1.0 mm" );
+    w.line( "   FuelLevel: 60.0 L" );
+    w.line( "   CrossWeight: 50.0%%" );
+    w.line( "" );
+
+    return w.str();
+}
+
+// The standard set of session strings the benchmark runs over: all three session types,
+// small to full fields, single- and multi-class, with and without results, ~20 KB to ~1 MB.
+inline std::vector<CorpusSpec> makeCorpusSpecs()
+{
+    std::vector<CorpusSpec> specs;
+
+    const int driverCounts[] = { 20, 40, 63 };
+    const int sizes[]        = { 0, 256*1024, 1024*1024 };
+
+    for( int sessionNum=0; sessionNum<3; ++sessionNum )
+    {
+        for( int numDrivers : driverCounts )
+        {
+            for( int numClasses=1; numClasses<=3; numClasses+=2 )
+            {
+                for( int withResults=0; withResults<2; ++withResults )
+                {
+                    for( int targetBytes : sizes )
+                    {
+                        // Keep the matrix reasonable: only pad the full-results variants
+                        if( targetBytes && !withResults )
+                            continue;
+
+                        CorpusSpec spec;
+                        spec.numDrivers  = numDrivers;
+                        spec.numClasses  = numClasses;
+                        spec.sessionNum  = sessionNum;
+                        spec.withResults = withResults != 0;
+                        spec.targetBytes = targetBytes;
+
+                        char name[128];
+                        snprintf( name, sizeof(name), "%s-%dcars-%dcls-%s%s", CorpusSessionNames[sessionNum], numDrivers, numClasses, withResults?"results":"noresults",
+                            targetBytes ? (targetBytes>=1024*1024 ? "-1mb" : "-256kb") : "" );
+                        spec.name = name;
+                        specs.push_back( spec );
+                    }
+                }
+            }
+        }
+    }
+
+    return specs;
+}
@@ -0,0 +1,61 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+//
+// Minimal checks for the engine tests in this directory. Builds on Linux (see Makefile), no
+// iRacing needed. A failed check prints where and what, and makes the test exit non-zero.
+//
+
+#include <stdio.h>
+#include <math.h>
+
+static int g_testChecks   = 0;
+static int g_testFailures = 0;
+
+#define CHECK( cond ) \
+    do { \
+        g_testChecks++; \
+        if( !(cond) ) { \
+            g_testFailures++; \
+            printf( "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond ); \
+        } \
+    } while( 0 )
+
+#define CHECK_NEAR( a, b, tol ) \
+    do { \
+        g_testChecks++; \
+        const double va_ = (a), vb_ = (b); \
+        if( !(fabs(va_-vb_) <= (tol)) ) { \
+            g_testFailures++; \
+            printf( "%s:%d: CHECK_NEAR failed: %s = %g, %s = %g, tolerance %g\n", __FILE__, __LINE__, #a, va_, #b, vb_, (double)(tol) ); \
+        } \
+    } while( 0 )
+
+static int testResult( const char* name )
+{
+    printf( "%s: %d checks, %d failed\n", name, g_testChecks, g_testFailures );
+    return g_testFailures ? 1 : 0;
+}
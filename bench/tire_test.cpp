@@ -0,0 +1,156 @@
+/*
+MIT License
+
+Copyright (c) 2021-2022 L. E. Spalt
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// Tire model test. Builds on Linux (see Makefile), no iRacing needed.
+//
+// A race with several stops, sampled the way ir_tick() does it: once per lap, on arriving in the pit
+// stall and on leaving it. Like in iRacing, the wear readings only change in the stall, to the worn
+// set on arrival and to the new one once serviced.
+//
+// Usage: tire_test
+//
+
+#include "../TireModel.h"
+#include "test.h"
+
+struct Car
+{
+    TireModel   model;
+    TireSample  reading;        // what the sim reports right now
+    float       tread[4] = { 1, 1, 1, 1 };  // what's actually left
+    float       rate[4] = {};   // tread lost per lap
+    int         lap = 0;
+    bool        inPitStall = false;
+
+    int         prevLap = 0;
+    bool        prevInPitStall = false;
+
+    void tick()
+    {
+        reading.lap = lap;
+        if( lap != prevLap || inPitStall != prevInPitStall )
+            model.addSample( reading );
+        prevLap = lap;
+        prevInPitStall = inPitStall;
+    }
+
+    void driveTo( int toLap )
+    {
+        while( lap < toLap )
+        {
+            for( int i=0; i<4; ++i )
+                tread[i] -= rate[i];
+            lap++;
+            tick();
+        }
+    }
+
+    void pit( bool newTires )
+    {
+        inPitStall = true;
+        for( int i=0; i<4; ++i )
+            reading.wear[i] = tread[i];
+        tick();
+
+        if( newTires )
+            for( int i=0; i<4; ++i )
+                reading.wear[i] = tread[i] = 1;
+        inPitStall = false;
+        tick();
+    }
+};
+
+int main()
+{
+    Car car;
+    for( int i=0; i<4; ++i )
+        car.reading.wear[i] = 1;
+    car.reading.carcassTemp[0] = 80;
+    car.rate[TireModel::LF] = car.rate[TireModel::RF] = car.rate[TireModel::LR] = 0.02f;
+    car.rate[TireModel::RR] = 0.03f;
+
+    // Off the grid on new tires. Nothing to go on until the first stop.
+    car.lap = 1;
+    car.tick();
+    car.driveTo( 10 );
+    CHECK( car.model.wearPerLap( TireModel::LF ) == 0 );
+    CHECK( car.model.thresholdLap( TireModel::LF, 0.3f ) == -1 );
+
+    // Stop after lap 10: the worn set is seen on arrival, before it's replaced
+    car.pit( true );
+    CHECK_NEAR( car.model.wearPerLap( TireModel::LF ), 0.02, 1e-5 );   // 1.0 on lap 1 to 0.82 on lap 10
+    CHECK_NEAR( car.model.wearPerLap( TireModel::RR ), 0.03, 1e-5 );
+    CHECK( car.model.stintStartLap( TireModel::LF ) == 10 );
+
+    // The new set goes by the previous stint's rate until the next stop
+    car.rate[TireModel::LF] = 0.37f / 15;
+    car.driveTo( 15 );
+    CHECK( car.model.thresholdLap( TireModel::LF, 0.31f ) == 45 );      // 10 + 0.69 / 0.02, rounded up
+    CHECK( car.model.thresholdLap( TireModel::RR, 0.3f ) == 34 );       // 10 + 0.7 / 0.03
+
+    // Second stop after lap 25, LF down to 0.63
+    car.driveTo( 25 );
+    car.inPitStall = true;
+    for( int i=0; i<4; ++i )
+        car.reading.wear[i] = car.tread[i];
+    car.tick();
+    CHECK_NEAR( car.reading.wear[TireModel::LF], 0.63, 1e-4 );
+    CHECK_NEAR( car.model.wearPerLap( TireModel::LF ), 0.37/15, 1e-5 );
+    CHECK( car.model.thresholdLap( TireModel::LF, 0.3f ) == 39 );       // 25 + 0.33 / (0.37/15), rounded up
+    for( int i=0; i<4; ++i )
+        car.reading.wear[i] = car.tread[i] = 1;
+    car.inPitStall = false;
+    car.tick();
+    CHECK( car.model.stintStartLap( TireModel::LF ) == 25 );
+    CHECK_NEAR( car.model.wearPerLap( TireModel::LF ), 0.37/15, 1e-5 );
+
+    // Fuel only after lap 35: the stint carries on, now with a rate of its own
+    car.rate[TireModel::LF] = 0.025f;
+    car.driveTo( 35 );
+    car.pit( false );
+    CHECK( car.model.stintStartLap( TireModel::LF ) == 25 );
+    CHECK_NEAR( car.model.wearPerLap( TireModel::LF ), 0.025, 1e-5 );
+    CHECK_NEAR( car.model.wearAt( TireModel::LF, 40 ), 0.625, 1e-4 );
+    CHECK( car.model.thresholdLap( TireModel::LF, 0.31f ) == 53 );      // 35 + 0.44 / 0.025
+
+    // Sampling only at pit exit, the worn sets are never seen and there's nothing to go on
+    {
+        Car late;
+        for( int i=0; i<4; ++i ) {
+            late.reading.wear[i] = 1;
+            late.rate[i] = 0.02f;
+        }
+        late.lap = 1;
+        late.tick();
+        late.driveTo( 10 );
+        for( int i=0; i<4; ++i )
+            late.reading.wear[i] = late.tread[i] = 1;
+        late.model.addSample( late.reading );
+        late.driveTo( 20 );
+        CHECK( late.model.wearPerLap( TireModel::LF ) == 0 );
+    }
+
+    return testResult( "tire_test" );
+}
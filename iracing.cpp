@@ -22,8 +22,11 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <chrono>
 #include "iracing.h"
 #include "Config.h"
+#include "SessionJournal.h"
+#include "IbtReader.h"
 
 irsdkCVar ir_SessionTime("SessionTime");    // double[1] Seconds since session start (s)
 irsdkCVar ir_SessionTick("SessionTick");    // int[1] Current update number ()
@@ -318,242 +321,401 @@ irsdkCVar ir_LFSHshockVel_ST("LFSHshockVel_ST");    // float[6] LFSH shock veloc
 
 Session ir_session;
 
-static bool parseYamlInt(const char *yamlStr, const char *path, int *dest)
-{
-    int count = 0;
-    const char *s = nullptr;
+int ir_sessionUpdatesReceived = 0;
+int ir_sessionUpdatesProcessed = 0;
 
-    if( parseYaml(yamlStr, path, &s, &count) )
-    {
-        *dest = atoi( s );
-        return true;
-    }
+int ir_sessionTornCopies = 0;
 
-    return false;
-}
+static unsigned long long s_sessionHash = 0;
+static SessionJournal     s_sessionJournal;
+static std::vector<char>  s_sessionStr;     // private copy of the session string, see copySessionStr()
+static int                s_sessionCt = -1;         // update counter of s_sessionStr
+static int                s_sessionStatusId = -1;   // irsdkClient connection s_sessionCt belongs to
 
-static bool parseYamlFloat(const char *yamlStr, const char *path, float *dest)
+// The session string lives in shared memory that the sim can rewrite at any time, so rather than
+// running all the parsing on it in place, copy it out once. If the update counter changed while we
+// were copying, the copy may be torn; try again. If that keeps happening, give up for this tick.
+// Only a good copy updates s_sessionCt, so the next tick retries. (irsdkClient::wasSessionStrUpdated()
+// can't be used for that: getSessionStr() marks the string as seen even when our copy was torn.)
+static bool copySessionStr( irsdkClient& irsdk )
 {
-    int count = 0;
-    const char *s = nullptr;
+    const int maxAttempts = 3;
 
-    if( parseYaml(yamlStr, path, &s, &count) )
+    for( int attempt=0; attempt<maxAttempts; ++attempt )
     {
-        (*dest) = (float)atof( s );
-        return true;
-    }
+        const int ctBefore = irsdk.getSessionCt();
+        const char* src = irsdk.getSessionStr();
+        if( !src )
+            return false;
+
+        const int maxLen = irsdk_getHeader()->sessionInfoLen;
+        const char* end = (const char*)memchr( src, 0, maxLen );
+        s_sessionStr.assign( src, end ? end : src+maxLen );
+        s_sessionStr.push_back( 0 );
+
+        if( irsdk.getSessionCt() == ctBefore ) {
+            s_sessionCt = ctBefore;
+            return true;
+        }
 
+        ir_sessionTornCopies++;
+    }
     return false;
 }
 
-static bool parseYamlStr(const char *yamlStr, const char *path, std::string& dest)
+RaceState ir_raceState;
+SectorTiming ir_sectorTiming;
+PitLog ir_pitLog;
+LapStats ir_lapStats;
+IRatingProjection ir_iratingProjection;
+RelativeMatrix ir_relativeMatrix;
+GapTrend ir_gapTrend;
+Proximity ir_proximity;
+HazardDetector ir_hazards;
+RefLapRecorder ir_refLaps;
+RaceEndProjection ir_raceEnd;
+int ir_remainingLaps = -1;
+FuelModel ir_fuelModel;
+TireModel ir_tireModel;
+
+static RaceStateInput s_raceStateInput;
+static LapPredictor   s_lapPredictor;
+static int            s_tickTimeoutMs = 16;
+static FocusMode      s_focusMode = FocusMode::AUTO;
+static std::string    s_refLapFile;         // where ir_refLaps is kept for the current car and track
+static std::string    s_refLapIbt;          // .ibt the loaded reference lap came from
+static int            s_refLapSavedAt = 0;  // ir_refLaps.numLaps() when last saved
+static RefLapWriter   s_refLapWriter;
+static RefLapLoader   s_refLapLoader;
+static FuelModelConfig s_fuelConfig;
+static bool           s_sectorTimingEnabled = false;  // engines no built-in overlay shows, for custom ones
+static bool           s_spotterEnabled = false;
+static bool           s_hazardsEnabled = false;
+static int            s_tireSessionNum = -1;
+static int            s_tireLap = 0;
+static bool           s_tireInPitStall = false;
+static int            s_lapAtCheckered = -1;    // our last unfinished lap once the checkered flag is out, -1 before
+
+// E.g. "reflap_porsche911rgt3_spa 2022 gp.bin", empty if car or track are unknown
+static std::string refLapFilename()
 {
-    int count = 0;
-    const char *s = nullptr;
+    if( !*ir_session.driverCarPath || !*ir_session.trackName )
+        return std::string();
 
-    if( parseYaml(yamlStr, path, &s, &count) )
-    {
-        // strip leading quotes
-        if( *s == '"' )
-        {
-            s++;
-            count--;
-        }
-
-        dest.assign( s, count );
+    std::string name = std::string("reflap_") + ir_session.driverCarPath + "_" + ir_session.trackName;
+    for( char& c : name ) {
+        if( strchr( "\\/:*?\"<>|", c ) )
+            c = '_';
+    }
+    std::string dir = g_cfg.getString( "General", "reference_lap_dir", "" );
+    if( !dir.empty() && dir.back() != '/' && dir.back() != '\\' )
+        dir += '\\';
+    return dir + name + ".bin";
+}
 
-        // strip trailing quotes
-        if( !dest.empty() && dest[dest.length()-1]=='"' )
-            dest.pop_back();
+// Hands ir_refLaps to the writer thread, so the tick never waits for the disk
+static void saveRefLaps()
+{
+    RefLapFile file;
+    ir_refLaps.snapshot( file );
+    s_refLapWriter.post( s_refLapFile, file );
+}
 
-        return true;
-    }
+// In a timed race, the flag comes out when the leader crosses the line after the clock ran out,
+// so project the leader's laps from its recent pace rather than counting our own laps. In other
+// sessions everyone just finishes their lap in progress. Once the flag is out, it's our next crossing.
+static RaceEndProjection projectRaceEnd( int carIdx, double remainingSessionTime )
+{
+    const RaceState& rs = ir_raceState;
+    if( carIdx < 0 || ir_isPreStart() )
+        return RaceEndProjection();
+
+    const int ldrIdx = ir_session.sessionType==SessionType::RACE && rs.leaderCarIdx >= 0 ? rs.leaderCarIdx : carIdx;
+    auto pace = [&]( int i ) {
+        const float recent = ir_lapStats.recentPace( i );
+        return recent > 0 ? recent : (i==carIdx ? rs.estLaptime : rs.estLaptimeByCar[i]);
+    };
+
+    // If we're the one taking the flag, we've finished right then
+    const int  state     = ir_SessionState.getInt();
+    const bool checkered = state == irsdk_StateCheckered || state == irsdk_StateCoolDown || (ir_SessionFlags.getInt() & irsdk_checkered);
+    if( !checkered )
+        s_lapAtCheckered = -1;
+    else if( s_lapAtCheckered < 0 )
+        s_lapAtCheckered = carIdx == ldrIdx ? rs.lap[carIdx]-1 : rs.lap[carIdx];
+
+    RaceEndInput in;
+    in.timeRemaining  = remainingSessionTime;
+    in.leaderDistance = rs.distance[ldrIdx];
+    in.leaderPace     = pace( ldrIdx );
+    in.selfDistance   = rs.distance[carIdx];
+    in.selfPace       = pace( carIdx );
+    in.leaderFinished = checkered;
+    in.selfFinished   = checkered && rs.lap[carIdx] > s_lapAtCheckered;
+    return ir_projectRaceEnd( in );
+}
 
-    return false;
+static double steadyNow()
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
 }
 
 ConnectionStatus ir_tick()
 {
     irsdkClient& irsdk = irsdkClient::instance();
 
-    irsdk.waitForData(16);
+    // When rendering faster than the telemetry rate, this returns without new data in between
+    const bool newData = irsdk.waitForData( s_tickTimeoutMs );
 
     if( !irsdk.isConnected() )
+    {
+        s_sessionHash = 0;  // make sure we parse the first session string after reconnecting
         return ConnectionStatus::DISCONNECTED;
+    }
+
+    // Counters start over with a new connection
+    if( irsdk.getStatusID() != s_sessionStatusId ) {
+        s_sessionStatusId = irsdk.getStatusID();
+        s_sessionCt = -1;
+    }
 
-    if( irsdk.wasSessionStrUpdated() )
+    if( irsdk.getSessionCt() != s_sessionCt && copySessionStr(irsdk) )
     {
-        const char* sessionYaml = irsdk.getSessionStr();
+        const char* sessionYaml = s_sessionStr.data();
+        ir_sessionUpdatesReceived++;
+
+        // Optionally record all session strings, e.g. for feeding them to the benchmarks in bench/
 #ifdef _DEBUG
-        //printf("%s\n", sessionYaml);
-        FILE* fp = fopen("sessionYaml.txt","ab");
-        fprintf(fp,"\n\n==== NEW SESSION STRING ======================================\n");
-        fprintf(fp,"%s",sessionYaml);
-        fclose(fp);
+        const bool journalDefault = true;
+#else
+        const bool journalDefault = false;
 #endif
-        char path[256];
-
-        // Weekend info
-        sprintf( path, "WeekendInfo:SubSessionID:" );
-        parseYamlInt( sessionYaml, path, &ir_session.subsessionId );
-
-        sprintf( path, "WeekendInfo:WeekendOptions:IsFixedSetup:" );
-        parseYamlInt( sessionYaml, path, &ir_session.isFixedSetup );
-
-        // Current session type
-        std::string sessionNameStr;
-        sprintf( path, "SessionInfo:Sessions:SessionNum:{%d}SessionName:", ir_SessionNum.getInt() );
-        parseYamlStr( sessionYaml, path, sessionNameStr );
-        if( sessionNameStr == "PRACTICE" )
-            ir_session.sessionType = SessionType::PRACTICE;
-        if( sessionNameStr == "QUALIFY" )
-            ir_session.sessionType = SessionType::QUALIFY;
-        else if( sessionNameStr == "RACE" )
-            ir_session.sessionType = SessionType::RACE;
-
-        // Driver/car info
-        parseYamlInt( sessionYaml, "DriverInfo:DriverCarIdx:", &ir_session.driverCarIdx );
-        parseYamlFloat( sessionYaml, "DriverInfo:DriverCarFuelMaxLtr:", &ir_session.fuelMaxLtr );
-        parseYamlFloat( sessionYaml, "DriverInfo:DriverCarIdleRPM:", &ir_session.rpmIdle );
-        parseYamlFloat( sessionYaml, "DriverInfo:DriverCarRedLine:", &ir_session.rpmRedline );
-        parseYamlFloat( sessionYaml, "DriverInfo:DriverCarSLFirstRPM:", &ir_session.rpmSLFirst );
-        parseYamlFloat( sessionYaml, "DriverInfo:DriverCarSLShiftRPM:", &ir_session.rpmSLShift );
-        parseYamlFloat( sessionYaml, "DriverInfo:DriverCarSLLastRPM:", &ir_session.rpmSLLast );
-        parseYamlFloat( sessionYaml, "DriverInfo:DriverCarSLBlinkRPM:", &ir_session.rpmSLBlink );
-
-        // Per-Driver info
-        for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+        if( g_cfg.getBool("General", "session_journal_enabled", journalDefault) )
         {
-            Car& car = ir_session.cars[carIdx];
-
-            car.isSelf = int( carIdx==ir_session.driverCarIdx );
+            if( !s_sessionJournal.isOpen() )
+                s_sessionJournal.open( g_cfg.getString("General", "session_journal_file", "sessionJournal.bin"), (size_t)g_cfg.getInt("General", "session_journal_max_mb", 64) << 20 );
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}UserName:", carIdx );
-            if( !parseYamlStr( sessionYaml, path, car.userName ) )
-            {
-                car = Car();
-                continue;
-            }
+            const double now = std::chrono::duration<double>( std::chrono::system_clock::now().time_since_epoch() ).count();
+            s_sessionJournal.add( sessionYaml, now, ir_SessionTick.getInt(), ir_SessionNum.getInt() );
+        }
+        else if( s_sessionJournal.isOpen() )
+        {
+            s_sessionJournal.close();
+        }
 
-            // Remove line breaks in user names if we find any (saw this happen once)
-            for( char& c : car.userName )
-                c = (c=='\n'||c=='\r') ? ' ' : c;
+        // The update counter also bumps for changes in sections we don't look at, so skip the
+        // (slow) parse unless something relevant actually changed.
+        const unsigned long long hash = ir_hashSessionStr( sessionYaml, (int)s_sessionStr.size(), ir_SessionNum.getInt() );
+        if( hash != s_sessionHash )
+        {
+            s_sessionHash = hash;
+            ir_sessionUpdatesProcessed++;
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarNumber:", carIdx );
-            parseYamlStr( sessionYaml, path, car.carNumberStr );
+            // Size the car arrays after what the sim actually sends. More than we have room for
+            // would need a bigger IR_MAX_CARS (and wider masks), so those cars are ignored.
+            const int numCarSlots = ir_CarIdxLapDistPct.getCount();
+            ir_session.numCarSlots = numCarSlots > 0 ? std::min( numCarSlots, IR_MAX_CARS ) : IR_MAX_CARS;
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarNumberRaw:", carIdx );
-            parseYamlInt( sessionYaml, path, &car.carNumber );
+            const SessionType prevSessionType = ir_session.sessionType;
+            ir_parseSessionStr( sessionYaml, ir_SessionNum.getInt(), ir_session );
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}LicString:", carIdx );
-            parseYamlStr( sessionYaml, path, car.licenseStr );
-            car.licenseChar = car.licenseStr.empty() ? 'R' : car.licenseStr[0];
-            const std::string SRstr = car.licenseStr.empty() ? "0" : std::string( car.licenseStr.begin()+1, car.licenseStr.end() );
-            car.licenseSR = (float)atof( SRstr.c_str() );
+            // Avoid confusing the fuel calculator logic with session changes
+            if( ir_session.sessionType != prevSessionType )
+                ir_fuelModel.invalidateLap();
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}LicColor:", carIdx );
-            parseYamlStr( sessionYaml, path, car.licenseColStr );
-            unsigned licColHex = 0;
-            sscanf( car.licenseColStr.c_str(), "0x%x", &licColHex );
-            car.licenseCol.r = float((licColHex >> 16) & 0xff) / 255.f;
-            car.licenseCol.g = float((licColHex >>  8) & 0xff) / 255.f;
-            car.licenseCol.b = float((licColHex >>  0) & 0xff) / 255.f;
-            car.licenseCol.a = 1;
+            // Reference laps are kept per car and track
+            const std::string refLapFile = refLapFilename();
+            if( refLapFile != s_refLapFile )
+            {
+                if( !s_refLapFile.empty() && ir_refLaps.isDirty() )
+                    saveRefLaps();
+                ir_refLaps.reset();
+                if( !refLapFile.empty() )
+                    ir_refLaps.load( refLapFile );
+                s_refLapFile = refLapFile;
+                s_refLapIbt.clear();    // reloaded in ir_handleConfigChange()
+                s_refLapSavedAt = 0;
+            }
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}IRating:", carIdx );
-            parseYamlInt( sessionYaml, path, &car.irating );
+            ir_handleConfigChange();
+        }
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarIsPaceCar:", carIdx );
-            parseYamlInt( sessionYaml, path, &car.isPaceCar );
+    } // if session string updated
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}IsSpectator:", carIdx );
-            parseYamlInt( sessionYaml, path, &car.isSpectator );
+    // Gather the per-car telemetry once and derive everything the overlays need from it
+    RaceStateInput& in = s_raceStateInput;
+    for( int carIdx=0; carIdx<ir_session.numCarSlots; ++carIdx )
+    {
+        in.lap[carIdx]           = ir_CarIdxLap.getInt(carIdx);
+        in.lapCompleted[carIdx]  = ir_CarIdxLapCompleted.getInt(carIdx);
+        in.lapDistPct[carIdx]    = ir_CarIdxLapDistPct.getFloat(carIdx);
+        in.position[carIdx]      = ir_CarIdxPosition.getInt(carIdx);
+        in.classPosition[carIdx] = ir_CarIdxClassPosition.getInt(carIdx);
+        in.estTime[carIdx]       = ir_CarIdxEstTime.getFloat(carIdx);
+        in.f2Time[carIdx]        = ir_CarIdxF2Time.getFloat(carIdx);
+        in.bestLapTime[carIdx]   = ir_CarIdxBestLapTime.getFloat(carIdx);
+        in.lastLapTime[carIdx]   = ir_CarIdxLastLapTime.getFloat(carIdx);
+        in.onPitRoad[carIdx]     = ir_CarIdxOnPitRoad.getBool(carIdx);
+        in.inWorld[carIdx]       = ir_CarIdxTrackSurface.getInt(carIdx) != irsdk_NotInWorld;
+        in.inPitStall[carIdx]    = ir_CarIdxTrackSurface.getInt(carIdx) == irsdk_InPitStall;
+        in.offTrack[carIdx]      = ir_CarIdxTrackSurface.getInt(carIdx) == irsdk_OffTrack;
+    }
+    in.sessionStateValid = ir_SessionState.getInt() >= 0;
+    in.isWarmup          = ir_SessionState.getInt() == irsdk_StateWarmup;
+    in.isPreStart        = ir_isPreStart();
+    in.selfBestLapTime   = ir_LapBestLapTime.getFloat();
+    in.sessionVersion    = ir_sessionUpdatesProcessed;
+    in.sessionTime       = ir_SessionTime.getDouble();
+    ir_updateRaceState( ir_session, in, ir_raceState );
+    if( s_sectorTimingEnabled )
+        ir_sectorTiming.update( ir_SessionTime.getDouble(), ir_session, in.lapDistPct, in.onPitRoad, ir_raceState.validMask );
+    ir_pitLog.update( ir_SessionTime.getDouble(), in.lap, in.onPitRoad, in.inPitStall, in.inWorld, ir_raceState.validMask );
+    ir_lapStats.update( ir_SessionTime.getDouble(), ir_session, in.lapCompleted, in.lastLapTime, in.onPitRoad, in.inWorld,
+                        (ir_SessionFlags.getInt() & (irsdk_caution|irsdk_cautionWaving)) || in.isPreStart, ir_raceState.validMask );
+    ir_iratingProjection.update( ir_session, in.sessionVersion, ir_raceState.classPosition );
+
+    // Laps left for us, for the DDU and anything planning to the end of the session
+    if( ir_isSessionTimeLimited() )
+    {
+        const double remainingSessionTime = ir_SessionTimeRemain.getDouble();
+        ir_raceEnd       = projectRaceEnd( ir_session.driverCarIdx, remainingSessionTime );
+        ir_remainingLaps = ir_raceEnd.valid ? ir_raceEnd.remainingLaps : int(0.5+remainingSessionTime/ir_raceState.estLaptime);
+    }
+    else
+    {
+        ir_raceEnd       = RaceEndProjection();
+        ir_remainingLaps = ir_SessionLapsRemainEx.getInt() != 32767 ? ir_SessionLapsRemainEx.getInt() : -1;
+    }
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CurDriverIncidentCount:", carIdx );
-            parseYamlInt( sessionYaml, path, &car.incidentCount );
+    const int selfIdx = ir_session.driverCarIdx;
+    const int selfLap = in.isPreStart || selfIdx < 0 ? 0 : std::max( 0, ir_raceState.lap[selfIdx] );
 
-            sprintf( path, "DriverInfo:Drivers:CarIdx:{%d}CarClassEstLapTime:", carIdx );
-            parseYamlFloat( sessionYaml, path, &car.carClassEstLapTime );
+    // Our fuel use. Laps that weren't entirely under green or where we pitted don't count.
+    {
+        FuelModelInput fin;
+        fin.lap           = selfLap;
+        fin.lapDistPct    = selfIdx >= 0 ? ir_raceState.lapDistPct[selfIdx] : -1;
+        fin.fuelLevel     = ir_FuelLevel.getFloat();
+        fin.fuelCapacity  = ir_session.fuelMaxLtr;
+        fin.remainingLaps = ir_remainingLaps;
+        fin.isGreen       = !(ir_SessionFlags.getInt() & (irsdk_yellow|irsdk_yellowWaving|irsdk_red|irsdk_checkered|irsdk_crossed|irsdk_oneLapToGreen|irsdk_caution|irsdk_cautionWaving|irsdk_disqualify|irsdk_repair));
+        fin.onPitRoad     = selfIdx >= 0 && in.onPitRoad[selfIdx];
+        ir_fuelModel.update( fin, s_fuelConfig );
+    }
 
-            car.practicePosition = 0;
-            car.qualPosition = 0;
-            car.racePosition = 0;
+    // Our tire wear trends. iRacing only updates the readings in the pit stall, so the worn set is
+    // seen on arriving there, before service, and the new one on leaving. Plus once per lap.
+    {
+        if( ir_SessionNum.getInt() != s_tireSessionNum )
+        {
+            ir_tireModel.reset();
+            s_tireSessionNum = ir_SessionNum.getInt();
         }
-
-        // Qualifying results info
-        for( int pos=0; pos<IR_MAX_CARS; ++pos )
+        const bool inPitStall = selfIdx >= 0 && in.inPitStall[selfIdx];
+        if( selfIdx >= 0 && (selfLap != s_tireLap || inPitStall != s_tireInPitStall) )
         {
-            sprintf( path, "QualifyResultsInfo:Results:Position:{%d}CarIdx:", pos );
-            int carIdx = -1;
-            if( parseYamlInt( sessionYaml, path, &carIdx ) ) {
-                ir_session.cars[carIdx].qualPosition = pos + 1;
-
-                sprintf( path, "QualifyResultsInfo:Results:Position:{%d}FastestTime:", pos );
-                parseYamlFloat( sessionYaml, path, &ir_session.cars[carIdx].qualTime );
-            }
+            TireSample ts;
+            ts.lap = selfLap;
+            ts.wear[TireModel::LF] = std::min(std::min( ir_LFwearL.getFloat(), ir_LFwearM.getFloat() ), ir_LFwearR.getFloat() );
+            ts.wear[TireModel::RF] = std::min(std::min( ir_RFwearL.getFloat(), ir_RFwearM.getFloat() ), ir_RFwearR.getFloat() );
+            ts.wear[TireModel::LR] = std::min(std::min( ir_LRwearL.getFloat(), ir_LRwearM.getFloat() ), ir_LRwearR.getFloat() );
+            ts.wear[TireModel::RR] = std::min(std::min( ir_RRwearL.getFloat(), ir_RRwearM.getFloat() ), ir_RRwearR.getFloat() );
+            ts.carcassTemp[TireModel::LF] = (ir_LFtempCL.getFloat() + ir_LFtempCM.getFloat() + ir_LFtempCR.getFloat()) / 3.0f;
+            ts.carcassTemp[TireModel::RF] = (ir_RFtempCL.getFloat() + ir_RFtempCM.getFloat() + ir_RFtempCR.getFloat()) / 3.0f;
+            ts.carcassTemp[TireModel::LR] = (ir_LRtempCL.getFloat() + ir_LRtempCM.getFloat() + ir_LRtempCR.getFloat()) / 3.0f;
+            ts.carcassTemp[TireModel::RR] = (ir_RRtempCL.getFloat() + ir_RRtempCM.getFloat() + ir_RRtempCR.getFloat()) / 3.0f;
+            ir_tireModel.addSample( ts );
         }
+        s_tireLap = selfLap;
+        s_tireInPitStall = inPitStall;
+    }
 
-        // Session info (may override qual results from above, but that's ok since hopefully they're the same!)
-        for( int session=0; ; ++session )
+    // Our laps on the reference lap grid. Written to disk in the background when a lap brought something new, not every tick.
+    {
+        const bool inCar = ir_IsOnTrackCar.getBool() && ir_session.driverCarIdx >= 0;
+        const bool clean = !ir_OnPitRoad.getBool() && ir_PlayerTrackSurface.getInt() != irsdk_OffTrack;
+        ir_refLaps.update( ir_SessionTime.getDouble(), inCar ? ir_LapDistPct.getFloat() : -1, clean );
+        if( ir_refLaps.isDirty() && ir_refLaps.numLaps() != s_refLapSavedAt && !s_refLapFile.empty() )
         {
-            std::string sessionNameStr;
-            sprintf( path, "SessionInfo:Sessions:SessionNum:{%d}SessionName:", session );
-            if( !parseYamlStr( sessionYaml, path, sessionNameStr ) )
-                break;
-
-            std::string str;
-            sprintf( path, "SessionInfo:Sessions:SessionNum:{%d}SessionTime:", session );
-            parseYamlStr( sessionYaml, path, str );
-            ir_session.isUnlimitedTime = int( str=="unlimited" );
-
-            sprintf( path, "SessionInfo:Sessions:SessionNum:{%d}SessionLaps:", session );
-            parseYamlStr( sessionYaml, path, str );
-            ir_session.isUnlimitedLaps = int( str=="unlimited" );
-
-            for( int pos=1; pos<IR_MAX_CARS+1; ++pos )
-            {
-                int carIdx = -1;
-                sprintf( path, "SessionInfo:Sessions:SessionNum:{%d}ResultsPositions:Position:{%d}CarIdx:", session, pos );
-                if( parseYamlInt( sessionYaml, path, &carIdx ) )
-                {
-                    if( sessionNameStr == "PRACTICE" )
-                        ir_session.cars[carIdx].practicePosition = pos;
-                    else if( sessionNameStr == "QUALIFY" )
-                        ir_session.cars[carIdx].qualPosition = pos;
-                    else if( sessionNameStr == "RACE" )
-                        ir_session.cars[carIdx].racePosition = pos;
-                }
-            }
+            saveRefLaps();
+            s_refLapSavedAt = ir_refLaps.numLaps();
         }
 
-        // SoF
-        double sof = 0;
-        int cnt = 0;
-        for( int i=0; i<IR_MAX_CARS; ++i )
+        // An .ibt lap the loader thread finished with, unless the setting changed again since
+        std::string ibt;
+        RefLap lap;
+        if( s_refLapLoader.poll( ibt, lap ) && ibt == s_refLapIbt )
+            ir_refLaps.setLoaded( lap );
+    }
+
+    // Nobody moving on the grid before the start isn't an incident
+    if( s_hazardsEnabled )
+    {
+        ir_hazards.setTrackLength( ir_session.trackLengthM );
+        ir_hazards.update( ir_SessionTime.getDouble(), ir_session, in.lapDistPct, ir_raceState.speed, in.offTrack, in.onPitRoad, in.inWorld, in.isPreStart ? 0 : ir_raceState.validMask );
+    }
+    if( newData )
+        s_lapPredictor.addSample( ir_SessionTime.getDouble(), steadyNow(), in.lapDistPct, ir_raceState.lapSpeed, in.estTime, in.lap );
+
+    // Relatives from every car's point of view, so the overlays can follow any car without a hitch.
+    // Candidates are the actual competitors, plus the pace car, but only under yellow or initial pace lap.
+    // Assume no lap delta when not in a race, because we don't want to show drivers as lapped/lapping there.
+    // Also reset it during initial pacing, since iRacing for some reason starts counting
+    // during the pace lap but then resets the counter a couple seconds in, confusing the logic.
+    // And consider the pace car in the same lap as everyone, too.
+    {
+        const bool showPaceCar = (ir_SessionFlags.getInt() & (irsdk_caution|irsdk_cautionWaving)) || in.isPreStart;
+        unsigned long long candidates = 0;
+        unsigned long long paceCars = 0;
+        for( int k=0; k<ir_session.numActiveCars; ++k )
         {
+            const int  i   = ir_session.activeCarIdx[k];
             const Car& car = ir_session.cars[i];
-
-            if( car.isPaceCar || car.isSpectator || car.userName.empty() )
-                continue;
-
-            sof += car.irating;
-            cnt++;
+            if( car.isPaceCar )
+                paceCars |= 1ULL << i;
+            if( car.carNumber>=0 && (ir_raceState.isValid(i) || (car.isPaceCar && showPaceCar)) )
+                candidates |= 1ULL << i;
         }
-        ir_session.sof = int(sof / cnt);
 
-        ir_handleConfigChange();
+        RelativeInput rin;
+        rin.estTime          = in.estTime;
+        rin.lapDistPct       = in.lapDistPct;
+        rin.lap              = in.lap;
+        rin.candidateMask    = candidates;
+        rin.zeroLapDeltaMask = paceCars;
+        rin.zeroLapDeltas    = ir_session.sessionType!=SessionType::RACE || in.isPreStart;
+        ir_computeRelativeMatrix( rin, ir_raceState.estLaptimeByCar, candidates & ~paceCars, ir_relativeMatrix );
+    }
 
-    } // if session string updated
+    // How the gaps to the focus car develop. Sampled at a few Hz only, a trend needs seconds anyway.
+    {
+        const int focusIdx = ir_getFocusCarIdx();
+        if( focusIdx >= 0 && ((ir_relativeMatrix.rowMask >> focusIdx) & 1) )
+        {
+            const RelativeOutput& row = ir_relativeMatrix.rows[focusIdx];
+            ir_gapTrend.update( ir_SessionTime.getDouble(), focusIdx, row.delta, row.validMask & ~(1ULL << focusIdx), 0.5f );
+        }
+        else
+            ir_gapTrend.update( ir_SessionTime.getDouble(), -1, nullptr, 0, 0.5f );
+    }
 
-    // Track cars in pits. Reset every time we're in the 'warmup' phase (just before starting pace laps).
-    const bool resetPitAge = ir_SessionState.getInt() == irsdk_StateWarmup;
-    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    // Spotter distances. Only cars that are on track, and on pit road if and only if the focus car is.
+    if( s_spotterEnabled )
     {
-        Car& car = ir_session.cars[carIdx];
-        if( resetPitAge )
-            car.lastLapInPits = 0;
-        if( ir_SessionState.getInt() >= 0 /* work around getting garbage sometimes (?) */ && ir_CarIdxOnPitRoad.getBool(carIdx) )
-            car.lastLapInPits = ir_CarIdxLap.getInt(carIdx);
+        const int focusIdx = ir_getFocusCarIdx();
+        unsigned long long mask = 0;
+        if( focusIdx >= 0 )
+        {
+            const bool focusInPits = in.onPitRoad[focusIdx];
+            for( int k=0; k<ir_session.numActiveCars; ++k )
+            {
+                const int i = ir_session.activeCarIdx[k];
+                if( in.inWorld[i] && in.lapDistPct[i] >= 0 && in.onPitRoad[i] == focusInPits )
+                    mask |= 1ULL << i;
+            }
+        }
+        ir_proximity.setTrackLength( ir_session.trackLengthM );
+        ir_proximity.update( focusIdx, in.lapDistPct, ir_raceState.speed, mask );
     }
 
     // Check for both ir_IsOnTrack and ir_IsOnTrackCar, because I've seen iRacing report true for ir_IsOnTrack 
@@ -567,9 +729,47 @@ void ir_handleConfigChange()
     std::vector<std::string> buddies = g_cfg.getStringVec( "General", "buddies", {} );
     std::vector<std::string> flagged = g_cfg.getStringVec( "General", "flagged", {} );
 
-    for( int carIdx=0; carIdx<IR_MAX_CARS; ++carIdx )
+    // Only kept up to date when asked for. Off, they're reset so nothing stale shows when turned back on.
+    s_sectorTimingEnabled = g_cfg.getBool( "General", "sector_timing_enabled", false );
+    s_spotterEnabled      = g_cfg.getBool( "General", "spotter_enabled", false );
+    s_hazardsEnabled      = g_cfg.getBool( "General", "hazards_enabled", false );
+    if( !s_sectorTimingEnabled )
+        ir_sectorTiming.reset();
+    if( !s_spotterEnabled )
+        ir_proximity.reset();
+    if( !s_hazardsEnabled )
+        ir_hazards.reset();
+
+    ir_sectorTiming.setNumSectors( g_cfg.getInt( "General", "mini_sectors", 20 ) );
+    ir_proximity.setCarLength( g_cfg.getFloat( "General", "car_length", 4.5f ) );
+
+    s_fuelConfig.numLapsToAvg   = g_cfg.getInt( "OverlayDDU", "fuel_estimate_avg_green_laps", 4 );
+    s_fuelConfig.estimateFactor = g_cfg.getFloat( "OverlayDDU", "fuel_estimate_factor", 1.1f );
+
+    // Reference lap from a telemetry file, only read when the setting changes
+    const std::string ibt = g_cfg.getString( "General", "reference_lap_ibt", "" );
+    if( ibt != s_refLapIbt )
+    {
+        ir_refLaps.setLoaded( RefLap() );   // until the loader is done with the new one, see ir_tick()
+        if( !ibt.empty() )
+            s_refLapLoader.post( ibt );
+        s_refLapIbt = ibt;
+    }
+
+    const std::string focus = g_cfg.getString( "General", "focus_car", "auto" );
+    s_focusMode = FocusMode::AUTO;
+    for( int i=0; i<(int)_countof(FocusModeStr); ++i )
+    {
+        if( focus == FocusModeStr[i] )
+            s_focusMode = (FocusMode)i;
+    }
+
+    // Telemetry comes at 60Hz. Rendering faster than that makes sense with extrapolation, see ir_predictLapPositions().
+    s_tickTimeoutMs = std::max( 1, 1000 / std::max( 1, g_cfg.getInt( "General", "render_hz", 60 ) ) );
+
+    for( int i=0; i<ir_session.numActiveCars; ++i )
     {
-        Car& car = ir_session.cars[carIdx];
+        Car& car = ir_session.cars[ir_session.activeCarIdx[i]];
 
         car.isBuddy = 0;
         for( const std::string& name : buddies ) {
@@ -585,6 +785,28 @@ void ir_handleConfigChange()
     }
 }
 
+int ir_getFocusCarIdx()
+{
+    const int camCarIdx = ir_CamCarIdx.getInt();
+    const bool camValid = camCarIdx >= 0 && camCarIdx < IR_MAX_CARS && ((ir_relativeMatrix.rowMask >> camCarIdx) & 1);
+
+    switch( s_focusMode )
+    {
+        case FocusMode::DRIVER:
+            return ir_session.driverCarIdx;
+        case FocusMode::CAMERA:
+            return camValid ? camCarIdx : -1;
+        default:
+            return ir_IsOnTrackCar.getBool() || !camValid ? ir_session.driverCarIdx : camCarIdx;
+    }
+}
+
+void ir_cycleFocusMode()
+{
+    s_focusMode = FocusMode( (int(s_focusMode) + 1) % _countof(FocusModeStr) );
+    g_cfg.setString( "General", "focus_car", FocusModeStr[(int)s_focusMode] );
+}
+
 bool ir_isPreStart()
 {
     // To find out whether we're pacing, it isn't enough to check ir_PaceMode, because
@@ -602,51 +824,34 @@ float ir_estimateLaptime()
     return ir_session.cars[ir_session.driverCarIdx].carClassEstLapTime;
 }
 
-int ir_getPosition( int carIdx )
+bool ir_isSessionTimeLimited()
 {
-    // Try the different sources we have for position data, in descending order of importance
-    int pos = ir_CarIdxPosition.getInt(carIdx);
-    if( pos > 0 )
-        return pos;
-
-    pos = ir_session.cars[carIdx].racePosition;
-    if( pos > 0 )
-        return pos;
-
-    pos = ir_session.cars[carIdx].qualPosition;
-    if( pos > 0 )
-        return pos;
+    // Most robust way I could find to figure out whether this is a time-limited session (info in session string is often misleading)
+    return ir_SessionLapsTotal.getInt() == 32767 && ir_SessionTimeRemain.getDouble()<48.0*3600.0;
+}
 
-    pos = ir_session.cars[carIdx].practicePosition;
-    if( pos > 0 )
-        return pos;
+int ir_getPosition( int carIdx )
+{
+    return carIdx >= 0 && carIdx < IR_MAX_CARS ? ir_raceState.position[carIdx] : 0;
+}
 
-    return 0;
+void ir_predictLapPositions( float* lapDistPct, float* estTime, int* lap )
+{
+    s_lapPredictor.predict( steadyNow(), lapDistPct, estTime, lap );
 }
 
 int ir_getLapDeltaToLeader( int carIdx, int ldrIdx )
 {
-    if( ir_session.sessionType!=SessionType::RACE || ir_isPreStart() || carIdx < 0 || ldrIdx < 0 )
-        return 0;
-
-    const int carLapCount = std::max( ir_CarIdxLap.getInt(carIdx), ir_CarIdxLapCompleted.getInt(carIdx) );
-    const int ldrLapCount = std::max( ir_CarIdxLap.getInt(ldrIdx), ir_CarIdxLapCompleted.getInt(ldrIdx) );
-
-   // if( carLapCount < 0 )
-     //   return ir_CarIdxLapCompleted.getInt(carIdx) - ir_CarIdxLapCompleted.getInt(ldrIdx);
-
-    const float carPctAroundLap = ir_CarIdxLapDistPct.getFloat( carIdx );
-    const float ldrPctAroundLap = ir_CarIdxLapDistPct.getFloat( ldrIdx );
-
-    if( carPctAroundLap < 0 || ldrPctAroundLap < 0 )
-        return 0;
-
-    int lapDelta = carLapCount - ldrLapCount;
+    return ir_computeLapDelta( ir_session, s_raceStateInput, carIdx, ldrIdx );
+}
 
-    if( carPctAroundLap > ldrPctAroundLap )
-        lapDelta += 1;
+const ResultsEntry* ir_getResult( int carIdx )
+{
+    const int num = ir_SessionNum.getInt();
+    if( num < 0 || num >= ir_session.numSessions )
+        return nullptr;
 
-    return lapDelta;
+    return ir_session.results[num].get( carIdx );
 }
 
 void ir_printVariables()
@@ -26,12 +26,24 @@ SOFTWARE.
 
 #include "irsdk/irsdk_defines.h"
 #include "irsdk/irsdk_client.h"
-#include "irsdk/yaml_parser.h"
 #include <string>
+#include "Session.h"
+#include "RaceState.h"
+#include "SectorTiming.h"
+#include "PitLog.h"
+#include "LapPredictor.h"
+#include "RelativeKernel.h"
+#include "GapTrend.h"
+#include "LapStats.h"
+#include "IRatingProjection.h"
+#include "Proximity.h"
+#include "HazardDetector.h"
+#include "ReferenceLap.h"
+#include "RaceEndProjection.h"
+#include "FuelModel.h"
+#include "TireModel.h"
 #include "util.h"
 
-#define IR_MAX_CARS 64
-
 enum class ConnectionStatus
 {
     UNKNOWN = 0,
@@ -41,58 +53,14 @@ enum class ConnectionStatus
 };
 static const char* const ConnectionStatusStr[] = {"UNKNOWN","DISCONNECTED","CONNECTED","DRIVING"};
 
-enum class SessionType
-{
-    UNKNOWN = 0,
-    PRACTICE,
-    QUALIFY,
-    RACE
-};
-static const char* const SessionTypeStr[] = {"UNKNOWN","PRACTICE","QUALIFY","RACE"};
-
-struct Car
-{    
-    std::string     userName;
-    int             carNumber = 0;
-    std::string     carNumberStr;
-    std::string     licenseStr;
-    char            licenseChar = 'R';
-    float           licenseSR = 0;
-    std::string     licenseColStr;
-    float4          licenseCol = float4(0,0,0,1);
-    int             irating = 0;
-    int             isSelf = 0;
-    int             isPaceCar = 0;
-    int             isSpectator = 0;
-    int             isBuddy = 0;
-    int             isFlagged = 0;
-    int             incidentCount = 0;
-    float           carClassEstLapTime = 0;
-    int             practicePosition = 0;
-    int             qualPosition = 0;
-    float           qualTime = 0;
-    int             racePosition = 0;
-    int             lastLapInPits = 0;
-};
-
-struct Session
+// Which car the Relative and DDU follow
+enum class FocusMode
 {
-    SessionType     sessionType = SessionType::UNKNOWN;
-    Car             cars[IR_MAX_CARS];
-    int             driverCarIdx = -1;
-    int             sof = 0;
-    int             subsessionId = 0;
-    int             isFixedSetup = 0;
-    int             isUnlimitedTime = 0;
-    int             isUnlimitedLaps = 0;
-    float           fuelMaxLtr = 0;
-    float           rpmIdle = 0;
-    float           rpmRedline = 0;
-    float           rpmSLFirst = 0;
-    float           rpmSLShift = 0;
-    float           rpmSLLast = 0;
-    float           rpmSLBlink = 0;
+    AUTO = 0,   // our car while we're driving, otherwise the camera car (spectating, replays)
+    DRIVER,
+    CAMERA
 };
+static const char* const FocusModeStr[] = {"auto","driver","camera"};
 
 extern irsdkCVar ir_SessionTime;    // double[1] Seconds since session start (s)
 extern irsdkCVar ir_SessionTick;    // int[1] Current update number ()
@@ -386,6 +354,25 @@ extern irsdkCVar ir_LFSHshockVel;    // float[1] LFSH shock velocity (m/s)
 extern irsdkCVar ir_LFSHshockVel_ST;    // float[6] LFSH shock velocity at 360 Hz (m/s)
 
 extern Session ir_session;
+extern RaceState ir_raceState;    // updated every ir_tick()
+extern SectorTiming ir_sectorTiming;    // updated every ir_tick() if "General.sector_timing_enabled", sector count from "General.mini_sectors"
+extern PitLog ir_pitLog;    // updated every ir_tick()
+extern LapStats ir_lapStats;    // updated every ir_tick()
+extern IRatingProjection ir_iratingProjection;    // updated every ir_tick(), for the current class positions
+extern RelativeMatrix ir_relativeMatrix;    // updated every ir_tick(), rows for all cars
+extern GapTrend ir_gapTrend;    // updated every ir_tick(), gaps to the focus car
+extern Proximity ir_proximity;    // updated every ir_tick() if "General.spotter_enabled", closest cars to the focus car
+extern HazardDetector ir_hazards;    // updated every ir_tick() if "General.hazards_enabled"
+extern RefLapRecorder ir_refLaps;    // updated every ir_tick(), our own laps, kept per car and track
+extern RaceEndProjection ir_raceEnd;    // updated every ir_tick(), for our car in time-limited sessions
+extern int ir_remainingLaps;    // updated every ir_tick(), laps left for our car counting the current one, -1 if unknown
+extern FuelModel ir_fuelModel;    // updated every ir_tick(), our fuel use and pit plan
+extern TireModel ir_tireModel;    // updated from ir_tick() once per lap and at pit stops, our tire wear trends
+
+// Session string updates seen vs. the ones that actually changed something we parse
+extern int ir_sessionUpdatesReceived;
+extern int ir_sessionUpdatesProcessed;
+extern int ir_sessionTornCopies;     // session string copies that had to be retried because the sim changed it meanwhile
 
 // Keep the session data updated.
 // Will block for around 16 milliseconds.
@@ -398,14 +385,31 @@ void ir_handleConfigChange();
 // to grid, or doing pace laps before the actual race start.
 bool ir_isPreStart();
 
+// Car to follow, according to the "General.focus_car" setting. -1 if none.
+int ir_getFocusCarIdx();
+
+// Switch to the next FocusMode and save it to the config.
+void ir_cycleFocusMode();
+
 // Estimate time for a full lap.
 float ir_estimateLaptime();
 
-// Get the best known position, from the latest session we can find.
+// Whether the session ends on time rather than laps.
+bool ir_isSessionTimeLimited();
+
+// Get the best known position, from the latest session we can find. Resolved once per change in
+// ir_tick(), see RaceState::carAtPosition() for the reverse lookup.
 int ir_getPosition( int carIdx );
 
+// CarIdxLapDistPct, CarIdxEstTime and CarIdxLap extrapolated from the last telemetry row to now,
+// for smooth movement when rendering faster than the telemetry rate. Arrays of IR_MAX_CARS.
+void ir_predictLapPositions( float* lapDistPct, float* estTime, int* lap );
+
 // Get lap delta to P0 car if available.
 int ir_getLapDeltaToLeader( int carIdx, int ldrIdx );
 
+// Get the car's line in the current session's results, or nullptr if it doesn't have one (yet).
+const ResultsEntry* ir_getResult( int carIdx );
+
 // Print all the variables the sim supports.
 void ir_printVariables();
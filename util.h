@@ -27,13 +27,20 @@ SOFTWARE.
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <ctype.h>
+
+// The rendering helpers below are Windows-only. Everything else in here is kept portable,
+// so that the session/telemetry code can also be built for the Linux benchmarks in bench/.
+#ifdef _WIN32
 #include <windows.h>
 #include <d2d1_3.h>
 #include <dwrite.h>
-#include <unordered_map>
-#include <ctype.h>
 
 #define HRCHECK( x_ ) do{ \
     HRESULT hr_ = x_; \
@@ -41,6 +48,7 @@ SOFTWARE.
         printf("ERROR: failed call to %s (%s:%d), hr=0x%x\n", #x_, __FILE__, __LINE__,hr_); \
         exit(1); \
     } } while(0)
+#endif
 
 struct float2
 {
@@ -48,8 +56,10 @@ struct float2
     union { float g; float y; };
     float2() = default;
     float2( float _x, float _y ) : x(_x), y(_y) {}
+#ifdef _WIN32
     float2( const D2D1_POINT_2F& p ) : x(p.x), y(p.y) {}
     operator D2D1_POINT_2F() const { return {x,y}; }
+#endif
     float* operator&() { return &x; }
     const float* operator&() const { return &x; }
 };
@@ -62,8 +72,10 @@ struct float4
     union { float a; float w; };
     float4() = default;
     float4( float _x, float _y, float _z, float _w ) : x(_x), y(_y), z(_z), w(_w) {}
+#ifdef _WIN32
     float4( const D2D1_COLOR_F& c ) : r(c.r), g(c.g), b(c.b), a(c.a) {}
     operator D2D1_COLOR_F() const { return {r,g,b,a}; }
+#endif
     float* operator&() { return &x; }
     const float* operator&() const { return &x; }
 };
@@ -116,6 +128,182 @@ inline std::string formatLaptime( float secs )
     return std::string( s );
 }
 
+//
+// Simple bump allocator for NUL-terminated strings that all share the same lifetime,
+// e.g. the per-car strings pulled out of one session string update.
+//
+// reset() keeps the buffer around, so once it's large enough, refilling the pool doesn't
+// touch the heap at all. The buffer never grows between two reset() calls, which means
+// pointers returned by add() stay valid until the next reset().
+//
+class StringPool
+{
+    public:
+
+        // Discard all strings and make room for at least 'capacity' bytes, including terminators.
+        void reset( size_t capacity )
+        {
+            if( m_buf.size() < capacity )
+                m_buf.resize( capacity );
+            m_used = 0;
+        }
+
+        // Returns an empty string if the pool is exhausted.
+        char* add( const char* s, size_t len )
+        {
+            if( m_used + len + 1 > m_buf.size() )
+                return m_empty;
+
+            char* dst = &m_buf[m_used];
+            memcpy( dst, s, len );
+            dst[len] = 0;
+            m_used += len + 1;
+            return dst;
+        }
+
+        size_t used() const { return m_used; }
+
+    private:
+
+        std::vector<char>   m_buf;
+        size_t              m_used = 0;
+        char                m_empty[1] = {0};
+};
+
+// Keeps up to 64 items (car indices) ordered by ascending key across frames. The order only changes
+// when cars swap places, so instead of sorting from scratch each frame, the previous order is
+// repaired with an insertion sort, which is close to linear on nearly sorted input. Equal keys
+// keep their previous order.
+class IncrementalOrder
+{
+    public:
+
+        IncrementalOrder()
+        {
+            for( int& idx : m_index )
+                idx = -1;
+        }
+
+        // Items with their bit set in 'mask' are ordered by keys[item]. Items that left are dropped,
+        // new ones get sorted in from the end.
+        void update( const float* keys, unsigned long long mask )
+        {
+            int n = 0;
+            for( int i=0; i<m_size; ++i )
+            {
+                if( (mask >> m_items[i]) & 1 )
+                    m_items[n++] = m_items[i];
+            }
+            unsigned long long added = mask;
+            for( int i=0; i<n; ++i )
+                added &= ~(1ULL << m_items[i]);
+            for( int item=0; item<64; ++item )
+            {
+                if( (added >> item) & 1 )
+                    m_items[n++] = item;
+            }
+            m_size = n;
+
+            for( int i=1; i<m_size; ++i )
+            {
+                const int   item = m_items[i];
+                const float key = keys[item];
+                int j = i;
+                for( ; j>0 && key < keys[m_items[j-1]]; --j )
+                    m_items[j] = m_items[j-1];
+                m_items[j] = item;
+            }
+
+            for( int& idx : m_index )
+                idx = -1;
+            for( int i=0; i<m_size; ++i )
+                m_index[m_items[i]] = i;
+        }
+
+        // Like update(), but only orders the window around 'center': up to 'before' items directly in
+        // front of it and up to 'after' directly behind, for views that can only show a few rows
+        // either side. Each item is compared against at most the window, instead of repairing the
+        // whole order. Ties keep the last frame's order. Empty if 'center' isn't in 'mask'.
+        void updateWindow( const float* keys, unsigned long long mask, int center, int before, int after )
+        {
+            // Last frame's ranks break ties; items that weren't shown go after those that were
+            int tie[64];
+            for( int item=0; item<64; ++item )
+                tie[item] = m_index[item] >= 0 ? m_index[item] : 64 + item;
+
+            auto less = [&]( int a, int b ) {
+                return keys[a] < keys[b] || (keys[a] == keys[b] && tie[a] < tie[b]);
+            };
+
+            for( int& idx : m_index )
+                idx = -1;
+            m_size = 0;
+            if( center < 0 || center >= 64 || !((mask >> center) & 1) )
+                return;
+
+            before = std::max( 0, std::min(before, 63) );
+            after  = std::max( 0, std::min(after, 63) );
+
+            // Both kept ascending. 'ahead' holds the largest items below the center, 'behind' the
+            // smallest above it.
+            int ahead[64], behind[64];
+            int numAhead = 0, numBehind = 0;
+            for( int item=0; item<64; ++item )
+            {
+                if( !((mask >> item) & 1) || item == center )
+                    continue;
+
+                if( less(item, center) )
+                {
+                    if( numAhead == before && (!before || !less(ahead[0], item)) )
+                        continue;
+                    int j = numAhead;
+                    if( numAhead == before ) {
+                        // Drop the one furthest from the center
+                        for( int k=1; k<numAhead; ++k )
+                            ahead[k-1] = ahead[k];
+                        --j;
+                    }
+                    else
+                        numAhead++;
+                    for( ; j>0 && less(item, ahead[j-1]); --j )
+                        ahead[j] = ahead[j-1];
+                    ahead[j] = item;
+                }
+                else
+                {
+                    if( numBehind == after && (!after || !less(item, behind[numBehind-1])) )
+                        continue;
+                    int j = numBehind < after ? numBehind++ : numBehind-1;
+                    for( ; j>0 && less(item, behind[j-1]); --j )
+                        behind[j] = behind[j-1];
+                    behind[j] = item;
+                }
+            }
+
+            for( int i=0; i<numAhead; ++i )
+                m_items[m_size++] = ahead[i];
+            m_items[m_size++] = center;
+            for( int i=0; i<numBehind; ++i )
+                m_items[m_size++] = behind[i];
+
+            for( int i=0; i<m_size; ++i )
+                m_index[m_items[i]] = i;
+        }
+
+        int size() const { return m_size; }
+        int operator[]( int i ) const { return m_items[i]; }
+
+        // Position of 'item' in the order, or -1
+        int indexOf( int item ) const { return item>=0 && item<64 ? m_index[item] : -1; }
+
+    private:
+
+        int     m_items[64] = {};
+        int     m_index[64];
+        int     m_size = 0;
+};
+
 class ColumnLayout
 {
     public:
@@ -266,6 +454,57 @@ inline unsigned int MurmurHash2 ( const void * key, int len, unsigned int seed )
 // End MurmurHash2
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+// MurmurHash64A, 64-bit version of the above, also by Austin Appleby.
+// Same caveats, except that the 8-byte reads go through memcpy so unaligned input is fine.
+
+inline unsigned long long MurmurHash64A ( const void * key, int len, unsigned long long seed )
+{
+    const unsigned long long m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+
+    unsigned long long h = seed ^ (len * m);
+
+    const unsigned char * data = (const unsigned char *)key;
+    const unsigned char * end = data + (len/8)*8;
+
+    while(data != end)
+    {
+        unsigned long long k;
+        memcpy( &k, data, sizeof(k) );
+        data += 8;
+
+        k *= m; 
+        k ^= k >> r; 
+        k *= m; 
+
+        h ^= k;
+        h *= m; 
+    }
+
+    switch(len & 7)
+    {
+    case 7: h ^= (unsigned long long)data[6] << 48;
+    case 6: h ^= (unsigned long long)data[5] << 40;
+    case 5: h ^= (unsigned long long)data[4] << 32;
+    case 4: h ^= (unsigned long long)data[3] << 24;
+    case 3: h ^= (unsigned long long)data[2] << 16;
+    case 2: h ^= (unsigned long long)data[1] << 8;
+    case 1: h ^= (unsigned long long)data[0];
+        h *= m;
+    };
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+// End MurmurHash64A
+//-----------------------------------------------------------------------------
+
+#ifdef _WIN32
+
 class TextCache
 {
     public:
@@ -376,11 +615,15 @@ inline float2 computeTextExtent( const wchar_t* str, IDWriteFactory* factory, ID
     return float2( m.width, m.height );
 }
 
+#endif // _WIN32
+
 inline float celsiusToFahrenheit( float c )
 {
     return c * (9.0f / 5.0f) + 32.0f;
 }
 
+#ifdef _WIN32
+
 inline bool parseHotkey( const std::string& desc, UINT* mod, UINT* vk )
 {
     // Dumb but good-enough way to turn strings like "Ctrl-Shift-F1" into values understood by RegisterHotkey.
@@ -435,3 +678,5 @@ inline bool parseHotkey( const std::string& desc, UINT* mod, UINT* vk )
 
     return false;
 }
+
+#endif // _WIN32